@@ -0,0 +1,270 @@
+#include "Alignment.h"
+#include "OrientationFilter.h"
+#include <Preferences.h>
+
+static AlignmentMatrix alignment;
+static bool aligned = false;
+static AlignmentStatus status = {ALIGN_STATE_IDLE, 0, 0, nullptr};
+
+// Capture state
+static CalibrationAccumulator levelCapture;
+static unsigned long phaseStart = 0;
+static float upAxis[3];           // Unit gravity reaction (vehicle +Z) in sensor coordinates
+static float forwardSum[3];
+static float forwardMagnitudeSum = 0;
+
+// Hot-path rotation, rebuilt whenever the matrix changes
+static int32_t rotationQ[3][3];
+
+static float norm3(const float v[3]) {
+    return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+// Vehicle axes from the measured up and forward directions (need not be
+// unit length or orthogonal - forward is projected onto the horizontal plane)
+const char* estimateAlignment(const float up[3], const float forward[3], AlignmentMatrix &out) {
+    float upLength = norm3(up);
+    if (upLength == 0.0) {
+        return "No gravity reference";
+    }
+    float z[3] = {up[0] / upLength, up[1] / upLength, up[2] / upLength};
+    
+    float along = forward[0] * z[0] + forward[1] * z[1] + forward[2] * z[2];
+    float x[3] = {forward[0] - along * z[0], forward[1] - along * z[1], forward[2] - along * z[2]};
+    float xLength = norm3(x);
+    if (xLength == 0.0) {
+        return "No forward reference";
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        x[i] /= xLength;
+    }
+    
+    // Y = Z x X completes a right-handed frame (left of forward)
+    float y[3] = {z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0]};
+    
+    out.version = ALIGN_VERSION;
+    for (uint8_t i = 0; i < 3; i++) {
+        out.r[0][i] = x[i];
+        out.r[1][i] = y[i];
+        out.r[2][i] = z[i];
+    }
+    return nullptr;
+}
+
+static void setAlignment(const AlignmentMatrix &m, bool valid) {
+    alignment = m;
+    for (uint8_t row = 0; row < 3; row++) {
+        for (uint8_t col = 0; col < 3; col++) {
+            rotationQ[row][col] = lroundf(m.r[row][col] * (1 << ALIGN_MATRIX_Q));
+        }
+    }
+    aligned = valid;
+    
+    // Attitude relative to the new frame jumps - re-seed it from gravity
+    invalidateOrientation();
+}
+
+static void setIdentityAlignment() {
+    AlignmentMatrix identity = {ALIGN_VERSION, {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}};
+    setAlignment(identity, false);
+}
+
+static void saveAlignment() {
+    Preferences prefs;
+    if (!prefs.begin(CALIB_NVS_NAMESPACE, false)) {
+        Serial.println("ALIGN: ✗ Could not open NVS - alignment not saved");
+        return;
+    }
+    if (aligned) {
+        prefs.putBytes(ALIGN_NVS_KEY, &alignment, sizeof(alignment));
+    } else {
+        prefs.remove(ALIGN_NVS_KEY);
+    }
+    prefs.end();
+}
+
+// Restore the stored mounting alignment (call once at boot)
+void loadAlignment() {
+    setIdentityAlignment();
+    
+    Preferences prefs;
+    if (!prefs.begin(CALIB_NVS_NAMESPACE, true)) {
+        Serial.println("ALIGN: No stored alignment - using sensor frame");
+        return;
+    }
+    AlignmentMatrix stored;
+    size_t length = prefs.getBytes(ALIGN_NVS_KEY, &stored, sizeof(stored));
+    prefs.end();
+    
+    if (length != sizeof(stored) || stored.version != ALIGN_VERSION) {
+        Serial.println("ALIGN: No stored alignment - using sensor frame");
+        return;
+    }
+    setAlignment(stored, true);
+    Serial.println("ALIGN: ✓ Stored alignment loaded");
+}
+
+bool startAlignment(uint8_t mode) {
+    if (status.state == ALIGN_STATE_LEVEL || status.state == ALIGN_STATE_FORWARD) {
+        return false;
+    }
+    
+    status.progress = 0;
+    status.forwardSamples = 0;
+    status.error = nullptr;
+    
+    if (mode == ALIGN_MODE_CLEAR) {
+        setIdentityAlignment();
+        saveAlignment();
+        status.state = ALIGN_STATE_IDLE;
+        Serial.println("ALIGN: Alignment cleared");
+        return true;
+    }
+    if (mode != ALIGN_MODE_START) {
+        return false;
+    }
+    
+    resetCalibrationAccumulator(levelCapture);
+    phaseStart = millis();
+    status.state = ALIGN_STATE_LEVEL;
+    Serial.println("ALIGN: Level capture started - keep the vehicle parked");
+    return true;
+}
+
+static void failAlignment(const char* error) {
+    status.state = ALIGN_STATE_FAILED;
+    status.error = error;
+    Serial.print("ALIGN: ✗ ");
+    Serial.println(error);
+}
+
+static void finishLevelPhase() {
+    const char* error = checkStationary(levelCapture);
+    if (error != nullptr) {
+        failAlignment(error);
+        return;
+    }
+    float length = norm3(levelCapture.accelMean);
+    if (fabs(length - 1.0) > CALIB_GRAVITY_TOLERANCE_G) {
+        failAlignment("Gravity reading out of range - calibrate first");
+        return;
+    }
+    
+    for (uint8_t i = 0; i < 3; i++) {
+        upAxis[i] = levelCapture.accelMean[i] / length;
+        forwardSum[i] = 0;
+    }
+    forwardMagnitudeSum = 0;
+    phaseStart = millis();
+    status.progress = 50;
+    status.state = ALIGN_STATE_FORWARD;
+    Serial.println("ALIGN: Level captured - accelerate gently in a straight line");
+}
+
+static void finishForwardPhase() {
+    if (norm3(forwardSum) < ALIGN_MIN_CONSISTENCY * forwardMagnitudeSum) {
+        failAlignment("Turning or braking during forward capture");
+        return;
+    }
+    
+    AlignmentMatrix result;
+    const char* error = estimateAlignment(upAxis, forwardSum, result);
+    if (error != nullptr) {
+        failAlignment(error);
+        return;
+    }
+    setAlignment(result, true);
+    saveAlignment();
+    status.progress = 100;
+    status.state = ALIGN_STATE_DONE;
+    Serial.println("ALIGN: ✓ Alignment saved");
+}
+
+// Add one calibrated, not yet rotated sample to the procedure in progress
+void feedAlignmentSample(const MotionSample &sample) {
+    if (status.state != ALIGN_STATE_LEVEL && status.state != ALIGN_STATE_FORWARD) {
+        return;
+    }
+    
+    float accel[3] = {accelToG(sample.ax, sample.accelRange), accelToG(sample.ay, sample.accelRange),
+                      accelToG(sample.az, sample.accelRange)};
+    float gyro[3] = {gyroToDps(sample.gx), gyroToDps(sample.gy), gyroToDps(sample.gz)};
+    unsigned long elapsed = millis() - phaseStart;
+    
+    if (status.state == ALIGN_STATE_LEVEL) {
+        accumulateCalibrationSample(levelCapture, accel, gyro);
+        if (elapsed >= ALIGN_LEVEL_DURATION_MS) {
+            finishLevelPhase();
+        } else {
+            status.progress = elapsed * 50 / ALIGN_LEVEL_DURATION_MS;
+        }
+        return;
+    }
+    
+    if (norm3(gyro) > ALIGN_MAX_TURN_DPS) {
+        return;
+    }
+    
+    // Horizontal component of the measured acceleration
+    float along = accel[0] * upAxis[0] + accel[1] * upAxis[1] + accel[2] * upAxis[2];
+    float h[3] = {accel[0] - along * upAxis[0], accel[1] - along * upAxis[1], accel[2] - along * upAxis[2]};
+    float magnitude = norm3(h);
+    if (magnitude < ALIGN_MIN_FORWARD_G) {
+        return;
+    }
+    
+    for (uint8_t i = 0; i < 3; i++) {
+        forwardSum[i] += h[i];
+    }
+    forwardMagnitudeSum += magnitude;
+    status.forwardSamples++;
+    status.progress = 50 + status.forwardSamples * 50 / ALIGN_FORWARD_SAMPLES;
+    
+    if (status.forwardSamples >= ALIGN_FORWARD_SAMPLES) {
+        finishForwardPhase();
+    }
+}
+
+// Fail a procedure that stalls (call from loop)
+void serviceAlignment() {
+    unsigned long elapsed = millis() - phaseStart;
+    if (status.state == ALIGN_STATE_LEVEL && elapsed >= ALIGN_LEVEL_DURATION_MS + CALIB_SAMPLE_TIMEOUT_MS) {
+        failAlignment("No sensor samples");
+    } else if (status.state == ALIGN_STATE_FORWARD && elapsed >= ALIGN_FORWARD_TIMEOUT_MS) {
+        failAlignment("No straight-line acceleration detected");
+    }
+}
+
+static int16_t rotateAxis(const int32_t row[3], int16_t x, int16_t y, int16_t z) {
+    int32_t value = (row[0] * x + row[1] * y + row[2] * z) >> ALIGN_MATRIX_Q;
+    return (int16_t)constrain(value, (int32_t)-32768, (int32_t)32767);
+}
+
+// Rotate accel and gyro into the vehicle frame in place
+void applyAlignment(MotionSample &sample) {
+    if (!aligned) {
+        return;
+    }
+    
+    int16_t ax = sample.ax, ay = sample.ay, az = sample.az;
+    sample.ax = rotateAxis(rotationQ[0], ax, ay, az);
+    sample.ay = rotateAxis(rotationQ[1], ax, ay, az);
+    sample.az = rotateAxis(rotationQ[2], ax, ay, az);
+    
+    int16_t gx = sample.gx, gy = sample.gy, gz = sample.gz;
+    sample.gx = rotateAxis(rotationQ[0], gx, gy, gz);
+    sample.gy = rotateAxis(rotationQ[1], gx, gy, gz);
+    sample.gz = rotateAxis(rotationQ[2], gx, gy, gz);
+}
+
+bool isAligned() {
+    return aligned;
+}
+
+const AlignmentMatrix& getAlignment() {
+    return alignment;
+}
+
+const AlignmentStatus& getAlignmentStatus() {
+    return status;
+}
@@ -0,0 +1,64 @@
+#ifndef ALIGNMENT_H
+#define ALIGNMENT_H
+
+#include <Arduino.h>
+#include "MPU6050Handler.h"
+#include "Calibration.h"
+
+// Mounting alignment: rotation from the sensor frame to the vehicle frame
+// Vehicle frame: X forward, Y left, Z up. The procedure has two phases:
+//   1. Level  - vehicle parked: the mean accel vector is vehicle +Z.
+//   2. Forward - vehicle accelerating in a straight line: the mean horizontal
+//      accel (gravity removed) is vehicle +X. Braking or turning is rejected.
+// Samples are rotated in place with a precomputed Q14 matrix, so roll/pitch
+// and every downstream stage see the vehicle frame.
+
+// Alignment Modes
+#define ALIGN_MODE_START           0
+#define ALIGN_MODE_CLEAR           1
+
+// Alignment States
+#define ALIGN_STATE_IDLE           0
+#define ALIGN_STATE_LEVEL          1     // Collecting the parked capture
+#define ALIGN_STATE_FORWARD        2     // Waiting for straight-line acceleration
+#define ALIGN_STATE_DONE           3
+#define ALIGN_STATE_FAILED         4
+
+// Procedure Constants
+#define ALIGN_LEVEL_DURATION_MS    2000
+#define ALIGN_FORWARD_TIMEOUT_MS   60000
+#define ALIGN_MIN_FORWARD_G        0.1   // Horizontal accel that counts as driving forward
+#define ALIGN_MAX_TURN_DPS         5.0   // Any faster rotation is treated as turning
+#define ALIGN_FORWARD_SAMPLES      50
+#define ALIGN_MIN_CONSISTENCY      0.9   // |sum of h| / sum of |h| - low means mixed directions
+#define ALIGN_MATRIX_Q             14
+
+// Non-Volatile Storage (CALIB_NVS_NAMESPACE)
+#define ALIGN_NVS_KEY              "align"
+#define ALIGN_VERSION              1
+
+struct AlignmentMatrix {
+  uint8_t version;
+  float r[3][3];                 // Rows are the vehicle X, Y, Z axes in sensor coordinates
+};
+
+struct AlignmentStatus {
+  uint8_t state;                 // ALIGN_STATE_*
+  uint8_t progress;              // Percent: level phase 0-50, forward phase 50-100
+  uint32_t forwardSamples;
+  const char* error;             // Reason when ALIGN_STATE_FAILED
+};
+
+// Estimator (no hardware access)
+const char* estimateAlignment(const float up[3], const float forward[3], AlignmentMatrix &out);
+
+void loadAlignment();
+bool startAlignment(uint8_t mode);
+void feedAlignmentSample(const MotionSample &sample);
+void serviceAlignment();
+void applyAlignment(MotionSample &sample);
+bool isAligned();
+const AlignmentMatrix& getAlignment();
+const AlignmentStatus& getAlignmentStatus();
+
+#endif
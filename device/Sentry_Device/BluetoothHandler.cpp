@@ -5,78 +5,276 @@ BLEServer* pServer = nullptr;
 BLECharacteristic* pSensorDataChar = nullptr;
 BLECharacteristic* pConfigChar = nullptr;
 BLECharacteristic* pDeviceStatusChar = nullptr;
+BLECharacteristic* pBulkDataChar = nullptr;
 
-bool deviceConnected = false;
-bool oldDeviceConnected = false;
+// Client Characteristic Configuration descriptors (for per-connection subscriptions)
+static BLE2902* pSensorDataCCCD = nullptr;
+static BLE2902* pConfigCCCD = nullptr;
+static BLE2902* pDeviceStatusCCCD = nullptr;
+static BLE2902* pBulkDataCCCD = nullptr;
 
-// Packet sequence number (increments for each packet)
-static uint32_t sequenceNumber = 0;
+// Per-connection state
+// Fast-path commands run in the BLE task; the fields they share with loop()
+// (sequence, encoding, streamIntervalMs) are only touched under connStateMux.
+static BLEConnectionState connections[BLE_MAX_CONNECTIONS];
+static portMUX_TYPE connStateMux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t connectionCount = 0;
+static uint8_t oldConnectionCount = 0;
+static bool readvertisePending = false;      // Advertising restart waiting out a disconnect
+static unsigned long disconnectTime = 0;
 
-// Command callback flag
-static bool commandReceived = false;
-static String receivedCommand = "";
+// Sensor stream sequence number (increments once per sample, shared by all clients
+// so an encoded frame can be sent to every subscriber unchanged)
+static uint32_t streamSequence = 0;
 
-// MTU tracking
-static uint16_t currentMTU = BLE_DEFAULT_MTU;
+// JSON sensor frames that lost optional fields, or could not be sent at all,
+// to stay within MAX_PACKET_SIZE
+static uint32_t jsonFramesTrimmed = 0;
+static uint32_t jsonFramesDropped = 0;
+
+// Set when a client acknowledges the alert; handled in loop()
+static volatile bool alertAcknowledged = false;
+
+// Client waiting for reports from a long-running procedure (calibration,
+// alignment) and what it was last sent
+struct ProcedureReport {
+  int32_t connId;                // -1 when nobody is waiting
+  uint8_t state;
+  uint8_t step;
+};
+static ProcedureReport calibrationReport = {-1, 0, 0};
+static ProcedureReport alignmentReport = {-1, 0, 0};
+
+// Time-sync exchanges with the reference client (see TimeSync.h)
+static uint16_t timeSyncSeq = 0;
+static int64_t timeSyncT1 = 0;                 // Send time of the outstanding request (0 = none)
+static unsigned long timeSyncSentMs = 0;
+static bool timeSyncBurstActive = false;
+static uint8_t timeSyncBurstCount = 0;         // Requests of the current burst answered or lost
+static unsigned long timeSyncNextMs = 0;       // When the next request of the burst is due
+static unsigned long lastTimeSyncBurstMs = 0;
+
+// Bulk transfer of the pre-crash recorder window (0 = none running)
+static uint8_t recorderTransferId = 0;
+
+static bool isFastPathCommand(uint8_t cmdType);
+static void handleTimeSyncAnswer(BLEConnectionState* conn, JsonDocument& cmdDoc);
+static void executeCommand(BLEConnectionState* conn, JsonDocument& cmdDoc);
+
+// Crash beacon state
+static bool crashBeaconActive = false;
+static uint16_t crashBeaconEventId = 0;
+static unsigned long crashBeaconStartTime = 0;
+
+// Look up the state slot for a connection ID
+BLEConnectionState* getConnectionState(uint16_t connId) {
+  for (uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+    if (connections[i].active && connections[i].connId == connId) {
+      return &connections[i];
+    }
+  }
+  return nullptr;
+}
+
+uint8_t getConnectionCount() {
+  return connectionCount;
+}
+
+// Shortest stream interval among clients subscribed to sensor data (0 if none)
+uint16_t getFastestStreamIntervalMs() {
+  uint16_t fastest = 0;
+  portENTER_CRITICAL(&connStateMux);
+  for (uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+    const BLEConnectionState& conn = connections[i];
+    if (conn.active && (conn.subscriptions & SUB_SENSOR_DATA) &&
+        (fastest == 0 || conn.streamIntervalMs < fastest)) {
+      fastest = conn.streamIntervalMs;
+    }
+  }
+  portEXIT_CRITICAL(&connStateMux);
+  return fastest;
+}
 
 // Server Callback class
 class MyServerCallbacks: public BLEServerCallbacks {
-    void onConnect(BLEServer* pServer) {
-      deviceConnected = true;
-      sequenceNumber = 0; // Reset sequence on new connection
-      // MTU negotiation happens automatically after connection
-      // We'll use a conservative default and let chunking handle if needed
-      currentMTU = BLE_MTU_REQUEST; // Assume requested MTU, chunking will handle if not
-      Serial.println("*** Bluetooth: Client Connected ***");
-      Serial.print("BLE: MTU requested: ");
-      Serial.println(BLE_MTU_REQUEST);
-      // Serial.println("BLE: Sequence number reset to 0");
-    }
-
-    void onDisconnect(BLEServer* pServer) {
-      deviceConnected = false;
-      currentMTU = BLE_DEFAULT_MTU; // Reset MTU on disconnect
-      Serial.println("*** Bluetooth: Client Disconnected ***");
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+      BLEConnectionState* conn = nullptr;
+      for (uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+        if (!connections[i].active) {
+          conn = &connections[i];
+          break;
+        }
+      }
+      
+      if (conn == nullptr) {
+        // Controller accepted more links than we track - refuse the extra one
+        Serial.println("BLE: Connection limit reached - disconnecting client");
+        pServer->disconnect(param->connect.conn_id);
+        return;
+      }
+      
+      conn->connId = param->connect.conn_id;
+      // MTU starts at the default and is updated by onMtuChanged after negotiation
+      conn->mtu = BLE_DEFAULT_MTU;
+      conn->subscriptions = 0;
+      conn->lastStreamTime = 0;
+      conn->commandReceived = false;
+      conn->pendingCommand = "";
+      conn->commandReceivedUs = 0;
+      conn->timeSync = false;
+      portENTER_CRITICAL(&connStateMux);
+      conn->encoding = ENCODING_JSON;
+      conn->sequence = 0;
+      conn->streamIntervalMs = BLE_DEFAULT_STREAM_INTERVAL_MS;
+      conn->active = true;
+      portEXIT_CRITICAL(&connStateMux);
+      connectionCount++;
+      
+      Serial.print("*** Bluetooth: Client Connected [Conn: ");
+      Serial.print(conn->connId);
+      Serial.print(", Total: ");
+      Serial.print(connectionCount);
+      Serial.println("] ***");
+    }
+
+    void onDisconnect(BLEServer*, esp_ble_gatts_cb_param_t* param) {
+      BLEConnectionState* conn = getConnectionState(param->disconnect.conn_id);
+      if (conn == nullptr) {
+        return;
+      }
+      
+      conn->active = false;
+      conn->pendingCommand = "";
+      connectionCount--;
+      
+      Serial.print("*** Bluetooth: Client Disconnected [Conn: ");
+      Serial.print(param->disconnect.conn_id);
+      Serial.println("] ***");
+    }
+
+    void onMtuChanged(BLEServer*, esp_ble_gatts_cb_param_t* param) {
+      BLEConnectionState* conn = getConnectionState(param->mtu.conn_id);
+      if (conn != nullptr) {
+        conn->mtu = param->mtu.mtu;
+        Serial.print("BLE: MTU negotiated [Conn: ");
+        Serial.print(conn->connId);
+        Serial.print("]: ");
+        Serial.println(conn->mtu);
+      }
     }
 };
 
 // Configuration Characteristic Callback
 class ConfigCharacteristicCallbacks: public BLECharacteristicCallbacks {
-    void onWrite(BLECharacteristic* pCharacteristic) {
+    void onWrite(BLECharacteristic* pCharacteristic, esp_ble_gatts_cb_param_t* param) {
+      int64_t receivedUs = esp_timer_get_time();  // t4 when this is a time-sync answer
+      BLEConnectionState* conn = getConnectionState(param->write.conn_id);
       String value = pCharacteristic->getValue();
-      if (value.length() > 0) {
-        receivedCommand = value;
-        commandReceived = true;
-    // Serial.print("BLE: Command received - ");
-    // Serial.println(receivedCommand);
+      if (conn == nullptr || value.length() == 0) {
+        return;
       }
+      
+      // Latency-critical commands run here in the BLE task instead of waiting
+      // for the next loop() pass; the notify response is the acknowledgement
+      // for clients using write-without-response
+      StaticJsonDocument<192> cmdDoc;
+      if (!deserializeJson(cmdDoc, value) && isFastPathCommand(cmdDoc["command"] | 0)) {
+        executeCommand(conn, cmdDoc);
+        return;
+      }
+      
+      conn->pendingCommand = value;
+      conn->commandReceivedUs = receivedUs;
+      conn->commandReceived = true;
+    // Serial.print("BLE: Command received - ");
+    // Serial.println(conn->pendingCommand);
     }
 };
 
-// Calculate CRC-16 (CCITT polynomial)
-uint16_t calculateCRC16(const uint8_t* data, size_t length) {
-  uint16_t crc = 0xFFFF;
-  for (size_t i = 0; i < length; i++) {
-    crc ^= (uint16_t)data[i] << 8;
-    for (uint8_t j = 0; j < 8; j++) {
-      if (crc & 0x8000) {
-        crc = (crc << 1) ^ CRC_POLYNOMIAL;
-      } else {
-        crc <<= 1;
-      }
+// Bulk Data Characteristic Callback (flow-control credits and abort)
+class BulkDataCharacteristicCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic*, esp_ble_gatts_cb_param_t* param) {
+      handleBulkControl(param->write.conn_id, param->write.value, param->write.len);
     }
+};
+
+// Track notification subscriptions per connection
+// The BLE2902 descriptor only stores the last value written by any client,
+// so CCCD writes are intercepted here and recorded against the connection.
+static void gattsEventHandler(esp_gatts_cb_event_t event, esp_gatt_if_t, esp_ble_gatts_cb_param_t* param) {
+  if (event != ESP_GATTS_WRITE_EVT || param->write.is_prep || param->write.len != 2) {
+    return;
+  }
+  
+  BLEConnectionState* conn = getConnectionState(param->write.conn_id);
+  if (conn == nullptr) {
+    return;
   }
-  return crc;
+  
+  uint8_t flag = 0;
+  if (pSensorDataCCCD != nullptr && param->write.handle == pSensorDataCCCD->getHandle()) {
+    flag = SUB_SENSOR_DATA;
+  } else if (pConfigCCCD != nullptr && param->write.handle == pConfigCCCD->getHandle()) {
+    flag = SUB_CONFIG;
+  } else if (pDeviceStatusCCCD != nullptr && param->write.handle == pDeviceStatusCCCD->getHandle()) {
+    flag = SUB_DEVICE_STATUS;
+  } else if (pBulkDataCCCD != nullptr && param->write.handle == pBulkDataCCCD->getHandle()) {
+    flag = SUB_BULK_DATA;
+  } else {
+    return;
+  }
+  
+  // Bit 0 = notifications, bit 1 = indications
+  if (param->write.value[0] & 0x03) {
+    conn->subscriptions |= flag;
+  } else {
+    conn->subscriptions &= ~flag;
+  }
+}
+
+// Get next sequence number for a connection
+uint32_t getNextSequenceNumber(BLEConnectionState* conn) {
+  portENTER_CRITICAL(&connStateMux);
+  uint32_t sequence = ++conn->sequence;
+  portEXIT_CRITICAL(&connStateMux);
+  return sequence;
 }
 
-// Get next sequence number
-uint32_t getNextSequenceNumber() {
-  return ++sequenceNumber;
+// Get negotiated MTU size for a connection
+uint16_t getCurrentMTU(uint16_t connId) {
+  BLEConnectionState* conn = getConnectionState(connId);
+  return (conn != nullptr) ? conn->mtu : BLE_DEFAULT_MTU;
+}
+
+// Map a characteristic to its subscription flag
+static uint8_t subscriptionFlagFor(BLECharacteristic* pChar) {
+  if (pChar == pSensorDataChar) {
+    return SUB_SENSOR_DATA;
+  } else if (pChar == pConfigChar) {
+    return SUB_CONFIG;
+  } else if (pChar == pDeviceStatusChar) {
+    return SUB_DEVICE_STATUS;
+  } else if (pChar == pBulkDataChar) {
+    return SUB_BULK_DATA;
+  }
+  return 0;
 }
 
-// Get current MTU size
-uint16_t getCurrentMTU() {
-  return currentMTU;
+// Notify a single connection, bypassing BLECharacteristic::notify() which
+// would send the same value to every connected client
+bool sendToConnection(BLEConnectionState* conn, BLECharacteristic* pChar, const uint8_t* data, size_t length) {
+  if (conn == nullptr || !conn->active || pChar == nullptr) {
+    return false;
+  }
+  
+  if (!(conn->subscriptions & subscriptionFlagFor(pChar))) {
+    return false;
+  }
+  
+  esp_err_t err = esp_ble_gatts_send_indicate(pServer->getGattsIf(), conn->connId,
+                                              pChar->getHandle(), length,
+                                              (uint8_t*)data, false);
+  return err == ESP_OK;
 }
 
 // Send data with automatic chunking if needed
@@ -84,8 +282,8 @@ uint16_t getCurrentMTU() {
 // This function is primarily a safety measure. Ideally, MTU negotiation
 // should allow single-packet transmission. If chunking occurs, the receiver
 // must reassemble chunks before parsing JSON.
-void sendDataWithChunking(BLECharacteristic* pChar, const String& data) {
-  if (pChar == nullptr || data.length() == 0) {
+void sendDataWithChunking(BLEConnectionState* conn, BLECharacteristic* pChar, const String& data) {
+  if (conn == nullptr || pChar == nullptr || data.length() == 0) {
     return;
   }
   
@@ -108,14 +306,13 @@ void sendDataWithChunking(BLECharacteristic* pChar, const String& data) {
   // ESP32 BLE library will automatically handle MTU and split if needed
   // However, if MTU negotiation failed, this might silently fail
   // So we also provide chunking as explicit fallback for very large data
-  size_t safeSinglePacketSize = (currentMTU > BLE_DEFAULT_MTU) ? 
-                                 (currentMTU - 3) : BLE_CHUNK_SIZE;
+  size_t safeSinglePacketSize = (conn->mtu > BLE_DEFAULT_MTU) ? 
+                                 (conn->mtu - 3) : BLE_CHUNK_SIZE;
   
   // Check if data fits in single packet
   if (dataLength <= safeSinglePacketSize) {
-    // Single packet transmission - ESP32 BLE library handles MTU automatically
-    pChar->setValue(data.c_str());
-    pChar->notify();
+    // Single packet transmission
+    sendToConnection(conn, pChar, (const uint8_t*)data.c_str(), dataLength);
   } else {
     // Data is larger than safe single packet size
     // Try sending anyway (ESP32 library might handle it), but warn
@@ -126,9 +323,8 @@ void sendDataWithChunking(BLECharacteristic* pChar, const String& data) {
     Serial.println(" bytes)");
     Serial.println("BLE: Attempting single packet - ESP32 library will handle MTU");
     
-    // Attempt single packet - ESP32 BLE library should handle MTU negotiation
-    pChar->setValue(data.c_str());
-    pChar->notify();
+    // Attempt single packet - the stack truncates to the negotiated MTU
+    sendToConnection(conn, pChar, (const uint8_t*)data.c_str(), dataLength);
     
     // Note: If this fails silently, we have no way to detect it
     // The receiver should validate JSON completeness
@@ -136,8 +332,8 @@ void sendDataWithChunking(BLECharacteristic* pChar, const String& data) {
 }
 
 // Send error response
-void sendErrorResponse(uint8_t errorCode, const char* message) {
-  if (!deviceConnected || pConfigChar == nullptr) {
+void sendErrorResponse(BLEConnectionState* conn, uint8_t errorCode, const char* message) {
+  if (conn == nullptr || pConfigChar == nullptr) {
     return;
   }
   
@@ -145,20 +341,122 @@ void sendErrorResponse(uint8_t errorCode, const char* message) {
   errorDoc["type"] = "error";
   errorDoc["error_code"] = errorCode;
   errorDoc["message"] = message;
-  errorDoc["sequence"] = getNextSequenceNumber();
+  errorDoc["sequence"] = getNextSequenceNumber(conn);
   errorDoc["timestamp"] = millis();
   
   String errorJson;
   serializeJson(errorDoc, errorJson);
   
   // Send via BLE with automatic chunking if needed
-  sendDataWithChunking(pConfigChar, errorJson);
+  sendDataWithChunking(conn, pConfigChar, errorJson);
   
   // Reduced Serial output
   // Serial.print("BLE: Error 0x");
   // Serial.println(errorCode, HEX);
 }
 
+// Configure the regular (connectable, service UUID) advertising payload
+static void configureDefaultAdvertising() {
+  BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+  
+  BLEAdvertisementData advData;
+  advData.setFlags(ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
+  advData.setCompleteServices(BLEUUID(SERVICE_UUID));
+  pAdvertising->setAdvertisementData(advData);
+  
+  BLEAdvertisementData scanResponse;
+  pAdvertising->setScanResponseData(scanResponse);
+  pAdvertising->setScanResponse(false);
+  pAdvertising->setMinPreferred(0x0);
+  pAdvertising->setMinInterval(DEFAULT_ADV_INTERVAL_MIN);
+  pAdvertising->setMaxInterval(DEFAULT_ADV_INTERVAL_MAX);
+}
+
+// Start advertising a crash event in manufacturer data
+// Any scanning phone can read the event without connecting. The beacon stays
+// connectable so the app can still connect for the full sensor stream.
+//
+// Payload layout (little-endian, BEACON_PAYLOAD_SIZE bytes):
+//   [0-1]   company ID (BEACON_COMPANY_ID)
+//   [2]     magic (BEACON_MAGIC)
+//   [3]     payload version (BEACON_VERSION)
+//   [4-5]   event ID (increments per event since boot)
+//   [6-9]   event timestamp (millis)
+//   [10]    severity (BEACON_SEVERITY_*)
+//   [11-12] roll in hundredths of a degree (int16)
+//   [13-14] pitch in hundredths of a degree (int16)
+void startCrashBeacon(uint8_t severity, float roll, float pitch) {
+  crashBeaconEventId++;
+  crashBeaconStartTime = millis();
+  
+  uint8_t payload[BEACON_PAYLOAD_SIZE];
+  putLE16(&payload[0], BEACON_COMPANY_ID);
+  payload[2] = BEACON_MAGIC;
+  payload[3] = BEACON_VERSION;
+  putLE16(&payload[4], crashBeaconEventId);
+  putLE32(&payload[6], crashBeaconStartTime);
+  payload[10] = severity;
+  putLE16(&payload[11], (uint16_t)(int16_t)constrain(roll * 100.0f, -18000.0f, 18000.0f));
+  putLE16(&payload[13], (uint16_t)(int16_t)constrain(pitch * 100.0f, -18000.0f, 18000.0f));
+  
+  BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+  pAdvertising->stop();
+  
+  // Flags + manufacturer data fill the 31-byte advertising packet,
+  // so the service UUID moves to the scan response
+  BLEAdvertisementData advData;
+  advData.setFlags(ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
+  advData.setManufacturerData(String(payload, BEACON_PAYLOAD_SIZE));
+  pAdvertising->setAdvertisementData(advData);
+  
+  BLEAdvertisementData scanResponse;
+  scanResponse.setCompleteServices(BLEUUID(SERVICE_UUID));
+  pAdvertising->setScanResponseData(scanResponse);
+  pAdvertising->setScanResponse(true);
+  
+  pAdvertising->setMinInterval(BEACON_ADV_INTERVAL_MIN);
+  pAdvertising->setMaxInterval(BEACON_ADV_INTERVAL_MAX);
+  pAdvertising->start();
+  
+  crashBeaconActive = true;
+  Serial.print("BLE: Crash beacon started [Event: ");
+  Serial.print(crashBeaconEventId);
+  Serial.println("]");
+}
+
+// Restore normal advertising
+void stopCrashBeacon() {
+  if (!crashBeaconActive) {
+    return;
+  }
+  
+  crashBeaconActive = false;
+  
+  BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+  pAdvertising->stop();
+  configureDefaultAdvertising();
+  
+  // Only resume advertising if another client can still connect
+  if (connectionCount < BLE_MAX_CONNECTIONS) {
+    pAdvertising->start();
+  }
+  Serial.println("BLE: Crash beacon stopped");
+}
+
+bool isCrashBeaconActive() {
+  return crashBeaconActive;
+}
+
+// Start or stop connectable advertising (parked mode advertises in windows)
+void setAdvertisingEnabled(bool enabled) {
+  BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+  if (!enabled) {
+    pAdvertising->stop();
+  } else if (connectionCount < BLE_MAX_CONNECTIONS) {
+    pAdvertising->start();
+  }
+}
+
 // Initialize Bluetooth Low Energy
 void initBluetooth(const char* deviceName) {
   // Initialize BLE device
@@ -175,6 +473,7 @@ void initBluetooth(const char* deviceName) {
   // Create BLE Server
   pServer = BLEDevice::createServer();
   pServer->setCallbacks(new MyServerCallbacks());
+  BLEDevice::setCustomGattsHandler(gattsEventHandler);
   
   // Create BLE Service
   BLEService* pService = pServer->createService(BLEUUID(SERVICE_UUID));
@@ -185,16 +484,19 @@ void initBluetooth(const char* deviceName) {
                       BLECharacteristic::PROPERTY_READ |
                       BLECharacteristic::PROPERTY_NOTIFY
                     );
-  pSensorDataChar->addDescriptor(new BLE2902());
+  pSensorDataCCCD = new BLE2902();
+  pSensorDataChar->addDescriptor(pSensorDataCCCD);
   
-  // Create Configuration Characteristic (Write, Notify)
+  // Create Configuration Characteristic (Write, Write Without Response, Notify)
   pConfigChar = pService->createCharacteristic(
                   BLEUUID(CHAR_CONFIG_UUID),
                   BLECharacteristic::PROPERTY_WRITE |
+                  BLECharacteristic::PROPERTY_WRITE_NR |
                   BLECharacteristic::PROPERTY_NOTIFY
                 );
   pConfigChar->setCallbacks(new ConfigCharacteristicCallbacks());
-  pConfigChar->addDescriptor(new BLE2902());
+  pConfigCCCD = new BLE2902();
+  pConfigChar->addDescriptor(pConfigCCCD);
   
   // Create Device Status Characteristic (Read, Notify)
   pDeviceStatusChar = pService->createCharacteristic(
@@ -202,16 +504,24 @@ void initBluetooth(const char* deviceName) {
                         BLECharacteristic::PROPERTY_READ |
                         BLECharacteristic::PROPERTY_NOTIFY
                       );
-  pDeviceStatusChar->addDescriptor(new BLE2902());
+  pDeviceStatusCCCD = new BLE2902();
+  pDeviceStatusChar->addDescriptor(pDeviceStatusCCCD);
+  
+  // Create Bulk Data Characteristic (Notify, Write Without Response for credits)
+  pBulkDataChar = pService->createCharacteristic(
+                    BLEUUID(CHAR_BULK_DATA_UUID),
+                    BLECharacteristic::PROPERTY_NOTIFY |
+                    BLECharacteristic::PROPERTY_WRITE_NR
+                  );
+  pBulkDataChar->setCallbacks(new BulkDataCharacteristicCallbacks());
+  pBulkDataCCCD = new BLE2902();
+  pBulkDataChar->addDescriptor(pBulkDataCCCD);
   
   // Start the service
   pService->start();
   
   // Start advertising
-  BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
-  pAdvertising->addServiceUUID(BLEUUID(SERVICE_UUID));
-  pAdvertising->setScanResponse(false);
-  pAdvertising->setMinPreferred(0x0);
+  configureDefaultAdvertising();
   BLEDevice::startAdvertising();
   
   // Note: Actual MTU will be negotiated during connection
@@ -221,42 +531,145 @@ void initBluetooth(const char* deviceName) {
 
 // Check if Bluetooth is connected
 bool isBluetoothConnected() {
-  return deviceConnected;
+  return connectionCount > 0;
 }
 
-// Send sensor data with packet structure
-void sendSensorData(float ax, float ay, float az, float roll, float pitch, bool tiltDetected, const char* statusMessage, int statusCode) {
-  if (!deviceConnected || pSensorDataChar == nullptr) {
+// Bulk transport over notifications on the bulk data characteristic
+// The context carries the connection ID rather than the state slot, so a slot
+// reused by a new client is never mistaken for the original receiver.
+static uint16_t bleBulkMaxPayload(void* ctx) {
+  BLEConnectionState* conn = getConnectionState((uint16_t)(uintptr_t)ctx);
+  if (conn == nullptr || !(conn->subscriptions & SUB_BULK_DATA)) {
+    return 0;
+  }
+  return conn->mtu - 3;
+}
+
+static bool bleBulkSend(void* ctx, const uint8_t* data, size_t length) {
+  BLEConnectionState* conn = getConnectionState((uint16_t)(uintptr_t)ctx);
+  return sendToConnection(conn, pBulkDataChar, data, length);
+}
+
+BulkTransport getBleBulkTransport(uint16_t connId) {
+  BulkTransport transport;
+  transport.maxPayload = bleBulkMaxPayload;
+  transport.send = bleBulkSend;
+  transport.ctx = (void*)(uintptr_t)connId;
+  transport.owner = connId;
+  return transport;
+}
+
+// Stream the pre-crash recorder window to one client (CMD_BULK_READ)
+// Recording stops for the transfer so the window holds still under it; if
+// the transfer cannot start, a window frozen only for it is released again.
+static bool startRecorderTransfer(BLEConnectionState* conn) {
+  bool wasFrozen = isMotionRecorderFrozen();
+  freezeMotionRecorder();
+  uint32_t length = getMotionRecorderBytes();
+  if (length == 0) {
+    sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Nothing recorded");
+  } else if (!startBulkTransfer(getBleBulkTransport(conn->connId), readMotionRecorder, nullptr, 0, length)) {
+    sendErrorResponse(conn, BLE_ERROR_BUSY, "Bulk transfer could not start");
+  } else {
+    recorderTransferId = getBulkTransferStats().transferId;
+    return true;
+  }
+  if (!wasFrozen) {
+    resumeMotionRecorder();
+  }
+  return false;
+}
+
+// Once the recorder transfer ends: a complete one starts a new window, an
+// aborted one leaves the window frozen for another CMD_BULK_READ
+static void serviceRecorderTransfer() {
+  if (recorderTransferId == 0 || isBulkTransferActive()) {
     return;
   }
-  
-  // Build JSON packet
-  StaticJsonDocument<256> doc;  // Increased to accommodate status message
+  const BulkTransferStats& bulkStats = getBulkTransferStats();
+  if (bulkStats.transferId == recorderTransferId && bulkStats.completed) {
+    resumeMotionRecorder();
+  }
+  recorderTransferId = 0;
+}
+
+// Encode a sensor sample as JSON; false if it cannot be made to fit MAX_PACKET_SIZE
+// Oversize frames first lose the fields a client can recover from the rest
+// (status_code carries the status, g_total follows from ax/ay/az and g_linear
+// keeps the magnitude of lin_*), then the latency stamps.
+static bool encodeSensorJson(String& jsonData, const SensorFrame& frame) {
+  StaticJsonDocument<640> doc;  // Increased to accommodate status message and latency stamps
   doc["type"] = "sensor_data";
-  doc["sequence"] = getNextSequenceNumber();
-  doc["timestamp"] = millis();
+  doc["sequence"] = frame.sequence;
+  doc["timestamp"] = (unsigned long)(frame.timeUs / 1000);  // ms; time_us has full resolution
+  doc["time_us"] = frame.timeUs;
+  int64_t epochUs;
+  if (deviceToPhoneTime(frame.timeUs, epochUs)) {
+    doc["epoch_us"] = epochUs;
+  }
   
   // Sensor data
   JsonObject sensor = doc.createNestedObject("sensor");
-  sensor["ax"] = ax;
-  sensor["ay"] = ay;
-  sensor["az"] = az;
-  sensor["roll"] = roll;
-  sensor["pitch"] = pitch;
-  sensor["tilt_detected"] = tiltDetected;
+  sensor["ax"] = frame.ax;
+  sensor["ay"] = frame.ay;
+  sensor["az"] = frame.az;
+  sensor["gx"] = frame.gx;
+  sensor["gy"] = frame.gy;
+  sensor["gz"] = frame.gz;
+  sensor["lin_ax"] = frame.linAx;
+  sensor["lin_ay"] = frame.linAy;
+  sensor["lin_az"] = frame.linAz;
+  sensor["g_total"] = frame.accelMagnitude;
+  sensor["g_linear"] = frame.linearMagnitude;
+  sensor["temp_c"] = frame.temperature;
+  sensor["accel_range_g"] = 2 << frame.accelRange;
+  sensor["roll"] = frame.roll;
+  sensor["pitch"] = frame.pitch;
+  sensor["yaw"] = frame.yaw;
+  sensor["tilt_detected"] = frame.tiltDetected;
   
   // Add status code if provided
-  if (statusCode >= 0) {
-    sensor["status_code"] = statusCode;
+  if (frame.statusCode >= 0) {
+    sensor["status_code"] = frame.statusCode;
   }
   
   // Add status message if provided
-  if (statusMessage != nullptr) {
-    sensor["status_message"] = statusMessage;
+  if (frame.statusMessage != nullptr) {
+    sensor["status_message"] = frame.statusMessage;
+  }
+  
+  // Add stage timestamps (microseconds) if enabled
+  if (frame.stamp != nullptr) {
+    stampLatency(frame.stamp, LAT_ENCODED);
+    JsonObject latency = doc.createNestedObject("latency_us");
+    latency["acquired"] = frame.stamp->us[LAT_ACQUIRED];
+    latency["filtered"] = frame.stamp->us[LAT_FILTERED] - frame.stamp->us[LAT_ACQUIRED];
+    latency["detected"] = frame.stamp->us[LAT_DETECTED] - frame.stamp->us[LAT_ACQUIRED];
+    latency["encoded"] = frame.stamp->us[LAT_ENCODED] - frame.stamp->us[LAT_ACQUIRED];
+  }
+  
+  static const char* const optionalFields[] = {"status_message", "g_total", "lin_ax", "lin_ay", "lin_az"};
+  uint8_t removed = 0;
+  bool trimmed = false;
+  while (measureJson(doc) + JSON_CRC_FIELD_SIZE > MAX_PACKET_SIZE) {
+    if (removed < sizeof(optionalFields) / sizeof(optionalFields[0])) {
+      sensor.remove(optionalFields[removed++]);
+    } else if (doc.containsKey("latency_us")) {
+      doc.remove("latency_us");
+    } else {
+      jsonFramesDropped++;
+      Serial.print("BLE ERROR: Sensor frame exceeds MAX_PACKET_SIZE after trimming (");
+      Serial.print(measureJson(doc) + JSON_CRC_FIELD_SIZE);
+      Serial.println(" bytes) - NOT SENDING");
+      return false;
+    }
+    trimmed = true;
+  }
+  if (trimmed) {
+    jsonFramesTrimmed++;
   }
   
   // Serialize JSON
-  String jsonData;
   serializeJson(doc, jsonData);
   
   // Calculate CRC
@@ -268,95 +681,651 @@ void sendSensorData(float ax, float ay, float az, float roll, float pitch, bool
   doc["crc"] = crc;
   jsonData = "";
   serializeJson(doc, jsonData);
+  return true;
+}
+
+// Clamp a microsecond offset into a u16 frame field
+static uint16_t latencyOffset(const LatencyStamp* stamp, LatencyStage stage) {
+  return (uint16_t)min((uint32_t)0xFFFF, stamp->us[stage] - stamp->us[LAT_ACQUIRED]);
+}
+
+// Encode a sensor sample as a binary frame (see BINARY_FRAME_SIZE); returns its length
+// Without extensions the frame is the fixed BINARY_FRAME_SIZE bytes.
+static size_t encodeSensorBinary(uint8_t* buf, const SensorFrame& frame, bool extensions) {
+  buf[0] = FRAME_TYPE_SENSOR;
+  buf[1] = (frame.tiltDetected ? 0x01 : 0x00) |
+           (frame.statusCode >= 0 ? (min(frame.statusCode, 3) << 1) : 0) |
+           ((frame.accelRange & 0x03) << FRAME_FLAG_RANGE_SHIFT);
+  putLE16(&buf[2], frame.sequence & 0xFFFF);
+  putLE48(&buf[4], frame.timeUs);
+  putLE16(&buf[10], (uint16_t)(int16_t)constrain(frame.ax * 1000.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[12], (uint16_t)(int16_t)constrain(frame.ay * 1000.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[14], (uint16_t)(int16_t)constrain(frame.az * 1000.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[16], (uint16_t)(int16_t)constrain(frame.gx * 10.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[18], (uint16_t)(int16_t)constrain(frame.gy * 10.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[20], (uint16_t)(int16_t)constrain(frame.gz * 10.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[22], (uint16_t)(int16_t)constrain(frame.temperature * 100.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[24], (uint16_t)(int16_t)constrain(frame.roll * 100.0f, -18000.0f, 18000.0f));
+  putLE16(&buf[26], (uint16_t)(int16_t)constrain(frame.pitch * 100.0f, -18000.0f, 18000.0f));
+  putLE16(&buf[28], (uint16_t)(int16_t)constrain(frame.linAx * 1000.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[30], (uint16_t)(int16_t)constrain(frame.linAy * 1000.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[32], (uint16_t)(int16_t)constrain(frame.linAz * 1000.0f, -32768.0f, 32767.0f));
+  putLE16(&buf[34], (uint16_t)constrain(frame.accelMagnitude * 1000.0f, 0.0f, 65535.0f));
+  putLE16(&buf[36], (uint16_t)constrain(frame.linearMagnitude * 1000.0f, 0.0f, 65535.0f));
+  size_t length = BINARY_FRAME_SIZE - 2;
   
-  // Check data size and warn if too large
-  if (jsonData.length() > MAX_PACKET_SIZE) {
-    Serial.print("BLE WARNING: Sensor data exceeds MAX_PACKET_SIZE (");
-    Serial.print(jsonData.length());
-    Serial.print(" > ");
-    Serial.print(MAX_PACKET_SIZE);
-    Serial.println(" bytes)");
+  int64_t epochUs;
+  if (extensions && deviceToPhoneTime(frame.timeUs, epochUs)) {
+    buf[1] |= FRAME_FLAG_EPOCH;
+    putLE64(&buf[length], (uint64_t)epochUs);
+    length += BINARY_EPOCH_EXT_SIZE;
   }
   
-  // Send via BLE with automatic chunking if needed
-  sendDataWithChunking(pSensorDataChar, jsonData);
+  if (extensions && frame.stamp != nullptr) {
+    stampLatency(frame.stamp, LAT_ENCODED);
+    buf[1] |= FRAME_FLAG_LATENCY;
+    putLE32(&buf[length], frame.stamp->us[LAT_ACQUIRED]);
+    putLE16(&buf[length + 4], latencyOffset(frame.stamp, LAT_FILTERED));
+    putLE16(&buf[length + 6], latencyOffset(frame.stamp, LAT_DETECTED));
+    putLE16(&buf[length + 8], latencyOffset(frame.stamp, LAT_ENCODED));
+    length += BINARY_LATENCY_EXT_SIZE;
+  }
+  
+  putLE16(&buf[length], calculateCRC16(buf, length));
+  return length + 2;
+}
+
+// Send sensor data with packet structure
+// Each encoding is produced at most once per sample and the same bytes are sent
+// to every subscribed client whose stream interval has elapsed. When a stamp is
+// given, every delivered frame is added to the latency histograms.
+void sendSensorData(SensorFrame& frame) {
+  if (connectionCount == 0 || pSensorDataChar == nullptr) {
+    return;
+  }
+  
+  unsigned long now = millis();
+  frame.sequence = streamSequence + 1;
+  
+  // The stamp always feeds the histograms; frames only carry it on request
+  LatencyStamp* stamp = frame.stamp;
+  if (!areLatencyStampsEnabled()) {
+    frame.stamp = nullptr;
+  }
+  
+  String jsonData;
+  bool jsonEncoded = false;
+  bool jsonValid = false;
+  uint8_t binaryFrame[BINARY_FRAME_SIZE + BINARY_EPOCH_EXT_SIZE + BINARY_LATENCY_EXT_SIZE];
+  size_t binaryLength = 0;
+  uint8_t baseFrame[BINARY_FRAME_SIZE];
+  size_t baseLength = 0;
+  bool sent = false;
+  
+  for (uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+    BLEConnectionState* conn = &connections[i];
+    if (!conn->active || !(conn->subscriptions & SUB_SENSOR_DATA)) {
+      continue;
+    }
+    portENTER_CRITICAL(&connStateMux);
+    uint8_t encoding = conn->encoding;
+    uint16_t intervalMs = conn->streamIntervalMs;
+    portEXIT_CRITICAL(&connStateMux);
+    if (conn->lastStreamTime != 0 && now - conn->lastStreamTime < intervalMs) {
+      continue;
+    }
+    
+    if (encoding == ENCODING_BINARY) {
+      // A notification carries at most MTU - 3 bytes; extensions that do not
+      // fit are left out for that client (SET_ENCODING ensures the base frame fits)
+      size_t capacity = conn->mtu - 3;
+      if (binaryLength == 0) {
+        binaryLength = encodeSensorBinary(binaryFrame, frame, true);
+        stampLatency(stamp, LAT_ENCODED);
+      }
+      stampLatency(stamp, LAT_QUEUED);
+      if (binaryLength <= capacity) {
+        sendToConnection(conn, pSensorDataChar, binaryFrame, binaryLength);
+      } else {
+        if (baseLength == 0) {
+          baseLength = encodeSensorBinary(baseFrame, frame, false);
+        }
+        sendToConnection(conn, pSensorDataChar, baseFrame, baseLength);
+      }
+    } else {
+      if (!jsonEncoded) {
+        jsonValid = encodeSensorJson(jsonData, frame);
+        stampLatency(stamp, LAT_ENCODED);
+        jsonEncoded = true;
+      }
+      if (!jsonValid) {
+        // Counted in jsonFramesDropped; the client's next frame is due a full interval later
+        conn->lastStreamTime = now;
+        continue;
+      }
+      stampLatency(stamp, LAT_QUEUED);
+      sendDataWithChunking(conn, pSensorDataChar, jsonData);
+    }
+    
+    if (stamp != nullptr) {
+      stampLatency(stamp, LAT_SENT);
+      recordLatency(*stamp);
+    }
+    
+    conn->lastStreamTime = now;
+    sent = true;
+  }
+  
+  // Sequence counts samples actually streamed, so gaps at a client reflect its own rate
+  if (sent) {
+    streamSequence = frame.sequence;
+  }
+  frame.stamp = stamp;
   
   // Reduced Serial output to save code space
   // Serial.print("BLE: Sensor [Seq: ");
-  // Serial.print(sequenceNumber);
+  // Serial.print(streamSequence);
   // Serial.println("]");
 }
 
 // Send device status
 void sendDeviceStatus(bool wifiConnected, int batteryLevel) {
-  if (!deviceConnected || pDeviceStatusChar == nullptr) {
+  if (connectionCount == 0 || pDeviceStatusChar == nullptr) {
+    return;
+  }
+  
+  for (uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+    BLEConnectionState* conn = &connections[i];
+    if (!conn->active || !(conn->subscriptions & SUB_DEVICE_STATUS)) {
+      continue;
+    }
+    
+    StaticJsonDocument<320> doc;
+    doc["type"] = "device_status";
+    doc["sequence"] = getNextSequenceNumber(conn);
+    doc["timestamp"] = millis();
+    
+    JsonObject status = doc.createNestedObject("status");
+    status["wifi_connected"] = wifiConnected;
+    status["battery_level"] = batteryLevel;
+    status["ble_connected"] = true;
+    status["ble_connections"] = connectionCount;
+    status["calibrated"] = isCalibrated();
+    status["aligned"] = isAligned();
+    status["sensor_health"] = getSensorHealthStatus();
+    
+    const I2CStats& i2c = getI2CStats();
+    JsonObject bus = status.createNestedObject("i2c");
+    bus["errors"] = i2c.errors;
+    bus["retries"] = i2c.retries;
+    bus["failures"] = i2c.failures;
+    bus["recoveries"] = i2c.busRecoveries;
+    bus["reinits"] = i2c.reinits;
+    
+    String jsonData;
+    serializeJson(doc, jsonData);
+    
+    // Calculate CRC
+    uint8_t* dataBytes = (uint8_t*)jsonData.c_str();
+    size_t dataLength = jsonData.length();
+    uint16_t crc = calculateCRC16(dataBytes, dataLength);
+    
+    doc["crc"] = crc;
+    jsonData = "";
+    serializeJson(doc, jsonData);
+    
+    // Check data size and warn if too large
+    if (jsonData.length() > MAX_PACKET_SIZE) {
+      Serial.print("BLE WARNING: Device status exceeds MAX_PACKET_SIZE (");
+      Serial.print(jsonData.length());
+      Serial.print(" > ");
+      Serial.print(MAX_PACKET_SIZE);
+      Serial.println(" bytes)");
+    }
+    
+    // Send via BLE with automatic chunking if needed
+    sendDataWithChunking(conn, pDeviceStatusChar, jsonData);
+  }
+  
+  // Reduced Serial output to save code space
+  // Serial.print("BLE: Status [Seq: ");
+  // Serial.print(sequenceNumber);
+  // Serial.println("]");
+}
+
+// Diagnostics sections, each sent as its own message
+enum DiagnosticsSection {
+  DIAG_LATENCY = 0,
+  DIAG_SENT_HIST,
+  DIAG_SAMPLING,
+  DIAG_FILTER,
+  DIAG_ORIENTATION,
+  DIAG_POWER,
+  DIAG_HEALTH,
+  DIAG_IMU,
+  DIAG_TIME_SYNC,
+  DIAG_STREAM,
+  DIAG_LOOP,
+  DIAG_BULK,
+  DIAG_SECTION_COUNT
+};
+
+static const char* const diagnosticsSectionNames[DIAG_SECTION_COUNT] = {
+  "latency", "sent_hist", "sampling", "filter", "orientation",
+  "power", "health", "imu", "time_sync", "stream", "loop", "bulk"
+};
+
+// Fill in one diagnostics section
+static void addDiagnosticsSection(JsonDocument& doc, uint8_t section) {
+  static const char* const stageNames[LATENCY_STAGE_COUNT] = {
+    "acquired", "filtered", "detected", "encoded", "queued", "sent"
+  };
+  const char* name = diagnosticsSectionNames[section];
+  
+  switch (section) {
+    case DIAG_LATENCY: {
+      JsonObject latency = doc.createNestedObject(name);
+      for (uint8_t stage = LAT_FILTERED; stage < LATENCY_STAGE_COUNT; stage++) {
+        const LatencyHistogram& h = getLatencyHistogram((LatencyStage)stage);
+        JsonArray summary = latency.createNestedArray(stageNames[stage]);
+        summary.add(h.count);
+        summary.add(h.minUs);
+        summary.add(h.count > 0 ? (uint32_t)(h.sumUs / h.count) : 0);
+        summary.add(getLatencyPercentile((LatencyStage)stage, 99));
+        summary.add(h.maxUs);
+      }
+      break;
+    }
+    
+    case DIAG_SENT_HIST: {
+      const LatencyHistogram& sent = getLatencyHistogram(LAT_SENT);
+      JsonArray hist = doc.createNestedArray(name);
+      for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        hist.add(sent.buckets[i]);
+      }
+      break;
+    }
+    
+    case DIAG_SAMPLING: {
+      const SampleTimingStats& timing = getSampleTimingStats();
+      JsonObject sampling = doc.createNestedObject(name);
+      sampling["mode"] = getAcquisitionMode();
+      sampling["rate_hz"] = getSampleRate();
+      sampling["dlpf_hz"] = getDlpfBandwidthHz();
+      sampling["interval_us"] = timing.meanIntervalUs;
+      sampling["jitter_us"] = getSampleJitterUs();
+      sampling["min_us"] = timing.minIntervalUs;
+      sampling["max_us"] = timing.maxIntervalUs;
+      sampling["missed"] = timing.missed;
+      sampling["fifo_overflows"] = getFifoOverflowCount();
+      break;
+    }
+    
+    case DIAG_FILTER: {
+      float measurement, estimate, process;
+      getAccelFilterNoise(measurement, estimate, process);
+      JsonObject filter = doc.createNestedObject(name);
+      filter["measurement"] = measurement;
+      filter["estimate"] = estimate;
+      filter["process"] = process;
+      break;
+    }
+    
+    case DIAG_ORIENTATION: {
+      const OrientationStats& fusion = getOrientationStats();
+      JsonObject orientation = doc.createNestedObject(name);
+      orientation["updates"] = fusion.updates;
+      orientation["avg_us"] = fusion.updates ? (float)fusion.totalUpdateUs / fusion.updates : 0.0f;
+      orientation["max_us"] = fusion.maxUpdateUs;
+      break;
+    }
+    
+    case DIAG_POWER: {
+      const PowerStats& power = getPowerStats();
+      JsonObject parking = doc.createNestedObject(name);
+      parking["parks"] = power.parks;
+      parking["wakes"] = power.wakes;
+      parking["wake_us"] = power.lastWakeLatencyUs;
+      parking["max_wake_us"] = power.maxWakeLatencyUs;
+      parking["duty"] = getParkedDutyCycle();
+      break;
+    }
+    
+    case DIAG_HEALTH: {
+      const SensorHealth& sensorHealth = getSensorHealth();
+      JsonObject healthInfo = doc.createNestedObject(name);
+      healthInfo["status"] = sensorHealth.status;
+      healthInfo["at_rest"] = sensorHealth.atRest;
+      healthInfo["gravity_g"] = sensorHealth.gravityG;
+      healthInfo["frozen_run"] = sensorHealth.frozenRun;
+      healthInfo["saturations"] = sensorHealth.saturationCount;
+      JsonArray noise = healthInfo.createNestedArray("noise");
+      for (uint8_t axis = 0; axis < HEALTH_AXES; axis++) {
+        noise.add(getAxisNoise(axis));
+      }
+      break;
+    }
+    
+    case DIAG_IMU: {
+      const ImuStats& imu = getImuStats();
+      JsonObject imuInfo = doc.createNestedObject(name);
+      imuInfo["present"] = imu.present;
+      imuInfo["active"] = imu.active;
+      imuInfo["fused"] = imu.fusedSamples;
+      imuInfo["single"] = imu.singleSamples;
+      imuInfo["disagreements"] = imu.disagreements;
+      imuInfo["skew_drops"] = imu.fifoSkewDrops;
+      imuInfo["dropouts"] = imu.dropouts;
+      break;
+    }
+    
+    case DIAG_TIME_SYNC: {
+      const TimeSyncStats& sync = getTimeSyncStats();
+      JsonObject syncInfo = doc.createNestedObject(name);
+      syncInfo["synced"] = sync.synced;
+      syncInfo["offset_us"] = sync.offsetUs;
+      syncInfo["drift_ppm"] = sync.driftPpm;
+      syncInfo["delay_us"] = sync.delayUs;
+      syncInfo["residual_us"] = sync.residualUs;
+      syncInfo["points"] = sync.points;
+      syncInfo["exchanges"] = sync.exchanges;
+      syncInfo["rejected"] = sync.rejected;
+      syncInfo["lost"] = sync.lost;
+      syncInfo["steps"] = sync.steps;
+      break;
+    }
+    
+    case DIAG_STREAM: {
+      JsonObject stream = doc.createNestedObject(name);
+      stream["trimmed"] = jsonFramesTrimmed;
+      stream["dropped"] = jsonFramesDropped;
+      break;
+    }
+    
+    case DIAG_LOOP: {
+      const LatencyHistogram& h = getLoopPassHistogram();
+      JsonArray summary = doc.createNestedArray(name);
+      summary.add(h.count);
+      summary.add(h.minUs);
+      summary.add(h.count > 0 ? (uint32_t)(h.sumUs / h.count) : 0);
+      summary.add(getHistogramPercentile(h, 99));
+      summary.add(h.maxUs);
+      break;
+    }
+    
+    case DIAG_BULK: {
+      const BulkTransferStats& bulkStats = getBulkTransferStats();
+      JsonObject bulk = doc.createNestedObject(name);
+      bulk["active"] = isBulkTransferActive();
+      bulk["id"] = bulkStats.transferId;
+      bulk["sent"] = bulkStats.bytesSent;
+      bulk["total"] = bulkStats.totalBytes;
+      bulk["bps"] = getBulkThroughput();
+      bulk["stalls"] = bulkStats.creditStalls;
+      bulk["abort"] = bulkStats.abortReason;
+      bulk["foreign"] = bulkStats.foreignControls;
+      bulk["recorder_bytes"] = getMotionRecorderBytes();
+      bulk["recorder_frozen"] = isMotionRecorderFrozen();
+      break;
+    }
+  }
+}
+
+// Send on-device diagnostics to one connection
+// The report is too large for one notification, so each section goes out as
+// its own "diagnostics" message carrying "part" and "parts" (1-based) and one
+// key named after the section. A section must fit the connection's MTU - 3
+// bytes; one that does not is logged and skipped, so the client sees the gap.
+// "latency" stages are reported as [count, min, avg, p99, max] in microseconds
+// from acquisition; "sent_hist" is the log2 histogram of end-to-end latency.
+// "sampling" reports the acquisition mode, rate and measured interval jitter.
+// "filter" reports the accel Kalman filter tuning.
+// "orientation" reports the cost of each fusion filter update.
+// "power" reports parked-mode wake-ups, wake latency and the awake fraction.
+// "health" reports the sensor health monitor: per-axis noise (ax..gz),
+// unchanged-sample runs, saturated samples and gravity magnitude at rest.
+// "imu" reports the redundant IMU pair: present/active bit masks (bit 0 =
+// 0x68, bit 1 = 0x69), fused and single-IMU samples, disagreements, FIFO
+// skew drops and dropouts.
+// "time_sync" reports the clock fit against the phone (see TimeSync.h).
+// "stream" counts JSON sensor frames trimmed or skipped to fit MAX_PACKET_SIZE.
+// "loop" is the busy time of a loop() pass, in the same form as a latency stage.
+// "bulk" reports the current or last bulk transfer (bytes, throughput in B/s,
+// credit stalls, abort reason, control packets from other clients) and the
+// pre-crash recorder.
+void sendDiagnostics(BLEConnectionState* conn) {
+  if (conn == nullptr || pConfigChar == nullptr) {
+    return;
+  }
+  
+  size_t limit = min((size_t)(conn->mtu - 3), (size_t)MAX_PACKET_SIZE);
+  for (uint8_t section = 0; section < DIAG_SECTION_COUNT; section++) {
+    StaticJsonDocument<768> doc;  // Largest section (latency) needs ~36 slots
+    doc["type"] = "diagnostics";
+    doc["sequence"] = getNextSequenceNumber(conn);
+    doc["timestamp"] = millis();
+    doc["part"] = section + 1;
+    doc["parts"] = DIAG_SECTION_COUNT;
+    addDiagnosticsSection(doc, section);
+    
+    // A field added to a section must keep it within the document and the MTU
+    size_t length = measureJson(doc);
+    if (doc.overflowed() || length > limit) {
+      Serial.print("BLE ERROR: Diagnostics section '");
+      Serial.print(diagnosticsSectionNames[section]);
+      Serial.print("' does not fit (");
+      Serial.print(length);
+      Serial.print(" > ");
+      Serial.print(limit);
+      Serial.println(" bytes) - NOT SENDING");
+      continue;
+    }
+    
+    String jsonData;
+    serializeJson(doc, jsonData);
+    sendDataWithChunking(conn, pConfigChar, jsonData);
+  }
+}
+
+// Send the calibration state, and the coefficients in use once a capture is done
+void sendCalibrationReport(BLEConnectionState* conn) {
+  if (conn == nullptr || pConfigChar == nullptr) {
     return;
   }
   
-  StaticJsonDocument<128> doc;  // Reduced from 256
-  doc["type"] = "device_status";
-  doc["sequence"] = getNextSequenceNumber();
+  static const char* const stateNames[] = {"idle", "collecting", "done", "failed"};
+  const CalibrationStatus& status = getCalibrationStatus();
+  
+  StaticJsonDocument<512> doc;
+  doc["type"] = "calibration";
+  doc["sequence"] = getNextSequenceNumber(conn);
   doc["timestamp"] = millis();
+  doc["state"] = stateNames[status.state];
+  doc["mode"] = status.mode;
+  doc["progress"] = status.progress;
+  doc["samples"] = status.samples;
+  doc["positions"] = status.positions;
+  doc["calibrated"] = isCalibrated();
+  doc["thermal"] = isThermallyCompensated();
   
-  JsonObject status = doc.createNestedObject("status");
-  status["wifi_connected"] = wifiConnected;
-  status["battery_level"] = batteryLevel;
-  status["ble_connected"] = true;
+  if (status.state == CALIB_STATE_FAILED && status.error != nullptr) {
+    doc["error"] = status.error;
+  } else if (status.state == CALIB_STATE_DONE && status.mode == CALIB_MODE_THERMAL) {
+    const ThermalModel& model = getThermalModel();
+    doc["ref_temp_c"] = model.refTempC;
+    JsonArray slope = doc.createNestedArray("thermal_slope");
+    JsonArray curve = doc.createNestedArray("thermal_curve");
+    for (uint8_t i = 0; i < 3; i++) {
+      slope.add(model.slope[i]);
+      curve.add(model.curve[i]);
+    }
+  } else if (status.state == CALIB_STATE_DONE) {
+    const CalibrationCoefficients& c = getCalibration();
+    JsonArray accelBias = doc.createNestedArray("accel_bias");
+    JsonArray accelScale = doc.createNestedArray("accel_scale");
+    JsonArray gyroBias = doc.createNestedArray("gyro_bias");
+    for (uint8_t i = 0; i < 3; i++) {
+      accelBias.add(c.accelBias[i]);
+      accelScale.add(c.accelScale[i]);
+      gyroBias.add(c.gyroBias[i]);
+    }
+  }
   
   String jsonData;
   serializeJson(doc, jsonData);
+  sendDataWithChunking(conn, pConfigChar, jsonData);
+}
+
+// Send the mounting alignment state, and the rotation matrix once it is learned
+void sendAlignmentReport(BLEConnectionState* conn) {
+  if (conn == nullptr || pConfigChar == nullptr) {
+    return;
+  }
   
-  // Calculate CRC
-  uint8_t* dataBytes = (uint8_t*)jsonData.c_str();
-  size_t dataLength = jsonData.length();
-  uint16_t crc = calculateCRC16(dataBytes, dataLength);
+  static const char* const stateNames[] = {"idle", "level", "forward", "done", "failed"};
+  const AlignmentStatus& status = getAlignmentStatus();
   
-  doc["crc"] = crc;
-  jsonData = "";
-  serializeJson(doc, jsonData);
+  StaticJsonDocument<512> doc;
+  doc["type"] = "alignment";
+  doc["sequence"] = getNextSequenceNumber(conn);
+  doc["timestamp"] = millis();
+  doc["state"] = stateNames[status.state];
+  doc["progress"] = status.progress;
+  doc["forward_samples"] = status.forwardSamples;
+  doc["aligned"] = isAligned();
   
-  // Check data size and warn if too large
-  if (jsonData.length() > MAX_PACKET_SIZE) {
-    Serial.print("BLE WARNING: Device status exceeds MAX_PACKET_SIZE (");
-    Serial.print(jsonData.length());
-    Serial.print(" > ");
-    Serial.print(MAX_PACKET_SIZE);
-    Serial.println(" bytes)");
+  if (status.state == ALIGN_STATE_FAILED && status.error != nullptr) {
+    doc["error"] = status.error;
+  } else if (status.state == ALIGN_STATE_DONE) {
+    const AlignmentMatrix& m = getAlignment();
+    JsonArray matrix = doc.createNestedArray("matrix");
+    for (uint8_t row = 0; row < 3; row++) {
+      for (uint8_t col = 0; col < 3; col++) {
+        matrix.add(m.r[row][col]);
+      }
+    }
   }
   
-  // Send via BLE with automatic chunking if needed
-  sendDataWithChunking(pDeviceStatusChar, jsonData);
+  String jsonData;
+  serializeJson(doc, jsonData);
+  sendDataWithChunking(conn, pConfigChar, jsonData);
+}
+
+// Send the factory self-test result of every IMU that was tested
+// "deviation" is the response vs factory trim per axis (ax..gz, 0.1 = 10 %
+// high, null without trim); "failed_axes" has a bit per axis in that order
+// and "untested_axes" one per axis without a factory trim, which cannot fail.
+void sendSelfTestReport(BLEConnectionState* conn) {
+  if (conn == nullptr || pConfigChar == nullptr) {
+    return;
+  }
   
-  // Reduced Serial output to save code space
-  // Serial.print("BLE: Status [Seq: ");
-  // Serial.print(sequenceNumber);
-  // Serial.println("]");
+  StaticJsonDocument<768> doc;
+  doc["type"] = "self_test";
+  doc["sequence"] = getNextSequenceNumber(conn);
+  doc["timestamp"] = millis();
+  doc["failed"] = isSelfTestFailed();
+  
+  JsonArray imus = doc.createNestedArray("imus");
+  for (uint8_t i = 0; i < IMU_COUNT; i++) {
+    const ImuSelfTest& result = getSelfTestResult(i);
+    if (!result.ran) {
+      continue;
+    }
+    JsonObject imu = imus.createNestedObject();
+    imu["address"] = getImuAddress(i);
+    imu["passed"] = result.passed;
+    imu["failed_axes"] = result.failedAxes;
+    imu["untested_axes"] = result.untestedAxes;
+    JsonArray deviation = imu.createNestedArray("deviation");
+    for (uint8_t axis = 0; axis < IMU_SELF_TEST_AXES; axis++) {
+      deviation.add(result.deviation[axis]);
+    }
+  }
+  
+  String jsonData;
+  serializeJson(doc, jsonData);
+  sendDataWithChunking(conn, pConfigChar, jsonData);
 }
 
-// Process received commands
-void processBluetoothCommands() {
-  if (!commandReceived || receivedCommand.length() == 0) {
+static void beginProcedureReport(ProcedureReport& report, BLEConnectionState* conn) {
+  report.connId = conn->connId;
+  report.state = 0xFF;           // Always report the first state seen
+  report.step = 0;
+}
+
+// Report to the waiting client whenever the state changes or progress crosses
+// a PROCEDURE_REPORT_STEP boundary, until the procedure is no longer running
+static void serviceProcedureReport(ProcedureReport& report, uint8_t state, uint8_t progress,
+                                   bool running, void (*send)(BLEConnectionState*)) {
+  if (report.connId < 0) {
     return;
   }
   
-  commandReceived = false;
+  BLEConnectionState* conn = getConnectionState(report.connId);
+  if (conn == nullptr) {
+    report.connId = -1;
+    return;
+  }
+  
+  uint8_t step = progress / PROCEDURE_REPORT_STEP;
+  if (state == report.state && step == report.step) {
+    return;
+  }
+  report.state = state;
+  report.step = step;
+  send(conn);
+  
+  if (!running) {
+    report.connId = -1;
+  }
+}
+
+// Report calibration and alignment progress (call from loop)
+static void serviceProcedureReports() {
+  const CalibrationStatus& calibration = getCalibrationStatus();
+  serviceProcedureReport(calibrationReport, calibration.state, calibration.progress,
+                         calibration.state == CALIB_STATE_COLLECTING, sendCalibrationReport);
+  
+  const AlignmentStatus& alignment = getAlignmentStatus();
+  serviceProcedureReport(alignmentReport, alignment.state, alignment.progress,
+                         alignment.state == ALIGN_STATE_LEVEL || alignment.state == ALIGN_STATE_FORWARD,
+                         sendAlignmentReport);
+}
+
+// Process a command received from one connection
+static void processConnectionCommand(BLEConnectionState* conn) {
+  conn->commandReceived = false;
+  String command = conn->pendingCommand;
+  conn->pendingCommand = "";
   
   // Parse JSON command
-  StaticJsonDocument<128> cmdDoc;  // Reduced from 256
-  DeserializationError error = deserializeJson(cmdDoc, receivedCommand);
+  StaticJsonDocument<192> cmdDoc;  // Room for the optional "id" field
+  DeserializationError error = deserializeJson(cmdDoc, command);
   
   if (error) {
     // Serial.print("BLE: Parse error - ");
     // Serial.println(error.c_str());
-    sendErrorResponse(BLE_ERROR_INVALID_DATA, "Invalid JSON format");
-    receivedCommand = "";
+    sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Invalid JSON format");
     return;
   }
   
+  executeCommand(conn, cmdDoc);
+}
+
+// Commands that are cheap, never block and only touch flags or per-connection
+// state - safe to execute directly from the BLE write callback
+static bool isFastPathCommand(uint8_t cmdType) {
+  return cmdType == CMD_ACK_ALERT ||
+         cmdType == CMD_SET_STREAM_RATE ||
+         cmdType == CMD_SET_ENCODING;
+}
+
+// Execute a parsed command and send the response to the issuing connection
+static void executeCommand(BLEConnectionState* conn, JsonDocument& cmdDoc) {
   // Extract command type
   if (!cmdDoc.containsKey("command")) {
-    sendErrorResponse(BLE_ERROR_INVALID_CMD, "Missing command field");
-    receivedCommand = "";
+    sendErrorResponse(conn, BLE_ERROR_INVALID_CMD, "Missing command field");
     return;
   }
   
@@ -402,28 +1371,197 @@ void processBluetoothCommands() {
       ESP.restart();
       break;
       
-    case CMD_CALIBRATE_SENSOR:
+    case CMD_CALIBRATE_SENSOR: {
       cmdName = "CALIBRATE_SENSOR";
       // Serial.println("BLE: CALIBRATE_SENSOR");
-      // TODO: Implement sensor calibration
+      int mode = cmdDoc["value"] | CALIB_MODE_BIAS;
+      long defaultDuration = mode == CALIB_MODE_THERMAL ? CALIB_THERMAL_DEFAULT_DURATION_MS : CALIB_DEFAULT_DURATION_MS;
+      long duration = cmdDoc["duration_ms"] | defaultDuration;
+      duration = max(duration, 0L);  // startCalibration() clamps to the mode's limits
+      if (mode < CALIB_MODE_BIAS || mode > CALIB_MODE_THERMAL) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Unknown calibration mode");
+        return;
+      }
+      if (!startCalibration(mode, duration)) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_CMD, "Calibration already running");
+        return;
+      }
+      // Progress and result follow as "calibration" messages
+      beginProcedureReport(calibrationReport, conn);
+      break;
+    }
+      
+    case CMD_ALIGN_MOUNT: {
+      cmdName = "ALIGN_MOUNT";
+      int mode = cmdDoc["value"] | ALIGN_MODE_START;
+      if (mode != ALIGN_MODE_START && mode != ALIGN_MODE_CLEAR) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Unknown alignment mode");
+        return;
+      }
+      if (!startAlignment(mode)) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_CMD, "Alignment already running");
+        return;
+      }
+      // Progress and result follow as "alignment" messages
+      beginProcedureReport(alignmentReport, conn);
+      break;
+    }
+      
+    case CMD_SET_ENCODING: {
+      cmdName = "SET_ENCODING";
+      int encoding = cmdDoc["value"] | -1;
+      if (encoding != ENCODING_JSON && encoding != ENCODING_BINARY) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Unsupported encoding");
+        return;
+      }
+      // Binary frames are never split - the link must carry one in a notification
+      if (encoding == ENCODING_BINARY && conn->mtu - 3 < BINARY_FRAME_SIZE) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "MTU too small for binary encoding");
+        return;
+      }
+      portENTER_CRITICAL(&connStateMux);
+      conn->encoding = encoding;
+      portEXIT_CRITICAL(&connStateMux);
+      break;
+    }
+      
+    case CMD_SET_STREAM_RATE: {
+      cmdName = "SET_STREAM_RATE";
+      // Value is the stream interval in milliseconds
+      long interval = cmdDoc["value"] | 0L;
+      if (interval < BLE_MIN_STREAM_INTERVAL_MS || interval > 0xFFFF) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Stream interval out of range");
+        return;
+      }
+      portENTER_CRITICAL(&connStateMux);
+      conn->streamIntervalMs = interval;
+      portEXIT_CRITICAL(&connStateMux);
+      break;
+    }
+      
+    case CMD_ACK_ALERT:
+      cmdName = "ACK_ALERT";
+      alertAcknowledged = true;
+      break;
+      
+    case CMD_SET_LATENCY_STAMPS:
+      cmdName = "SET_LATENCY_STAMPS";
+      setLatencyStampsEnabled(cmdDoc["value"] | false);
+      if (cmdDoc["reset"] | false) {
+        resetLatencyStats();
+      }
+      break;
+      
+    case CMD_GET_DIAGNOSTICS:
+      cmdName = "GET_DIAGNOSTICS";
+      // Diagnostics follow the command response
+      break;
+      
+    case CMD_SET_FILTER_NOISE: {
+      cmdName = "SET_FILTER_NOISE";
+      float measurement, estimate, process;
+      getAccelFilterNoise(measurement, estimate, process);
+      measurement = cmdDoc["measurement"] | measurement;
+      estimate = cmdDoc["estimate"] | estimate;
+      process = cmdDoc["process"] | process;
+      if (!setAccelFilterNoise(measurement, estimate, process)) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Filter noise out of range");
+        return;
+      }
+      break;
+    }
+      
+    case CMD_SET_ACCEL_RANGE: {
+      cmdName = "SET_ACCEL_RANGE";
+      if (cmdDoc["auto"] | false) {
+        setAccelAutoRange(true);
+        break;
+      }
+      int rangeG = cmdDoc["value"] | -1;
+      uint8_t range = 0;
+      while (range < ACCEL_RANGE_16G && (2 << range) != rangeG) {
+        range++;
+      }
+      if ((2 << range) != rangeG) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Unsupported accel range");
+        return;
+      }
+      setAccelRange(range);
+      break;
+    }
+      
+    case CMD_SET_SAMPLING: {
+      cmdName = "SET_SAMPLING";
+      long rateHz = cmdDoc["rate_hz"] | (long)getConfiguredSampleRate();
+      uint8_t dlpf = getConfiguredDlpf();
+      if (cmdDoc.containsKey("dlpf_hz")) {
+        long bandwidthHz = cmdDoc["dlpf_hz"] | -1L;
+        if (bandwidthHz < 0 || bandwidthHz > UINT16_MAX || !dlpfModeForBandwidth(bandwidthHz, dlpf)) {
+          sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Unsupported DLPF bandwidth");
+          return;
+        }
+      }
+      if (rateHz < MIN_SAMPLE_RATE_HZ || rateHz > MAX_SAMPLE_RATE_HZ ||
+          !setSamplingConfig(rateHz, dlpf)) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Sample rate out of range");
+        return;
+      }
+      break;
+    }
+      
+    case CMD_TIME_SYNC:
+      cmdName = "TIME_SYNC";
+      if (cmdDoc.containsKey("t2")) {
+        handleTimeSyncAnswer(conn, cmdDoc);
+        return;
+      }
+      conn->timeSync = cmdDoc["value"] | true;
+      break;
+      
+    case CMD_BULK_READ:
+      cmdName = "BULK_READ";
+      if (isBulkTransferActive()) {
+        sendErrorResponse(conn, BLE_ERROR_BUSY, "Bulk transfer already running");
+        return;
+      }
+      if (!(conn->subscriptions & SUB_BULK_DATA)) {
+        sendErrorResponse(conn, BLE_ERROR_INVALID_DATA, "Not subscribed to bulk data");
+        return;
+      }
+      if (!startRecorderTransfer(conn)) {
+        return;  // Error already sent
+      }
+      break;
+      
+    case CMD_SELF_TEST:
+      cmdName = "SELF_TEST";
+      if (!runMPUSelfTest()) {
+        sendErrorResponse(conn, BLE_ERROR_NOT_CONNECTED, "Sensor not available for self-test");
+        return;
+      }
       break;
       
     default:
       cmdName = "UNKNOWN";
       // Serial.print("BLE: Unknown cmd 0x");
       // Serial.println(cmdType, HEX);
-      sendErrorResponse(BLE_ERROR_INVALID_CMD, "Unknown command type");
-      receivedCommand = "";
+      sendErrorResponse(conn, BLE_ERROR_INVALID_CMD, "Unknown command type");
       return;
   }
   
   // Send success response
-  StaticJsonDocument<128> responseDoc;  // Reduced from 256
+  StaticJsonDocument<192> responseDoc;  // Room for the echoed "id" field
   responseDoc["type"] = "command_response";
   responseDoc["command"] = cmdType;
+  
+  // Echo the client's request ID so write-without-response commands can be
+  // matched to their acknowledgement
+  if (cmdDoc.containsKey("id")) {
+    responseDoc["id"] = cmdDoc["id"].as<uint32_t>();
+  }
   responseDoc["command_name"] = cmdName;
   responseDoc["status"] = "success";
-  responseDoc["sequence"] = getNextSequenceNumber();
+  responseDoc["sequence"] = getNextSequenceNumber(conn);
   responseDoc["timestamp"] = millis();
   
   String responseJson;
@@ -439,30 +1577,152 @@ void processBluetoothCommands() {
   
   if (pConfigChar != nullptr) {
     // Send via BLE with automatic chunking if needed
-    sendDataWithChunking(pConfigChar, responseJson);
+    sendDataWithChunking(conn, pConfigChar, responseJson);
     // Reduced Serial output
     // Serial.print("BLE: Cmd ");
     // Serial.print(cmdName);
     // Serial.println(" OK");
   }
   
-  receivedCommand = "";
+  if (cmdType == CMD_GET_DIAGNOSTICS) {
+    sendDiagnostics(conn);
+  } else if (cmdType == CMD_SELF_TEST) {
+    sendSelfTestReport(conn);
+  }
+}
+
+// Count one request of the burst as done; fold the burst in after the last
+// one, otherwise schedule the next at a random point of the spread
+static void advanceTimeSyncBurst(unsigned long now) {
+  if (++timeSyncBurstCount < TIME_SYNC_BURST) {
+    timeSyncNextMs = now + random(TIME_SYNC_SPREAD_MS);
+    return;
+  }
+  endTimeSyncBurst();
+  timeSyncBurstActive = false;
+}
+
+// Send a time-sync request; t1 is taken once the notification is queued
+static void sendTimeSyncRequest(BLEConnectionState* conn) {
+  StaticJsonDocument<96> doc;
+  doc["type"] = "time_sync";
+  doc["seq"] = ++timeSyncSeq;
+  
+  String requestJson;
+  serializeJson(doc, requestJson);
+  doc["crc"] = calculateCRC16((uint8_t*)requestJson.c_str(), requestJson.length());
+  requestJson = "";
+  serializeJson(doc, requestJson);
+  
+  sendDataWithChunking(conn, pConfigChar, requestJson);
+  timeSyncT1 = esp_timer_get_time();
+  timeSyncSentMs = millis();
+}
+
+// Match a client's answer to the outstanding request; t4 is when its write
+// arrived in the BLE callback, not when loop() got to it
+static void handleTimeSyncAnswer(BLEConnectionState* conn, JsonDocument& cmdDoc) {
+  long seq = cmdDoc["seq"] | -1L;
+  if (timeSyncT1 == 0 || !conn->timeSync || seq != timeSyncSeq) {
+    return;  // Late or stray - its request was already counted as lost
+  }
+  addTimeSyncExchange(timeSyncT1, cmdDoc["t2"].as<int64_t>(), cmdDoc["t3"].as<int64_t>(),
+                      conn->commandReceivedUs);
+  timeSyncT1 = 0;
+  advanceTimeSyncBurst(millis());
+}
+
+// Run time-sync bursts with the first client that asked to be the reference
+// and listens on the config characteristic
+static void serviceTimeSync() {
+  BLEConnectionState* conn = nullptr;
+  for (uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+    if (connections[i].active && connections[i].timeSync && (connections[i].subscriptions & SUB_CONFIG)) {
+      conn = &connections[i];
+      break;
+    }
+  }
+  
+  unsigned long now = millis();
+  if (timeSyncT1 != 0 && (conn == nullptr || now - timeSyncSentMs >= TIME_SYNC_REPLY_TIMEOUT_MS)) {
+    timeSyncT1 = 0;
+    noteTimeSyncLost();
+    advanceTimeSyncBurst(now);
+  }
+  if (conn == nullptr) {
+    // Keep what the burst got; frames stay stamped from the fitted drift
+    if (timeSyncBurstActive) {
+      endTimeSyncBurst();
+      timeSyncBurstActive = false;
+    }
+    return;
+  }
+  if (timeSyncT1 != 0) {
+    return;
+  }
+  
+  if (!timeSyncBurstActive) {
+    unsigned long interval = getTimeSyncStats().points < TIME_SYNC_MIN_POINTS ?
+                             TIME_SYNC_FAST_INTERVAL_MS : TIME_SYNC_INTERVAL_MS;
+    if (lastTimeSyncBurstMs != 0 && now - lastTimeSyncBurstMs < interval) {
+      return;
+    }
+    lastTimeSyncBurstMs = now;
+    timeSyncBurstActive = true;
+    timeSyncBurstCount = 0;
+    timeSyncNextMs = now + random(TIME_SYNC_SPREAD_MS);
+  }
+  if ((long)(now - timeSyncNextMs) >= 0) {
+    sendTimeSyncRequest(conn);
+  }
+}
+
+// Process received commands
+void processBluetoothCommands() {
+  for (uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+    BLEConnectionState* conn = &connections[i];
+    if (conn->active && conn->commandReceived && conn->pendingCommand.length() > 0) {
+      processConnectionCommand(conn);
+    }
+  }
 }
 
 // Handle reconnection (should be called in loop)
 void handleBluetoothReconnection() {
-  // Disconnecting
-  if (!deviceConnected && oldDeviceConnected) {
-    delay(500);
-    pServer->startAdvertising();
-    oldDeviceConnected = deviceConnected;
+  // The stack stops advertising on every new connection - keep advertising
+  // while another client can still connect. After a disconnect the restart
+  // waits for the stack to clean up the closed link without stalling loop().
+  if (connectionCount != oldConnectionCount) {
+    if (connectionCount < oldConnectionCount) {
+      readvertisePending = true;
+      disconnectTime = millis();
+    } else if (connectionCount < BLE_MAX_CONNECTIONS) {
+      pServer->startAdvertising();
+    }
+    oldConnectionCount = connectionCount;
+  }
+  if (readvertisePending && millis() - disconnectTime >= BLE_READVERTISE_DELAY_MS) {
+    readvertisePending = false;
+    if (connectionCount < BLE_MAX_CONNECTIONS) {
+      pServer->startAdvertising();
+    }
   }
   
-  // Connecting
-  if (deviceConnected && !oldDeviceConnected) {
-    oldDeviceConnected = deviceConnected;
+  // Expire crash beacon, or stop it once a client has acknowledged the alert
+  if (alertAcknowledged) {
+    alertAcknowledged = false;
+    stopCrashBeacon();
+  }
+  if (crashBeaconActive && millis() - crashBeaconStartTime >= BEACON_DURATION_MS) {
+    stopCrashBeacon();
   }
   
   // Process any received commands
   processBluetoothCommands();
+  serviceProcedureReports();
+  serviceTimeSync();
+  
+  // Continue any bulk transfer within the client's credit window
+  serviceBulkTransfer();
+  serviceRecorderTransfer();
 }
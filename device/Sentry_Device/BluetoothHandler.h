@@ -6,12 +6,24 @@
 #include <BLEUtils.h>
 #include <BLE2902.h>
 #include <ArduinoJson.h>
+#include "BulkTransfer.h"
+#include "LatencyStats.h"
+#include "MotionRecorder.h"
+#include "PacketCodec.h"
+#include "MPU6050Handler.h"
+#include "OrientationFilter.h"
+#include "Calibration.h"
+#include "Alignment.h"
+#include "PowerManager.h"
+#include "SensorHealth.h"
+#include "TimeSync.h"
 
 // BLE Service and Characteristic UUIDs
 #define SERVICE_UUID              "0000ff00-0000-1000-8000-00805f9b34fb"
 #define CHAR_SENSOR_DATA_UUID     "0000ff01-0000-1000-8000-00805f9b34fb"
 #define CHAR_CONFIG_UUID           "0000ff03-0000-1000-8000-00805f9b34fb"
 #define CHAR_DEVICE_STATUS_UUID    "0000ff04-0000-1000-8000-00805f9b34fb"
+#define CHAR_BULK_DATA_UUID        "0000ff05-0000-1000-8000-00805f9b34fb"
 
 // Error Codes
 #define BLE_ERROR_NONE             0x00
@@ -20,20 +32,65 @@
 #define BLE_ERROR_CHECKSUM_FAIL    0x03
 #define BLE_ERROR_NOT_CONNECTED    0x04
 #define BLE_ERROR_BUFFER_FULL      0x05
+#define BLE_ERROR_BUSY             0x06
 #define BLE_ERROR_UNKNOWN          0xFF
 
 // Command Types
+// Commands may be written with or without response. CMD_ACK_ALERT,
+// CMD_SET_STREAM_RATE and CMD_SET_ENCODING are executed as soon as they are
+// received; an optional numeric "id" field is echoed in the command_response.
+// CMD_SET_LATENCY_STAMPS: "value" true/false adds stage timestamps to sensor
+// frames, "reset": true clears the latency histograms.
+// CMD_GET_DIAGNOSTICS: a "diagnostics" message follows the command_response.
+// CMD_SET_FILTER_NOISE: "measurement", "estimate" and "process" retune the
+// accel Kalman filter (raw counts); omitted fields keep their current value.
+// CMD_CALIBRATE_SENSOR: "value" is a CALIB_MODE_*, "duration_ms" the capture
+// window (CALIB_MODE_THERMAL: minutes, across a temperature change);
+// "calibration" messages report progress and the result.
+// CMD_ALIGN_MOUNT: "value" ALIGN_MODE_START learns the sensor-to-vehicle
+// rotation (park, then accelerate straight), ALIGN_MODE_CLEAR drops it;
+// "alignment" messages report progress and the result.
+// CMD_SET_ACCEL_RANGE: "value" 2/4/8/16 fixes the accel full-scale range in g,
+// "auto": true switches between ±2 g and ±16 g with the motion level.
+// CMD_SET_SAMPLING: "rate_hz" sets the sensor output data rate, "dlpf_hz" the
+// low-pass bandwidth (188/98/42/20/10/5, 0 = follow the rate); both are kept
+// across reboots and omitted fields keep their current value.
+// CMD_SELF_TEST: runs the sensor factory self-test (~150 ms, keep the device
+// still); a "self_test" message with per-axis results follows the response.
+// CMD_TIME_SYNC: "value" true makes this client the time reference. The
+// device then sends {"type":"time_sync","seq":n} requests in bursts; the
+// client answers each with CMD_TIME_SYNC, the same "seq", and "t2"/"t3" =
+// its Unix time in µs on receipt and on reply, replying after a random
+// 0..TIME_SYNC_SPREAD_MS delay. Answers get no command_response. Once synced,
+// sensor frames also carry the sample time on the client's clock.
+// CMD_BULK_READ: streams the pre-crash recorder window (see MotionRecorder.h)
+// over the bulk data characteristic, which the client must have subscribed
+// to. BLE_ERROR_BUSY while another transfer runs or when the stack cannot take
+// the START packet; credits and aborts are only taken from the client that
+// started it.
 #define CMD_GET_STATUS             0x01
 #define CMD_SET_WIFI_SSID         0x02
 #define CMD_SET_WIFI_PASSWORD     0x03
 #define CMD_SET_API_ENDPOINT      0x04
 #define CMD_RESET_DEVICE          0x05
 #define CMD_CALIBRATE_SENSOR      0x06
+#define CMD_SET_ENCODING          0x07
+#define CMD_SET_STREAM_RATE       0x08
+#define CMD_ACK_ALERT             0x09
+#define CMD_SET_LATENCY_STAMPS    0x0A
+#define CMD_GET_DIAGNOSTICS       0x0B
+#define CMD_SET_FILTER_NOISE      0x0C
+#define CMD_SET_ACCEL_RANGE       0x0D
+#define CMD_ALIGN_MOUNT           0x0E
+#define CMD_SET_SAMPLING          0x0F
+#define CMD_SELF_TEST             0x10
+#define CMD_TIME_SYNC             0x11
+#define CMD_BULK_READ             0x12
 
 // Packet Structure Constants
 #define PACKET_HEADER_SIZE         4
 #define MAX_PACKET_SIZE            512
-#define CRC_POLYNOMIAL             0x1021
+#define JSON_CRC_FIELD_SIZE        12     // ,"crc":65535 appended after the CRC is taken
 
 // BLE MTU and Chunking Constants
 #define BLE_MTU_REQUEST            512    // Requested MTU size
@@ -41,23 +98,137 @@
 #define BLE_CHUNK_SIZE             20     // Safe chunk size for fallback (default BLE limit)
 #define BLE_CHUNK_DELAY_MS         5      // Delay between chunks in milliseconds
 
+// Multi-Connection Constants
+#define BLE_MAX_CONNECTIONS        3      // Matches the ESP32 controller's default BLE link limit
+#define BLE_DEFAULT_STREAM_INTERVAL_MS 2500 // Sensor stream interval per connection
+#define BLE_MIN_STREAM_INTERVAL_MS 20     // Fastest stream rate a client may request
+                                          // (the fastest subscribed one sets the stream decimation)
+#define BLE_READVERTISE_DELAY_MS   500    // Let the stack clean up a closed link before advertising
+
+// Subscription Flags (client enabled notifications on the characteristic)
+#define SUB_SENSOR_DATA            0x01
+#define SUB_CONFIG                 0x02
+#define SUB_DEVICE_STATUS          0x04
+#define SUB_BULK_DATA              0x08
+
+// Stream Encodings
+#define ENCODING_JSON              0x00   // JSON text (default)
+#define ENCODING_BINARY            0x01   // Fixed-size binary frame, needs an MTU of at least 43
+
+// Binary Sensor Frame (little-endian)
+// A client can select it once the MTU carries the 40-byte base frame; the
+// optional extensions are only included when its MTU leaves room for them.
+//   [0]     frame type (FRAME_TYPE_SENSOR)
+//   [1]     flags: bit 0 = tilt detected, bits 1-2 = MPU status code
+//           (3 = any health fault, see the JSON status_code),
+//           bit 3 = latency stamps present, bits 4-5 = accel range (±2 g << n),
+//           bit 6 = phone time present
+//   [2-3]   stream sequence (low 16 bits)
+//   [4-9]   sample time in microseconds since boot (u48, wraps after 8.9 years)
+//   [10-15] ax, ay, az in milli-g (int16)
+//   [16-21] gx, gy, gz in tenths of a degree per second (int16)
+//   [22-23] die temperature in hundredths of a degree Celsius (int16)
+//   [24-27] roll, pitch in hundredths of a degree (int16)
+//   [28-33] linear (gravity-free) ax, ay, az in milli-g (int16)
+//   [34-35] |a| including gravity in milli-g (uint16)
+//   [36-37] |linear a| in milli-g (uint16)
+//   [+8]    optional sample time on the phone's clock, Unix microseconds (int64)
+//   [+10]   optional latency stamps: acquired (micros, u32), then filtered,
+//           detected and encoded as u16 microsecond offsets from acquired
+//   [last 2] CRC-16 of all preceding bytes
+#define FRAME_TYPE_SENSOR          0x01
+#define FRAME_FLAG_LATENCY         0x08
+#define FRAME_FLAG_RANGE_SHIFT     4
+#define FRAME_FLAG_EPOCH           0x40
+#define BINARY_FRAME_SIZE          40
+#define BINARY_EPOCH_EXT_SIZE      8
+#define BINARY_LATENCY_EXT_SIZE    10
+
+// One processed sample as streamed to clients
+struct SensorFrame {
+  uint32_t sequence;             // Set by sendSensorData()
+  uint64_t timeUs;               // Acquisition time of the values (MotionSample clock)
+  float ax, ay, az;              // g, decimated to the stream rate
+  float gx, gy, gz;              // °/s, decimated to the stream rate
+  float linAx, linAy, linAz;     // g with gravity removed (vehicle frame once aligned)
+  float accelMagnitude;          // |a| in g, gravity included
+  float linearMagnitude;         // |linear a| in g - what impact thresholds should use
+  float temperature;             // °C
+  uint8_t accelRange;            // ACCEL_RANGE_* in effect
+  float roll, pitch, yaw;        // degrees (yaw is relative to the heading at boot)
+  bool tiltDetected;
+  const char* statusMessage;     // nullptr to omit
+  int statusCode;                // -1 to omit
+  LatencyStamp* stamp;           // nullptr when no latency is tracked
+};
+
+// Per-connection state, keyed by the GATT connection ID
+struct BLEConnectionState {
+  bool active;
+  uint16_t connId;
+  uint16_t mtu;
+  uint8_t encoding;
+  uint8_t subscriptions;        // SUB_* flags
+  uint32_t sequence;            // Sequence for responses, errors and status sent to this client
+  uint16_t streamIntervalMs;
+  unsigned long lastStreamTime;
+  bool commandReceived;
+  String pendingCommand;
+  int64_t commandReceivedUs;    // esp_timer time pendingCommand arrived
+  bool timeSync;                // Time reference (CMD_TIME_SYNC)
+};
+
+// Crash Beacon Constants (connectionless alert carried in advertising data)
+#define BEACON_COMPANY_ID          0xFFFF // Bluetooth SIG "no company" ID reserved for testing
+#define BEACON_MAGIC               0x53   // 'S' - identifies a Sentry beacon payload
+#define BEACON_VERSION             0x01
+#define BEACON_PAYLOAD_SIZE        15     // Bytes of manufacturer data (incl. company ID)
+#define BEACON_ADV_INTERVAL_MIN    0x20   // 20 ms (units of 0.625 ms)
+#define BEACON_ADV_INTERVAL_MAX    0x30   // 30 ms
+#define DEFAULT_ADV_INTERVAL_MIN   0x320  // 500 ms
+#define DEFAULT_ADV_INTERVAL_MAX   0x640  // 1000 ms
+#define BEACON_DURATION_MS         60000  // Fall back to normal advertising after 1 minute
+
+// Procedure Reporting (calibration, alignment)
+#define PROCEDURE_REPORT_STEP      10     // Report progress every 10 %
+
+// Crash Beacon Severity Levels
+#define BEACON_SEVERITY_TILT       0x01   // Tilt threshold exceeded
+#define BEACON_SEVERITY_ROLLOVER   0x02   // Device is on its side or upside down
+
 // Function declarations
 void initBluetooth(const char* deviceName);
 bool isBluetoothConnected();
+uint8_t getConnectionCount();
+uint16_t getFastestStreamIntervalMs();
+BLEConnectionState* getConnectionState(uint16_t connId);
 void handleBluetoothReconnection();
 void processBluetoothCommands();
 
+// Crash beacon functions
+void startCrashBeacon(uint8_t severity, float roll, float pitch);
+void stopCrashBeacon();
+bool isCrashBeaconActive();
+void setAdvertisingEnabled(bool enabled);
+
 // Data transmission functions
-void sendSensorData(float ax, float ay, float az, float roll, float pitch, bool tiltDetected, const char* statusMessage = nullptr, int statusCode = -1);
+void sendSensorData(SensorFrame& frame);
 void sendDeviceStatus(bool wifiConnected, int batteryLevel);
+void sendDiagnostics(BLEConnectionState* conn);
+void sendCalibrationReport(BLEConnectionState* conn);
+void sendAlignmentReport(BLEConnectionState* conn);
+void sendSelfTestReport(BLEConnectionState* conn);
 
 // Utility functions
-uint16_t calculateCRC16(const uint8_t* data, size_t length);
-uint32_t getNextSequenceNumber();
-void sendErrorResponse(uint8_t errorCode, const char* message);
+uint32_t getNextSequenceNumber(BLEConnectionState* conn);
+void sendErrorResponse(BLEConnectionState* conn, uint8_t errorCode, const char* message);
 
 // MTU and chunking functions
-uint16_t getCurrentMTU();
-void sendDataWithChunking(BLECharacteristic* pChar, const String& data);
+uint16_t getCurrentMTU(uint16_t connId);
+bool sendToConnection(BLEConnectionState* conn, BLECharacteristic* pChar, const uint8_t* data, size_t length);
+void sendDataWithChunking(BLEConnectionState* conn, BLECharacteristic* pChar, const String& data);
+
+// Bulk transfer transport (windowed notify stream on CHAR_BULK_DATA_UUID)
+BulkTransport getBleBulkTransport(uint16_t connId);
 
 #endif
@@ -0,0 +1,241 @@
+#include "BulkTransfer.h"
+#include "PacketCodec.h"
+
+// Active transfer state
+static bool transferActive = false;
+static BulkTransport activeTransport;
+static BulkReadFn sourceRead = nullptr;
+static void* sourceCtx = nullptr;
+static uint32_t sourceOffset = 0;
+static uint16_t packetSeq = 0;
+static uint16_t runningCRC = 0xFFFF;
+static unsigned long lastCreditTime = 0;
+static uint8_t nextTransferId = 0;
+static BulkTransferStats stats;
+
+// Credits are granted from the BLE callback task and consumed in loop()
+// Each side only writes its own counter (as with the sample ring), so no lock
+// is needed: the window is creditsGranted - creditsUsed.
+static volatile uint32_t creditsGranted = 0;
+static volatile uint32_t creditsUsed = 0;
+static volatile bool abortRequested = false;
+static volatile uint16_t owner = 0;
+static volatile bool accepting = false;     // Control packets count only while a transfer runs
+static uint32_t grantsSeen = 0;
+
+static uint8_t packet[BULK_MAX_PACKET_SIZE];
+
+// Credits the client has granted but the device not yet used, capped at
+// BULK_MAX_CREDITS; a grant since the last call restarts the credit timeout
+static uint32_t availableCredits() {
+  uint32_t granted = creditsGranted;
+  if (granted != grantsSeen) {
+    grantsSeen = granted;
+    lastCreditTime = millis();
+  }
+  if (granted - creditsUsed > BULK_MAX_CREDITS) {
+    creditsUsed = granted - BULK_MAX_CREDITS;
+  }
+  return granted - creditsUsed;
+}
+
+// Start streaming `length` bytes from a storage range
+bool startBulkTransfer(const BulkTransport& transport, BulkReadFn read, void* readCtx, uint32_t offset,
+                       uint32_t length) {
+  if (transferActive || read == nullptr || length == 0) {
+    return false;
+  }
+
+  uint16_t maxPayload = transport.maxPayload(transport.ctx);
+  if (maxPayload <= BULK_DATA_HEADER_SIZE) {
+    return false;
+  }
+
+  activeTransport = transport;
+  sourceRead = read;
+  sourceCtx = readCtx;
+  sourceOffset = offset;
+  packetSeq = 0;
+  runningCRC = 0xFFFF;
+
+  memset(&stats, 0, sizeof(stats));
+  stats.transferId = ++nextTransferId;
+  stats.totalBytes = length;
+  stats.startTime = millis();
+  lastCreditTime = stats.startTime;
+
+  // Open the window before START goes out, so a grant sent in reply to it
+  // is not lost
+  owner = transport.owner;
+  abortRequested = false;
+  grantsSeen = creditsGranted;
+  creditsUsed = grantsSeen - BULK_INITIAL_CREDITS;
+  accepting = true;
+
+  uint16_t payloadSize = min((uint16_t)BULK_MAX_PACKET_SIZE, maxPayload) - BULK_DATA_HEADER_SIZE;
+  packet[0] = BULK_PKT_START;
+  packet[1] = stats.transferId;
+  putLE32(&packet[2], length);
+  putLE16(&packet[6], payloadSize);
+  if (!activeTransport.send(activeTransport.ctx, packet, 8)) {
+    accepting = false;
+    return false;
+  }
+
+  transferActive = true;
+  Serial.print("BULK: Transfer ");
+  Serial.print(stats.transferId);
+  Serial.print(" started (");
+  Serial.print(length);
+  Serial.println(" bytes)");
+  return true;
+}
+
+void abortBulkTransfer(uint8_t reason) {
+  if (!transferActive) {
+    return;
+  }
+
+  transferActive = false;
+  accepting = false;
+  stats.endTime = millis();
+  stats.abortReason = reason;
+
+  if (reason != BULK_ABORT_DISCONNECTED) {
+    packet[0] = BULK_PKT_ABORT;
+    packet[1] = stats.transferId;
+    packet[2] = reason;
+    activeTransport.send(activeTransport.ctx, packet, 3);
+  }
+
+  Serial.print("BULK: Transfer ");
+  Serial.print(stats.transferId);
+  Serial.print(" aborted (reason ");
+  Serial.print(reason);
+  Serial.println(")");
+}
+
+// Send END once all data is out; retried on the next service call if the
+// stack is congested, since the client cannot finish without it
+static void finishBulkTransfer() {
+  unsigned long now = millis();
+  packet[0] = BULK_PKT_END;
+  packet[1] = stats.transferId;
+  putLE32(&packet[2], stats.totalBytes);
+  putLE16(&packet[6], runningCRC);
+  putLE32(&packet[8], now - stats.startTime);
+  if (!activeTransport.send(activeTransport.ctx, packet, 12)) {
+    return;
+  }
+
+  transferActive = false;
+  accepting = false;
+  stats.endTime = now;
+  stats.completed = true;
+
+  Serial.print("BULK: Transfer ");
+  Serial.print(stats.transferId);
+  Serial.print(" complete - ");
+  Serial.print(stats.bytesSent);
+  Serial.print(" bytes in ");
+  Serial.print(stats.endTime - stats.startTime);
+  Serial.print(" ms (");
+  Serial.print(getBulkThroughput());
+  Serial.println(" B/s)");
+}
+
+// Send as many DATA packets as the credit window allows (call from loop)
+void serviceBulkTransfer() {
+  if (!transferActive) {
+    return;
+  }
+
+  if (abortRequested) {
+    abortBulkTransfer(BULK_ABORT_CLIENT);
+    return;
+  }
+
+  uint16_t maxPayload = activeTransport.maxPayload(activeTransport.ctx);
+  if (maxPayload <= BULK_DATA_HEADER_SIZE) {
+    abortBulkTransfer(BULK_ABORT_DISCONNECTED);
+    return;
+  }
+  size_t payloadSize = min((uint16_t)BULK_MAX_PACKET_SIZE, maxPayload) - BULK_DATA_HEADER_SIZE;
+
+  for (uint8_t i = 0; i < BULK_MAX_PACKETS_PER_SERVICE && stats.bytesSent < stats.totalBytes; i++) {
+    if (availableCredits() == 0) {
+      stats.creditStalls++;
+      if (millis() - lastCreditTime >= BULK_CREDIT_TIMEOUT_MS) {
+        abortBulkTransfer(BULK_ABORT_TIMEOUT);
+      }
+      return;
+    }
+
+    size_t chunk = min((uint32_t)payloadSize, stats.totalBytes - stats.bytesSent);
+    uint8_t* payload = &packet[BULK_DATA_HEADER_SIZE];
+    if (sourceRead(sourceCtx, sourceOffset + stats.bytesSent, payload, chunk) != chunk) {
+      abortBulkTransfer(BULK_ABORT_READ_ERROR);
+      return;
+    }
+
+    packet[0] = BULK_PKT_DATA;
+    packet[1] = stats.transferId;
+    putLE16(&packet[2], packetSeq);
+
+    // Retry on the next service call if the stack is congested
+    if (!activeTransport.send(activeTransport.ctx, packet, BULK_DATA_HEADER_SIZE + chunk)) {
+      return;
+    }
+
+    creditsUsed = creditsUsed + 1;
+    runningCRC = calculateCRC16(payload, chunk, runningCRC);
+    packetSeq++;
+    stats.packetsSent++;
+    stats.bytesSent += chunk;
+  }
+
+  if (stats.bytesSent >= stats.totalBytes) {
+    finishBulkTransfer();
+  }
+}
+
+// Handle a control packet written by peer `from` (runs in the BLE callback)
+// Only the peer the transfer goes to may grant credits or abort it.
+void handleBulkControl(uint16_t from, const uint8_t* data, size_t length) {
+  if (length == 0 || !accepting) {
+    return;
+  }
+  if (from != owner) {
+    stats.foreignControls++;
+    return;
+  }
+
+  switch (data[0]) {
+    case BULK_CTRL_CREDITS:
+      if (length >= 3) {
+        creditsGranted = creditsGranted + getLE16(&data[1]);
+      }
+      break;
+
+    case BULK_CTRL_ABORT:
+      abortRequested = true;
+      break;
+  }
+}
+
+bool isBulkTransferActive() {
+  return transferActive;
+}
+
+const BulkTransferStats& getBulkTransferStats() {
+  return stats;
+}
+
+uint32_t getBulkThroughput() {
+  unsigned long end = transferActive ? millis() : stats.endTime;
+  unsigned long elapsed = end - stats.startTime;
+  if (elapsed == 0) {
+    return 0;
+  }
+  return (uint32_t)((uint64_t)stats.bytesSent * 1000 / elapsed);
+}
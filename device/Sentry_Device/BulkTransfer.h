@@ -0,0 +1,70 @@
+#ifndef BULK_TRANSFER_H
+#define BULK_TRANSFER_H
+
+#include <Arduino.h>
+
+// Bulk transfer of large payloads (e.g. a recorded pre-crash window)
+// Data is streamed as a windowed sequence of packets. The receiver grants
+// credits; each DATA packet consumes one credit, so the device never sends
+// faster than the client can consume.
+
+// Packet Types (device -> client)
+#define BULK_PKT_START             0x10   // [type][id][total u32][payload size u16]
+#define BULK_PKT_DATA              0x11   // [type][id][packet seq u16][payload...]
+#define BULK_PKT_END               0x12   // [type][id][total u32][crc u16][duration ms u32]
+#define BULK_PKT_ABORT             0x13   // [type][id][reason]
+
+// Control Types (client -> device)
+#define BULK_CTRL_CREDITS          0x01   // [type][credits u16]
+#define BULK_CTRL_ABORT            0x02   // [type]
+
+// Abort Reasons
+#define BULK_ABORT_CLIENT          0x01
+#define BULK_ABORT_TIMEOUT         0x02
+#define BULK_ABORT_READ_ERROR      0x03
+#define BULK_ABORT_DISCONNECTED    0x04
+
+// Flow Control Constants
+#define BULK_DATA_HEADER_SIZE      4
+#define BULK_MAX_PACKET_SIZE       509    // BLE_MTU_REQUEST - 3 bytes ATT overhead
+#define BULK_INITIAL_CREDITS       8      // Window granted implicitly at transfer start
+#define BULK_MAX_CREDITS           64
+#define BULK_MAX_PACKETS_PER_SERVICE 8    // Bound time spent per loop() iteration
+#define BULK_CREDIT_TIMEOUT_MS     5000   // Abort if the client stops granting credits
+
+// Reads `length` bytes at `offset` from a storage range; returns bytes read
+typedef size_t (*BulkReadFn)(void* ctx, uint32_t offset, uint8_t* out, size_t length);
+
+// Packet transport for the bulk stream
+// maxPayload() returns 0 when the link is gone. Control packets are only
+// accepted from `owner`, the peer the stream goes to (the BLE connection ID).
+struct BulkTransport {
+  uint16_t (*maxPayload)(void* ctx);
+  bool (*send)(void* ctx, const uint8_t* data, size_t length);
+  void* ctx;
+  uint16_t owner;
+};
+
+struct BulkTransferStats {
+  uint8_t transferId;
+  uint32_t totalBytes;
+  uint32_t bytesSent;
+  uint32_t packetsSent;
+  uint32_t creditStalls;          // Service calls that found no credits left
+  uint32_t foreignControls;       // Control packets ignored because another peer sent them
+  unsigned long startTime;
+  unsigned long endTime;
+  bool completed;
+  uint8_t abortReason;            // 0 if not aborted
+};
+
+bool startBulkTransfer(const BulkTransport& transport, BulkReadFn read, void* readCtx, uint32_t offset,
+                       uint32_t length);
+void serviceBulkTransfer();
+void abortBulkTransfer(uint8_t reason);
+void handleBulkControl(uint16_t from, const uint8_t* data, size_t length);
+bool isBulkTransferActive();
+const BulkTransferStats& getBulkTransferStats();
+uint32_t getBulkThroughput();     // Bytes per second of the current or last transfer
+
+#endif
@@ -0,0 +1,574 @@
+#include "Calibration.h"
+#include <Preferences.h>
+
+#define CALIB_SCALE_Q              14    // Fractional bits of the hot-path accel scale
+
+static CalibrationCoefficients coefficients;
+static bool calibrated = false;
+static CalibrationStatus status = {CALIB_STATE_IDLE, CALIB_MODE_BIAS, 0, 0, 0, nullptr};
+
+// Capture state
+static CalibrationAccumulator accumulator;
+static unsigned long captureStart = 0;
+static uint32_t captureDurationMs = 0;
+static float captureTempSum = 0;              // °C, for the capture's mean temperature
+static float positionUp[3];
+static float positionDown[3];
+static float positionGyroSum[3];
+static float positionTempSum = 0;
+static uint8_t positionCaptures = 0;
+
+// Thermal capture state
+static ThermalAccumulator thermalAccumulator;
+static float blockAccel[3];
+static float blockTemp = 0;
+static uint16_t blockSamples = 0;
+
+// Hot-path correction tables, rebuilt whenever the coefficients change
+static int16_t accelBiasCounts[ACCEL_RANGE_16G + 1][3];
+static int32_t accelScaleQ[3];
+static int16_t gyroBiasCounts[3];
+
+// Thermal drift correction, recomputed only when the temperature moves
+static ThermalModel thermal;
+static bool thermalValid = false;
+static float thermalBaseline[3];              // Drift already included in the bias, g
+static int16_t thermalTempRaw = 0;            // Temperature thermalCounts was computed at
+static bool thermalStale = true;
+static int16_t thermalCounts[3];              // Drift in ±2 g counts
+
+static const float UNIT_SCALE[3] = {1.0, 1.0, 1.0};
+
+// Estimator
+
+void resetCalibrationAccumulator(CalibrationAccumulator &acc) {
+    memset(&acc, 0, sizeof(acc));
+}
+
+void accumulateCalibrationSample(CalibrationAccumulator &acc, const float accel[3], const float gyro[3]) {
+    acc.count++;
+    for (uint8_t i = 0; i < 3; i++) {
+        float delta = accel[i] - acc.accelMean[i];
+        acc.accelMean[i] += delta / acc.count;
+        acc.accelM2[i] += delta * (accel[i] - acc.accelMean[i]);
+        
+        delta = gyro[i] - acc.gyroMean[i];
+        acc.gyroMean[i] += delta / acc.count;
+        acc.gyroM2[i] += delta * (gyro[i] - acc.gyroMean[i]);
+    }
+}
+
+// Returns nullptr if the capture is long and still enough to trust
+const char* checkStationary(const CalibrationAccumulator &acc) {
+    if (acc.count < CALIB_MIN_SAMPLES) {
+        return "Too few samples";
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        if (sqrt(acc.accelM2[i] / (acc.count - 1)) > CALIB_MAX_ACCEL_STD_G ||
+            sqrt(acc.gyroM2[i] / (acc.count - 1)) > CALIB_MAX_GYRO_STD_DPS) {
+            return "Device moved during capture";
+        }
+    }
+    return nullptr;
+}
+
+// Axis carrying gravity, or -1 if no axis is close enough to vertical
+static int8_t verticalAxis(const float accelMean[3], const float accelScale[3]) {
+    uint8_t axis = 0;
+    for (uint8_t i = 1; i < 3; i++) {
+        if (fabs(accelMean[i] * accelScale[i]) > fabs(accelMean[axis] * accelScale[axis])) {
+            axis = i;
+        }
+    }
+    
+    if (fabs(fabs(accelMean[axis] * accelScale[axis]) - 1.0) > CALIB_GRAVITY_TOLERANCE_G) {
+        return -1;
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        // Bias cannot be told apart from a tilt, so the other axes must read ~0 g
+        if (i != axis && fabs(accelMean[i] * accelScale[i]) > CALIB_GRAVITY_TOLERANCE_G) {
+            return -1;
+        }
+    }
+    return axis;
+}
+
+// Single-capture bias, keeping the given accel scale
+const char* estimateBias(const CalibrationAccumulator &acc, const float accelScale[3],
+                         CalibrationCoefficients &out) {
+    const char* error = checkStationary(acc);
+    if (error != nullptr) {
+        return error;
+    }
+    
+    int8_t axis = verticalAxis(acc.accelMean, accelScale);
+    if (axis < 0) {
+        return "No axis vertical - place the device flat";
+    }
+    
+    out.version = CALIB_VERSION;
+    for (uint8_t i = 0; i < 3; i++) {
+        float expected = (i == axis) ? (acc.accelMean[i] > 0 ? 1.0 : -1.0) : 0.0;
+        out.accelBias[i] = acc.accelMean[i] - expected / accelScale[i];
+        out.accelScale[i] = accelScale[i];
+        out.gyroBias[i] = acc.gyroMean[i];
+    }
+    out.temperatureC = NAN;
+    return nullptr;
+}
+
+// Bias and scale from each axis' mean reading when pointing up (+1 g) and down (-1 g)
+const char* estimateSixPosition(const float axisUp[3], const float axisDown[3],
+                                CalibrationCoefficients &out) {
+    out.version = CALIB_VERSION;
+    for (uint8_t i = 0; i < 3; i++) {
+        float span = axisUp[i] - axisDown[i];
+        if (span <= 0.0) {
+            return "Inconsistent position captures";
+        }
+        float scale = 2.0 / span;
+        if (scale < CALIB_MIN_SCALE || scale > CALIB_MAX_SCALE) {
+            return "Accel scale out of range";
+        }
+        out.accelBias[i] = (axisUp[i] + axisDown[i]) / 2.0;
+        out.accelScale[i] = scale;
+    }
+    out.temperatureC = NAN;
+    return nullptr;
+}
+
+void resetThermalAccumulator(ThermalAccumulator &acc) {
+    memset(&acc, 0, sizeof(acc));
+}
+
+// Add one block-averaged point of a thermal capture
+// Returns an error once the device has moved - drift over a whole sweep is
+// far smaller than CALIB_THERMAL_MAX_SHIFT_G, a change of orientation is not.
+const char* accumulateThermalPoint(ThermalAccumulator &acc, float temperatureC, const float accel[3]) {
+    if (acc.points == 0) {
+        acc.refTempC = temperatureC;
+        memcpy(acc.firstAccel, accel, sizeof(acc.firstAccel));
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        if (fabs(accel[i] - acc.firstAccel[i]) > CALIB_THERMAL_MAX_SHIFT_G) {
+            return "Device moved during capture";
+        }
+    }
+    
+    double x = temperatureC - acc.refTempC;
+    acc.minX = min(acc.minX, (float)x);
+    acc.maxX = max(acc.maxX, (float)x);
+    acc.points++;
+    acc.sx += x;
+    acc.sx2 += x * x;
+    acc.sx3 += x * x * x;
+    acc.sx4 += x * x * x * x;
+    for (uint8_t i = 0; i < 3; i++) {
+        acc.sy[i] += accel[i];
+        acc.sxy[i] += x * accel[i];
+        acc.sx2y[i] += x * x * accel[i];
+    }
+    return nullptr;
+}
+
+static double determinant3(double a, double b, double c, double d, double e, double f,
+                           double g, double h, double i) {
+    return a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+}
+
+// Least-squares drift per axis: quadratic over a wide sweep, linear otherwise
+// The constant term only reflects how gravity fell on each axis and is dropped.
+const char* estimateThermalModel(const ThermalAccumulator &acc, ThermalModel &out) {
+    if (acc.points < CALIB_THERMAL_MIN_POINTS) {
+        return "Too few samples";
+    }
+    float span = acc.maxX - acc.minX;
+    if (span < CALIB_THERMAL_MIN_SPAN_C) {
+        return "Temperature range too small - heat or cool the device";
+    }
+    
+    double n = acc.points;
+    bool quadratic = span >= CALIB_THERMAL_QUADRATIC_SPAN_C;
+    double det = quadratic ? determinant3(n, acc.sx, acc.sx2, acc.sx, acc.sx2, acc.sx3, acc.sx2, acc.sx3, acc.sx4)
+                           : n * acc.sx2 - acc.sx * acc.sx;
+    if (det == 0.0) {
+        return "Temperature range too small - heat or cool the device";
+    }
+    
+    out.version = CALIB_THERMAL_VERSION;
+    out.refTempC = acc.refTempC;
+    for (uint8_t i = 0; i < 3; i++) {
+        if (quadratic) {
+            // Cramer's rule on the 3x3 normal equations
+            out.slope[i] = determinant3(n, acc.sy[i], acc.sx2, acc.sx, acc.sxy[i], acc.sx3,
+                                        acc.sx2, acc.sx2y[i], acc.sx4) / det;
+            out.curve[i] = determinant3(n, acc.sx, acc.sy[i], acc.sx, acc.sx2, acc.sxy[i],
+                                        acc.sx2, acc.sx3, acc.sx2y[i]) / det;
+        } else {
+            out.slope[i] = (n * acc.sxy[i] - acc.sx * acc.sy[i]) / det;
+            out.curve[i] = 0.0;
+        }
+        
+        // Net drift across the sweep must stay within what the part can do
+        float drift = max(fabs(out.slope[i] * acc.minX + out.curve[i] * acc.minX * acc.minX),
+                          fabs(out.slope[i] * acc.maxX + out.curve[i] * acc.maxX * acc.maxX));
+        if (drift > CALIB_THERMAL_MAX_SLOPE_G * span) {
+            return "Thermal drift implausible";
+        }
+    }
+    return nullptr;
+}
+
+// Coefficients and storage
+
+static int16_t saturate16(int32_t value) {
+    return (int16_t)constrain(value, (int32_t)-32768, (int32_t)32767);
+}
+
+// Drift at the temperature the bias was captured at is already in the bias
+static void updateThermalBaseline() {
+    float x = isnan(coefficients.temperatureC) ? 0.0f : coefficients.temperatureC - thermal.refTempC;
+    for (uint8_t i = 0; i < 3; i++) {
+        thermalBaseline[i] = thermalValid ? thermal.slope[i] * x + thermal.curve[i] * x * x : 0.0f;
+    }
+    thermalStale = true;
+}
+
+static void updateThermalCorrection(int16_t temperatureRaw) {
+    thermalTempRaw = temperatureRaw;
+    thermalStale = false;
+    float x = temperatureToCelsius(temperatureRaw) - thermal.refTempC;
+    for (uint8_t i = 0; i < 3; i++) {
+        float drift = thermal.slope[i] * x + thermal.curve[i] * x * x - thermalBaseline[i];
+        thermalCounts[i] = saturate16(lroundf(drift * ACCEL_SCALE_LSB_PER_G));
+    }
+}
+
+static void setThermalModel(const ThermalModel &m, bool valid) {
+    thermal = m;
+    thermalValid = valid;
+    updateThermalBaseline();
+}
+
+static void clearThermalModel() {
+    ThermalModel none = {CALIB_THERMAL_VERSION, 0, {0, 0, 0}, {0, 0, 0}};
+    setThermalModel(none, false);
+}
+
+static void setCoefficients(const CalibrationCoefficients &c, bool valid) {
+    coefficients = c;
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t range = ACCEL_RANGE_2G; range <= ACCEL_RANGE_16G; range++) {
+            accelBiasCounts[range][i] = saturate16(lroundf(c.accelBias[i] * ACCEL_SCALE_LSB_PER_G / (1 << range)));
+        }
+        accelScaleQ[i] = lroundf(c.accelScale[i] * (1 << CALIB_SCALE_Q));
+        gyroBiasCounts[i] = saturate16(lroundf(c.gyroBias[i] * GYRO_SCALE_LSB_PER_DPS));
+    }
+    calibrated = valid;
+    updateThermalBaseline();
+}
+
+static void setIdentityCoefficients() {
+    CalibrationCoefficients identity = {CALIB_VERSION, {0, 0, 0}, {1.0, 1.0, 1.0}, {0, 0, 0}, NAN};
+    setCoefficients(identity, false);
+}
+
+static void saveCalibration() {
+    Preferences prefs;
+    if (!prefs.begin(CALIB_NVS_NAMESPACE, false)) {
+        Serial.println("CALIB: ✗ Could not open NVS - coefficients not saved");
+        return;
+    }
+    if (calibrated) {
+        prefs.putBytes(CALIB_NVS_KEY, &coefficients, sizeof(coefficients));
+    } else {
+        prefs.remove(CALIB_NVS_KEY);
+    }
+    prefs.end();
+}
+
+static void saveThermalModel() {
+    Preferences prefs;
+    if (!prefs.begin(CALIB_NVS_NAMESPACE, false)) {
+        Serial.println("CALIB: ✗ Could not open NVS - thermal model not saved");
+        return;
+    }
+    if (thermalValid) {
+        prefs.putBytes(CALIB_THERMAL_NVS_KEY, &thermal, sizeof(thermal));
+    } else {
+        prefs.remove(CALIB_THERMAL_NVS_KEY);
+    }
+    prefs.end();
+}
+
+// Restore stored coefficients and thermal model (call once at boot)
+void loadCalibration() {
+    clearThermalModel();
+    setIdentityCoefficients();
+    
+    Preferences prefs;
+    if (!prefs.begin(CALIB_NVS_NAMESPACE, true)) {
+        Serial.println("CALIB: No stored calibration");
+        return;
+    }
+    CalibrationCoefficients stored;
+    size_t length = prefs.getBytes(CALIB_NVS_KEY, &stored, sizeof(stored));
+    ThermalModel storedThermal;
+    size_t thermalLength = prefs.getBytes(CALIB_THERMAL_NVS_KEY, &storedThermal, sizeof(storedThermal));
+    prefs.end();
+    
+    if (thermalLength == sizeof(storedThermal) && storedThermal.version == CALIB_THERMAL_VERSION) {
+        setThermalModel(storedThermal, true);
+        Serial.println("CALIB: ✓ Stored thermal model loaded");
+    }
+    
+    // Version 1 records end before temperatureC
+    if (length == offsetof(CalibrationCoefficients, temperatureC) && stored.version == 1) {
+        stored.version = CALIB_VERSION;
+        stored.temperatureC = NAN;
+    } else if (length != sizeof(stored) || stored.version != CALIB_VERSION) {
+        Serial.println("CALIB: No stored calibration");
+        return;
+    }
+    setCoefficients(stored, true);
+    Serial.println("CALIB: ✓ Stored calibration loaded");
+}
+
+// Capture control
+
+bool startCalibration(uint8_t mode, uint32_t durationMs) {
+    if (status.state == CALIB_STATE_COLLECTING || mode > CALIB_MODE_THERMAL) {
+        return false;
+    }
+    
+    status.mode = mode;
+    status.progress = 0;
+    status.samples = 0;
+    status.error = nullptr;
+    
+    if (mode == CALIB_MODE_CLEAR) {
+        setIdentityCoefficients();
+        clearThermalModel();
+        saveCalibration();
+        saveThermalModel();
+        status.positions = 0;
+        positionCaptures = 0;
+        status.state = CALIB_STATE_IDLE;
+        Serial.println("CALIB: Calibration cleared");
+        return true;
+    }
+    
+    if (mode == CALIB_MODE_THERMAL) {
+        resetThermalAccumulator(thermalAccumulator);
+        memset(blockAccel, 0, sizeof(blockAccel));
+        blockTemp = 0;
+        blockSamples = 0;
+        captureDurationMs = constrain(durationMs, (uint32_t)CALIB_THERMAL_MIN_DURATION_MS,
+                                      (uint32_t)CALIB_THERMAL_MAX_DURATION_MS);
+    } else {
+        resetCalibrationAccumulator(accumulator);
+        captureTempSum = 0;
+        captureDurationMs = constrain(durationMs, (uint32_t)CALIB_MIN_DURATION_MS, (uint32_t)CALIB_MAX_DURATION_MS);
+    }
+    captureStart = millis();
+    status.state = CALIB_STATE_COLLECTING;
+    Serial.println("CALIB: Capture started - keep the device still");
+    return true;
+}
+
+static void failCapture(const char* error) {
+    status.state = CALIB_STATE_FAILED;
+    status.error = error;
+    Serial.print("CALIB: ✗ ");
+    Serial.println(error);
+}
+
+// File one six-position capture; sets `complete` once all six are in
+static const char* capturePosition(CalibrationCoefficients &result, bool &complete) {
+    complete = false;
+    const char* error = checkStationary(accumulator);
+    if (error != nullptr) {
+        return error;
+    }
+    int8_t axis = verticalAxis(accumulator.accelMean, UNIT_SCALE);
+    if (axis < 0) {
+        return "No axis vertical - align one axis with gravity";
+    }
+    
+    if (accumulator.accelMean[axis] > 0) {
+        positionUp[axis] = accumulator.accelMean[axis];
+        status.positions |= 1 << (axis * 2);
+    } else {
+        positionDown[axis] = accumulator.accelMean[axis];
+        status.positions |= 1 << (axis * 2 + 1);
+    }
+    if (positionCaptures == 0) {
+        memset(positionGyroSum, 0, sizeof(positionGyroSum));
+        positionTempSum = 0;
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        positionGyroSum[i] += accumulator.gyroMean[i];
+    }
+    positionTempSum += captureTempSum / accumulator.count;
+    positionCaptures++;
+    
+    if (status.positions != CALIB_POSITIONS_ALL) {
+        return nullptr;
+    }
+    
+    error = estimateSixPosition(positionUp, positionDown, result);
+    for (uint8_t i = 0; i < 3; i++) {
+        result.gyroBias[i] = positionGyroSum[i] / positionCaptures;
+    }
+    result.temperatureC = positionTempSum / positionCaptures;
+    status.positions = 0;
+    positionCaptures = 0;
+    complete = (error == nullptr);
+    return error;
+}
+
+static void finishThermalCapture() {
+    ThermalModel model;
+    const char* error = estimateThermalModel(thermalAccumulator, model);
+    if (error != nullptr) {
+        failCapture(error);
+        return;
+    }
+    setThermalModel(model, true);
+    saveThermalModel();
+    Serial.println("CALIB: ✓ Thermal model saved");
+    status.progress = 100;
+    status.state = CALIB_STATE_DONE;
+}
+
+static void finishCapture() {
+    if (status.mode == CALIB_MODE_THERMAL) {
+        finishThermalCapture();
+        return;
+    }
+    
+    CalibrationCoefficients result;
+    bool complete = true;
+    const char* error;
+    if (status.mode == CALIB_MODE_POSITION) {
+        error = capturePosition(result, complete);
+    } else {
+        error = estimateBias(accumulator, coefficients.accelScale, result);
+        result.temperatureC = captureTempSum / accumulator.count;
+    }
+    
+    if (error != nullptr) {
+        failCapture(error);
+        return;
+    }
+    
+    if (complete) {
+        setCoefficients(result, true);
+        saveCalibration();
+        Serial.println("CALIB: ✓ Calibration saved");
+    } else {
+        Serial.println("CALIB: Position captured - turn the device to the next face");
+    }
+    status.progress = 100;
+    status.state = CALIB_STATE_DONE;
+}
+
+// Add one raw (uncorrected) sample to the capture in progress
+void feedCalibrationSample(const MotionSample &sample) {
+    if (status.state != CALIB_STATE_COLLECTING) {
+        return;
+    }
+    
+    float accel[3] = {accelToG(sample.ax, sample.accelRange), accelToG(sample.ay, sample.accelRange),
+                      accelToG(sample.az, sample.accelRange)};
+    float temperatureC = temperatureToCelsius(sample.temperature);
+    
+    if (status.mode == CALIB_MODE_THERMAL) {
+        // Average blocks of samples into fit points
+        for (uint8_t i = 0; i < 3; i++) {
+            blockAccel[i] += accel[i];
+        }
+        blockTemp += temperatureC;
+        status.samples++;
+        if (++blockSamples == CALIB_THERMAL_BLOCK_SAMPLES) {
+            for (uint8_t i = 0; i < 3; i++) {
+                blockAccel[i] /= blockSamples;
+            }
+            const char* error = accumulateThermalPoint(thermalAccumulator, blockTemp / blockSamples, blockAccel);
+            memset(blockAccel, 0, sizeof(blockAccel));
+            blockTemp = 0;
+            blockSamples = 0;
+            if (error != nullptr) {
+                failCapture(error);
+                return;
+            }
+        }
+    } else {
+        float gyro[3] = {gyroToDps(sample.gx), gyroToDps(sample.gy), gyroToDps(sample.gz)};
+        accumulateCalibrationSample(accumulator, accel, gyro);
+        captureTempSum += temperatureC;
+        status.samples = accumulator.count;
+    }
+    
+    unsigned long elapsed = millis() - captureStart;
+    if (elapsed >= captureDurationMs) {
+        finishCapture();
+    } else {
+        status.progress = (uint64_t)elapsed * 100 / captureDurationMs;
+    }
+}
+
+// Fail a capture that stopped receiving samples (call from loop)
+void serviceCalibration() {
+    if (status.state == CALIB_STATE_COLLECTING &&
+        millis() - captureStart >= (unsigned long)captureDurationMs + CALIB_SAMPLE_TIMEOUT_MS) {
+        failCapture("No sensor samples");
+    }
+}
+
+// Correct a raw sample in place: integer only, no allocation
+// The thermal drift is re-evaluated in floating point only when the die
+// temperature has moved by CALIB_THERMAL_UPDATE_RAW since the last time.
+void applyCalibration(MotionSample &sample) {
+    if (!calibrated && !thermalValid) {
+        return;
+    }
+    
+    uint8_t range = sample.accelRange & ACCEL_RANGE_16G;
+    const int16_t* bias = accelBiasCounts[range];
+    int32_t drift[3] = {0, 0, 0};
+    if (thermalValid) {
+        if (thermalStale || abs(sample.temperature - thermalTempRaw) >= CALIB_THERMAL_UPDATE_RAW) {
+            updateThermalCorrection(sample.temperature);
+        }
+        for (uint8_t i = 0; i < 3; i++) {
+            drift[i] = thermalCounts[i] / (1 << range);
+        }
+    }
+    sample.ax = saturate16(((int32_t)(sample.ax - bias[0] - drift[0]) * accelScaleQ[0]) >> CALIB_SCALE_Q);
+    sample.ay = saturate16(((int32_t)(sample.ay - bias[1] - drift[1]) * accelScaleQ[1]) >> CALIB_SCALE_Q);
+    sample.az = saturate16(((int32_t)(sample.az - bias[2] - drift[2]) * accelScaleQ[2]) >> CALIB_SCALE_Q);
+    sample.gx = saturate16((int32_t)sample.gx - gyroBiasCounts[0]);
+    sample.gy = saturate16((int32_t)sample.gy - gyroBiasCounts[1]);
+    sample.gz = saturate16((int32_t)sample.gz - gyroBiasCounts[2]);
+}
+
+bool isCalibrated() {
+    return calibrated;
+}
+
+bool isThermallyCompensated() {
+    return thermalValid;
+}
+
+const ThermalModel& getThermalModel() {
+    return thermal;
+}
+
+const CalibrationCoefficients& getCalibration() {
+    return coefficients;
+}
+
+const CalibrationStatus& getCalibrationStatus() {
+    return status;
+}
@@ -0,0 +1,133 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+#include "MPU6050Handler.h"
+
+// Accelerometer/gyro calibration
+// A capture averages raw samples while the device is held still. A single
+// capture in any orientation gives gyro bias and accel bias, taking the axis
+// closest to vertical as carrying exactly 1 g. Six captures with each axis in
+// turn pointing up and down also give the accel scale per axis.
+// Corrected accel (g) = (raw - bias) * scale; corrected gyro = raw - bias.
+//
+// Accel bias also drifts with die temperature. A thermal capture records the
+// stationary device through a temperature sweep (warm-up, a heat gun, a car
+// in the sun) and fits bias vs temperature per axis with a quadratic; the
+// hot path then subtracts the drift relative to the temperature the bias was
+// captured at.
+
+// Calibration Modes
+#define CALIB_MODE_BIAS            0     // One stationary capture in any orientation
+#define CALIB_MODE_POSITION        1     // One of the six axis-up/axis-down captures
+#define CALIB_MODE_CLEAR           2     // Drop the stored coefficients
+#define CALIB_MODE_THERMAL         3     // Bias-vs-temperature fit over a long stationary capture
+
+// Calibration States
+#define CALIB_STATE_IDLE           0
+#define CALIB_STATE_COLLECTING     1
+#define CALIB_STATE_DONE           2
+#define CALIB_STATE_FAILED         3
+
+// Capture Constants
+#define CALIB_DEFAULT_DURATION_MS  3000
+#define CALIB_MIN_DURATION_MS      500
+#define CALIB_MAX_DURATION_MS      30000
+#define CALIB_SAMPLE_TIMEOUT_MS    1000  // Fail if no samples arrive this long after the window
+#define CALIB_MIN_SAMPLES          10
+#define CALIB_MAX_ACCEL_STD_G      0.02  // Above this the device was not held still
+#define CALIB_MAX_GYRO_STD_DPS     1.0
+#define CALIB_GRAVITY_TOLERANCE_G  0.2   // Vertical axis must read 1 g within this
+#define CALIB_MIN_SCALE            0.8   // Reject six-position fits outside this band
+#define CALIB_MAX_SCALE            1.2
+#define CALIB_POSITIONS_ALL        0x3F  // +X, -X, +Y, -Y, +Z, -Z
+
+// Thermal Capture Constants
+#define CALIB_THERMAL_DEFAULT_DURATION_MS 1800000  // 30 minutes
+#define CALIB_THERMAL_MIN_DURATION_MS     60000
+#define CALIB_THERMAL_MAX_DURATION_MS     7200000
+#define CALIB_THERMAL_BLOCK_SAMPLES       64     // Samples averaged into one fit point
+#define CALIB_THERMAL_MIN_POINTS          8
+#define CALIB_THERMAL_MIN_SPAN_C          10.0   // Temperature range needed for a linear fit...
+#define CALIB_THERMAL_QUADRATIC_SPAN_C    25.0   // ...and for the curvature term
+#define CALIB_THERMAL_MAX_SHIFT_G         0.1    // Block mean further than this from the first -> moved
+#define CALIB_THERMAL_MAX_SLOPE_G         0.005  // Per °C; the MPU6050 drifts < 1 mg/°C
+#define CALIB_THERMAL_UPDATE_RAW          34     // Recompute the correction every 0.1 °C
+
+// Non-Volatile Storage
+#define CALIB_NVS_NAMESPACE        "sentry"
+#define CALIB_NVS_KEY              "calib"
+#define CALIB_THERMAL_NVS_KEY      "calib_temp"
+#define CALIB_VERSION              2     // 2 adds temperatureC; version 1 records still load
+#define CALIB_THERMAL_VERSION      1
+
+struct CalibrationCoefficients {
+  uint8_t version;
+  float accelBias[3];            // g
+  float accelScale[3];           // 1.0 = uncorrected
+  float gyroBias[3];             // °/s
+  float temperatureC;            // Die temperature of the bias capture, NAN if unknown
+};
+
+// Accel bias drift: slope * (T - refTempC) + curve * (T - refTempC)^2, in g
+struct ThermalModel {
+  uint8_t version;
+  float refTempC;
+  float slope[3];                // g/°C
+  float curve[3];                // g/°C²
+};
+
+// Least-squares sums of a thermal capture (one point per sample block)
+// x is the temperature relative to refTempC, y the mean accel per axis.
+struct ThermalAccumulator {
+  uint32_t points;
+  float refTempC;
+  float minX, maxX;
+  float firstAccel[3];           // Mean accel of the first block, g
+  double sx, sx2, sx3, sx4;
+  double sy[3], sxy[3], sx2y[3];
+};
+
+// Running mean and variance of one stationary capture (Welford)
+struct CalibrationAccumulator {
+  uint32_t count;
+  float accelMean[3];            // g
+  float accelM2[3];
+  float gyroMean[3];             // °/s
+  float gyroM2[3];
+};
+
+struct CalibrationStatus {
+  uint8_t state;                 // CALIB_STATE_*
+  uint8_t mode;                  // CALIB_MODE_* of the current/last capture
+  uint8_t progress;              // Percent of the capture window elapsed
+  uint8_t positions;             // Six-position captures done (bit per CALIB_POSITIONS_ALL)
+  uint32_t samples;
+  const char* error;             // Reason when CALIB_STATE_FAILED
+};
+
+// Estimator (no hardware access)
+void resetCalibrationAccumulator(CalibrationAccumulator &acc);
+void accumulateCalibrationSample(CalibrationAccumulator &acc, const float accel[3], const float gyro[3]);
+const char* checkStationary(const CalibrationAccumulator &acc);
+const char* estimateBias(const CalibrationAccumulator &acc, const float accelScale[3],
+                         CalibrationCoefficients &out);
+const char* estimateSixPosition(const float axisUp[3], const float axisDown[3],
+                                CalibrationCoefficients &out);
+void resetThermalAccumulator(ThermalAccumulator &acc);
+const char* accumulateThermalPoint(ThermalAccumulator &acc, float temperatureC, const float accel[3]);
+const char* estimateThermalModel(const ThermalAccumulator &acc, ThermalModel &out);
+
+// Capture control and hot-path correction
+void loadCalibration();
+bool startCalibration(uint8_t mode, uint32_t durationMs);
+void feedCalibrationSample(const MotionSample &sample);
+void serviceCalibration();
+void applyCalibration(MotionSample &sample);
+bool isCalibrated();
+bool isThermallyCompensated();
+const CalibrationCoefficients& getCalibration();
+const ThermalModel& getThermalModel();
+const CalibrationStatus& getCalibrationStatus();
+
+#endif
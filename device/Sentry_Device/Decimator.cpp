@@ -0,0 +1,52 @@
+#include "Decimator.h"
+
+void initDecimator(Decimator &decimator, uint16_t ratio) {
+    memset(&decimator, 0, sizeof(decimator));
+    decimator.ratio = constrain(ratio, (uint16_t)1, (uint16_t)DECIMATOR_MAX_RATIO);
+    decimator.gain = 1;
+    for (uint8_t stage = 0; stage < DECIMATOR_ORDER; stage++) {
+        decimator.gain *= decimator.ratio;
+    }
+}
+
+// Feed one input sample; true when out holds a new decimated sample
+// The state starts at zero, so outputs are withheld until the impulse
+// response spans real input (DECIMATOR_ORDER outputs).
+bool updateDecimator(Decimator &decimator, const int32_t in[DECIMATOR_CHANNELS], int32_t out[DECIMATOR_CHANNELS]) {
+    for (uint8_t ch = 0; ch < DECIMATOR_CHANNELS; ch++) {
+        uint64_t acc = (uint64_t)(int64_t)in[ch];
+        for (uint8_t stage = 0; stage < DECIMATOR_ORDER; stage++) {
+            decimator.integrator[ch][stage] += acc;
+            acc = decimator.integrator[ch][stage];
+        }
+    }
+    if (++decimator.phase < decimator.ratio) {
+        return false;
+    }
+    decimator.phase = 0;
+
+    int64_t half = decimator.gain / 2;
+    for (uint8_t ch = 0; ch < DECIMATOR_CHANNELS; ch++) {
+        uint64_t acc = decimator.integrator[ch][DECIMATOR_ORDER - 1];
+        for (uint8_t stage = 0; stage < DECIMATOR_ORDER; stage++) {
+            uint64_t previous = decimator.delay[ch][stage];
+            decimator.delay[ch][stage] = acc;
+            acc -= previous;
+        }
+        // Round to nearest; the wrapped difference is the exact sum again
+        int64_t sum = (int64_t)acc;
+        out[ch] = (int32_t)((sum + (sum < 0 ? -half : half)) / decimator.gain);
+    }
+    decimator.outputs++;
+    return isDecimatorSettled(decimator);
+}
+
+bool isDecimatorSettled(const Decimator &decimator) {
+    return decimator.outputs >= DECIMATOR_ORDER;
+}
+
+// Group delay in input samples: an output describes the input this far
+// before the newest one that produced it
+float getDecimatorDelay(const Decimator &decimator) {
+    return DECIMATOR_ORDER * (decimator.ratio - 1) / 2.0f;
+}
@@ -0,0 +1,37 @@
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <Arduino.h>
+
+// Multi-channel CIC decimator (fixed point)
+// DECIMATOR_ORDER integrators run at the input rate and as many combs at the
+// output rate, so an input sample costs DECIMATOR_ORDER 64-bit adds per
+// channel and no multiplies; the gain (ratio^order) is divided out once per
+// output. Integrators wrap modulo 2^64, which is exact as long as the output
+// fits: input bits + order * log2(ratio) <= 63 (18 + 3 * 7 for ±16 g accel in
+// ±2 g counts at the largest ratio).
+//
+// The response is sinc^order with nulls at every multiple of the output rate,
+// where the bands that would alias onto DC sit. The price is droop towards the
+// output Nyquist frequency (about -12 dB there), which a stream meant for
+// display and logging tolerates.
+
+#define DECIMATOR_ORDER            3
+#define DECIMATOR_CHANNELS         9      // ax, ay, az, gx, gy, gz, linear ax, ay, az
+#define DECIMATOR_MAX_RATIO        128    // Keeps the integrator width within 64 bits
+
+struct Decimator {
+    uint16_t ratio;                                            // Input samples per output
+    uint16_t phase;                                            // Inputs since the last output
+    uint64_t integrator[DECIMATOR_CHANNELS][DECIMATOR_ORDER];  // Modulo 2^64
+    uint64_t delay[DECIMATOR_CHANNELS][DECIMATOR_ORDER];       // Previous comb inputs
+    int64_t gain;                                              // ratio^order
+    uint32_t outputs;
+};
+
+void initDecimator(Decimator &decimator, uint16_t ratio);
+bool updateDecimator(Decimator &decimator, const int32_t in[DECIMATOR_CHANNELS], int32_t out[DECIMATOR_CHANNELS]);
+bool isDecimatorSettled(const Decimator &decimator);
+float getDecimatorDelay(const Decimator &decimator);
+
+#endif
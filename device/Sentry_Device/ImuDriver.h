@@ -0,0 +1,63 @@
+#ifndef IMU_DRIVER_H
+#define IMU_DRIVER_H
+
+#include <Arduino.h>
+
+// IMU driver interface (static polymorphism)
+// A driver derives from ImuDriver<Driver> and implements the *Impl methods;
+// the base forwards to them through a static_cast, so every call in the
+// sample path is resolved at compile time and inlined - no vtable. Moving to
+// another IMU means writing its driver and changing the Imu typedef in
+// MPU6050Handler.cpp; detection code only ever sees MotionSample.
+//
+// Motion blocks and FIFO entries use the MPU6050 layout: accel, temperature
+// and gyro as big-endian int16 (MPU_MOTION_BLOCK_BYTES). Reads make a single
+// attempt and report success; retries and failure accounting stay with the
+// caller.
+
+#define IMU_SELF_TEST_AXES         6     // ax, ay, az, gx, gy, gz
+
+// Factory self-test outcome
+struct ImuSelfTest {
+  bool ran;                              // A test completed (the sensor answered throughout)
+  bool passed;                           // No axis with a factory trim failed
+  uint8_t failedAxes;                    // Bit per axis, in IMU_SELF_TEST_AXES order
+  uint8_t untestedAxes;                  // Bit per axis without a factory trim (not judged)
+  float deviation[IMU_SELF_TEST_AXES];   // Response vs factory trim (0.1 = 10 % high), NAN when untested
+};
+
+template <class Driver>
+class ImuDriver {
+public:
+  // Identity and configuration
+  uint8_t address() const { return self().addressImpl(); }
+  bool probe() { return self().probeImpl(); }
+  bool configure(uint8_t accelRange) { return self().configureImpl(accelRange); }  // Reset + ranges
+  void setAccelRange(uint8_t range) { self().setAccelRangeImpl(range); }
+  uint16_t setSampleRate(uint16_t rateHz, uint8_t dlpfMode) { return self().setSampleRateImpl(rateHz, dlpfMode); }
+
+  // Acquisition
+  bool readMotion(uint8_t* block) { return self().readMotionImpl(block); }
+  void configureFifo() { self().configureFifoImpl(); }  // Follow with resetFifo()
+  void resetFifo() { self().resetFifoImpl(); }
+  bool readFifoCount(uint16_t &bytes, bool &overflow) { return self().readFifoCountImpl(bytes, overflow); }
+  bool readFifo(uint8_t* data, uint8_t length) { return self().readFifoImpl(data, length); }
+  void configureDataReady() { self().configureDataReadyImpl(); }
+  void disableDataReady() { self().disableDataReadyImpl(); }
+  void clearInterrupts() { self().clearInterruptsImpl(); }
+
+  // Low-power motion detection
+  void enterMotionWake(float thresholdG) { self().enterMotionWakeImpl(thresholdG); }
+  void exitMotionWake() { self().exitMotionWakeImpl(); }
+  bool readMotionStatus(bool &motion) { return self().readMotionStatusImpl(motion); }
+
+  // Factory self-test; false if the sensor stopped answering. Leaves the
+  // sensor in its test configuration - follow with configure().
+  bool selfTest(ImuSelfTest &result) { return self().selfTestImpl(result); }
+
+private:
+  Driver& self() { return static_cast<Driver&>(*this); }
+  const Driver& self() const { return static_cast<const Driver&>(*this); }
+};
+
+#endif
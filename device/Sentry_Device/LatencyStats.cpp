@@ -0,0 +1,81 @@
+#include "LatencyStats.h"
+
+static LatencyHistogram histograms[LATENCY_STAGE_COUNT];
+static LatencyHistogram loopPasses;
+static bool stampsEnabled = false;
+
+static uint8_t bucketFor(uint32_t us) {
+  uint8_t bucket = 0;
+  while (us > 1 && bucket < LATENCY_BUCKETS - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static void addToHistogram(LatencyHistogram& h, uint32_t us) {
+  if (h.count == 0 || us < h.minUs) {
+    h.minUs = us;
+  }
+  if (us > h.maxUs) {
+    h.maxUs = us;
+  }
+  h.count++;
+  h.sumUs += us;
+  h.buckets[bucketFor(us)]++;
+}
+
+// Add one delivered frame's stage delays to the histograms
+void recordLatency(const LatencyStamp& stamp) {
+  for (uint8_t stage = LAT_FILTERED; stage < LATENCY_STAGE_COUNT; stage++) {
+    addToHistogram(histograms[stage], stamp.us[stage] - stamp.us[LAT_ACQUIRED]);
+  }
+}
+
+// Add the busy time of one loop() pass (its trailing delay excluded)
+void recordLoopPass(uint32_t us) {
+  addToHistogram(loopPasses, us);
+}
+
+void resetLatencyStats() {
+  memset(histograms, 0, sizeof(histograms));
+  memset(&loopPasses, 0, sizeof(loopPasses));
+}
+
+const LatencyHistogram& getLatencyHistogram(LatencyStage stage) {
+  return histograms[stage];
+}
+
+const LatencyHistogram& getLoopPassHistogram() {
+  return loopPasses;
+}
+
+// Approximate percentile: upper bound of the bucket containing it, capped at max
+uint32_t getHistogramPercentile(const LatencyHistogram& h, uint8_t percentile) {
+  if (h.count == 0) {
+    return 0;
+  }
+  
+  uint32_t target = ((uint64_t)h.count * percentile + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += h.buckets[i];
+    if (seen >= target) {
+      uint32_t upper = (i < 31) ? ((2UL << i) - 1) : 0xFFFFFFFF;
+      return min(upper, h.maxUs);
+    }
+  }
+  return h.maxUs;
+}
+
+uint32_t getLatencyPercentile(LatencyStage stage, uint8_t percentile) {
+  return getHistogramPercentile(histograms[stage], percentile);
+}
+
+void setLatencyStampsEnabled(bool enabled) {
+  stampsEnabled = enabled;
+}
+
+bool areLatencyStampsEnabled() {
+  return stampsEnabled;
+}
@@ -0,0 +1,56 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <Arduino.h>
+
+// End-to-end latency from sensor read to BLE notification
+// Each sample carries a LatencyStamp filled in with micros() as it moves through
+// the pipeline. Every delivered frame adds its stage delays (relative to
+// LAT_ACQUIRED) to a running log2 histogram per stage. loop() passes are
+// timed into one more histogram of the same kind.
+
+enum LatencyStage {
+  LAT_ACQUIRED = 0,   // I2C read complete
+  LAT_FILTERED,       // Filter output ready
+  LAT_DETECTED,       // Tilt/crash detection done
+  LAT_ENCODED,        // Frame encoded
+  LAT_QUEUED,         // Frame handed to the per-connection send path
+  LAT_SENT,           // Notification handed to the BLE stack
+  LATENCY_STAGE_COUNT
+};
+
+// Bucket i holds delays in [2^i, 2^(i+1)) microseconds; the last bucket also
+// collects everything above ~65 ms
+#define LATENCY_BUCKETS            17
+
+struct LatencyStamp {
+  uint32_t us[LATENCY_STAGE_COUNT];
+};
+
+struct LatencyHistogram {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+  uint32_t buckets[LATENCY_BUCKETS];
+};
+
+inline void stampLatency(LatencyStamp* stamp, LatencyStage stage) {
+  if (stamp != nullptr) {
+    stamp->us[stage] = micros();
+  }
+}
+
+void recordLatency(const LatencyStamp& stamp);
+void recordLoopPass(uint32_t us);
+void resetLatencyStats();
+const LatencyHistogram& getLatencyHistogram(LatencyStage stage);
+const LatencyHistogram& getLoopPassHistogram();
+uint32_t getHistogramPercentile(const LatencyHistogram& h, uint8_t percentile);
+uint32_t getLatencyPercentile(LatencyStage stage, uint8_t percentile);
+
+// Whether sensor frames carry their stage timestamps
+void setLatencyStampsEnabled(bool enabled);
+bool areLatencyStampsEnabled();
+
+#endif
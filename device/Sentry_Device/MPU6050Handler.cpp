@@ -1,17 +1,32 @@
 #include "MPU6050Handler.h"
-#include <SimpleKalmanFilter.h>
+#include "Mpu6050Driver.h"
+#include "MotionFilter.h"
+#include "SensorHealth.h"
+#include <Preferences.h>
 #include <Wire.h>
 
-// SimpleKalmanFilter by Denys Sene
+// Primary IMU and the optional redundant one
+// Swapping the sensor model only changes this typedef (see ImuDriver.h).
+typedef Mpu6050Driver Imu;
+static Imu imus[IMU_COUNT] = {Imu(IMU_PRIMARY_ADDRESS), Imu(IMU_SECONDARY_ADDRESS)};
+static bool imuExpected[IMU_COUNT] = {true, false};  // Secondary only if found at boot
+static bool imuActive[IMU_COUNT] = {false, false};   // Configured and being sampled
+static uint8_t imuFailures[IMU_COUNT] = {0, 0};
+static unsigned long lastRejoinAttempt = 0;
+static ImuStats imuStats;
 
-MPU6050 mpu;
+// Factory self-test results, per IMU
+static ImuSelfTest selfTestResults[IMU_COUNT];
+static unsigned long selfTestDueMs = 0;          // Deferred boot self-test (0 = none pending)
 
-const float ACCEL_RANGE = 32768.0; // ±2g
-
-// Kalman filters for each axis
-SimpleKalmanFilter kalmanAx(2, 2, 0.01);
-SimpleKalmanFilter kalmanAy(2, 2, 0.01);
-SimpleKalmanFilter kalmanAz(2, 2, 0.01);
+// 3-axis Kalman filter on raw accel counts (fixed point)
+static MotionFilter accelFilter;
+static uint8_t filterRange = DEFAULT_ACCEL_RANGE;   // Range the filter state is expressed in
+static float accelMeasurementNoise = MOTION_FILTER_DEFAULT_MEASUREMENT;
+static float accelEstimateError = MOTION_FILTER_DEFAULT_ESTIMATE;
+static float accelProcessNoise = MOTION_FILTER_DEFAULT_PROCESS;
+static uint16_t filterRateHz = 0;                   // Rate and DLPF mode the noise terms
+static uint8_t filterDlpf = DLPF_AUTO;              // were last derived for
 
 // MPU6050 status tracking
 static bool mpu6050Initialized = false;
@@ -21,17 +36,254 @@ static int consecutiveFailures = 0;
 const unsigned long MPU_DATA_TIMEOUT = 5000; // 5 seconds timeout for stale data
 const int MAX_CONSECUTIVE_FAILURES = 3; // Consider device unstable after 3 failures
 
+// FIFO / interrupt acquisition state
+static uint8_t acquisitionMode = ACQ_MODE_POLL;
+static uint16_t sampleRateHz = 0;
+static uint32_t samplePeriodUs = 0;
+static uint64_t nextSampleUs = 0;      // Timestamp assigned to the next sample parsed
+static bool pendingGap = false;
+static uint32_t fifoOverflowCount = 0;
+
+// Output data rate and DLPF configuration
+// Like range changes, a new configuration is posted by loop() and written to
+// the sensor by the context that owns the I2C bus.
+static uint16_t configuredRateHz = DEFAULT_SAMPLE_RATE_HZ;
+static uint8_t configuredDlpf = DLPF_AUTO;
+static volatile uint8_t dlpfMode = MPU6050_DLPF_BW_98;  // Mode currently in the sensor
+static volatile bool samplingChangeRequested = false;
+static const uint16_t DLPF_BANDWIDTH_HZ[] = {256, 188, 98, 42, 20, 10, 5};
+
+// Accel full-scale range state
+// Range changes are requested from loop() or decided per sample, and written
+// to the sensor by whichever context currently owns the I2C bus.
+static volatile uint8_t accelRange = DEFAULT_ACCEL_RANGE;
+static volatile int8_t requestedRange = -1;
+static volatile bool autoRange = false;
+static bool rangeChangePending = false;
+static uint64_t calmSinceUs = 0;
+static uint8_t fifoBuffers[IMU_COUNT][MPU_FIFO_BURST_BYTES];
+
+// Sample ring (single producer / single consumer)
+// The producer is the acquisition task and the consumer is loop(); indices are
+// volatile and each side only writes its own index, so no lock is needed.
+static MotionSample sampleRing[SAMPLE_RING_SIZE];
+static volatile uint16_t ringHead = 0;
+static volatile uint16_t ringTail = 0;
+
+// I2C error handling state
+static I2CStats i2cStats;
+static uint32_t recoveryBackoffMs = MPU_REINIT_BACKOFF_MIN_MS;
+static unsigned long lastRecoveryAttempt = 0;
+
+// Acquisition task state (FIFO and interrupt modes)
+// Once the task runs it owns the I2C bus: loop() only posts requests (range
+// changes) and pops finished samples, so it never waits on a transfer.
+static TaskHandle_t samplingTaskHandle = nullptr;
+static volatile uint64_t isrTimestampUs = 0;
+static volatile uint32_t isrCount = 0;
+static SampleTimingStats timingStats;
+static bool interruptWired = false;             // A data-ready edge was seen on MPU_INT_PIN
+
+// Pause handshake: loop() takes the bus back from the task for parked mode
+static volatile bool acquisitionPaused = false;
+static volatile bool acquisitionIdle = false;
+static bool motionWakeActive = false;           // Parked in low-power motion detection
+
+static void beginI2C() {
+    Wire.begin(MPU_SDA_PIN, MPU_SCL_PIN);
+    Wire.setClock(MPU_I2C_CLOCK_HZ);
+    Wire.setTimeOut(MPU_I2C_TIMEOUT_MS);
+}
+
+// Release a bus held by a slave that was reset or interrupted mid-byte:
+// clock SCL until the slave lets go of SDA, then generate a STOP
+static void recoverI2CBus() {
+    Wire.end();
+    pinMode(MPU_SDA_PIN, INPUT_PULLUP);
+    pinMode(MPU_SCL_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(MPU_SCL_PIN, HIGH);
+    
+    for (uint8_t i = 0; i < MPU_BUS_RECOVERY_PULSES && digitalRead(MPU_SDA_PIN) == LOW; i++) {
+        digitalWrite(MPU_SCL_PIN, LOW);
+        delayMicroseconds(5);
+        digitalWrite(MPU_SCL_PIN, HIGH);
+        delayMicroseconds(5);
+    }
+    
+    pinMode(MPU_SDA_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(MPU_SCL_PIN, LOW);
+    delayMicroseconds(5);
+    digitalWrite(MPU_SDA_PIN, LOW);
+    delayMicroseconds(5);
+    digitalWrite(MPU_SCL_PIN, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(MPU_SDA_PIN, HIGH);
+    delayMicroseconds(5);
+    
+    i2cStats.busRecoveries++;
+    beginI2C();
+}
+
+// Run one driver read, retrying within a bounded time budget
+template <typename Read>
+static bool readWithRetries(Read read) {
+    uint32_t start = micros();
+    i2cStats.transactions++;
+    
+    for (uint8_t attempt = 0; ; attempt++) {
+        if (read()) {
+            return true;
+        }
+        
+        i2cStats.errors++;
+        if (attempt >= MPU_I2C_MAX_RETRIES || micros() - start >= MPU_I2C_RETRY_BUDGET_US) {
+            i2cStats.failures++;
+            return false;
+        }
+        i2cStats.retries++;
+    }
+}
+
+// Stop using the sensor until attemptRecovery() re-initializes it
+static void markSensorLost(const char* reason) {
+    mpu6050Connected = false;
+    lastRecoveryAttempt = millis();
+    Serial.print("MPU6050: ✗ Sensor lost (");
+    Serial.print(reason);
+    Serial.println(") - recovering");
+}
+
+// Count a failed read; after repeated failures the sensor is treated as lost
+static void noteReadFailure() {
+    consecutiveFailures++;
+    if (consecutiveFailures >= MAX_CONSECUTIVE_FAILURES && mpu6050Connected) {
+        markSensorLost("I2C errors");
+    }
+}
+
+// Count a failed read on one IMU
+// While another IMU is active the failing one is dropped after repeated
+// failures; the last one left counts towards losing the sensor altogether.
+static void noteImuFailure(uint8_t index) {
+    imuFailures[index]++;
+    bool alone = true;
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (i != index && imuActive[i]) {
+            alone = false;
+        }
+    }
+    if (alone) {
+        noteReadFailure();
+        return;
+    }
+    if (imuFailures[index] >= MAX_CONSECUTIVE_FAILURES) {
+        imuActive[index] = false;
+        imuStats.dropouts++;
+        lastRejoinAttempt = millis();
+        Serial.print("MPU6050: ✗ IMU 0x");
+        Serial.print(imus[index].address(), HEX);
+        Serial.println(" not answering - continuing on the other");
+    }
+}
+
+static uint8_t activeImuMask() {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+// Wait until the primary answers instead of sleeping a fixed start-up time
+// It has normally been powered long before initMPU() runs, so this returns
+// after the first probe.
+static bool waitForMPU() {
+    unsigned long start = millis();
+    while (!imus[0].probe()) {
+        if (millis() - start >= MPU_STARTUP_TIMEOUT_MS) {
+            return false;
+        }
+        delay(MPU_STARTUP_POLL_MS);
+    }
+    return true;
+}
+
+// Reset every expected IMU and apply the ranges in use; true if any answered
+static bool configureMPU() {
+    bool any = false;
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        imuActive[i] = imuExpected[i] && imus[i].configure(accelRange);
+        imuFailures[i] = 0;
+        any |= imuActive[i];
+    }
+    return any;
+}
+
+// Restore the stored rate and DLPF setting, keeping the defaults if none is valid
+static void loadSamplingConfig() {
+    Preferences prefs;
+    if (!prefs.begin(SAMPLING_NVS_NAMESPACE, true)) {
+        return;
+    }
+    SamplingConfig stored;
+    size_t length = prefs.getBytes(SAMPLING_NVS_KEY, &stored, sizeof(stored));
+    prefs.end();
+    
+    if (length != sizeof(stored) || stored.version != SAMPLING_CONFIG_VERSION ||
+        stored.rateHz < MIN_SAMPLE_RATE_HZ || stored.rateHz > MAX_SAMPLE_RATE_HZ ||
+        (stored.dlpf != DLPF_AUTO && (stored.dlpf < MPU6050_DLPF_BW_188 || stored.dlpf > MPU6050_DLPF_BW_5))) {
+        return;
+    }
+    configuredRateHz = stored.rateHz;
+    configuredDlpf = stored.dlpf;
+    Serial.print("MPU6050: Stored sampling config - ");
+    Serial.print(configuredRateHz);
+    Serial.println(" Hz");
+}
+
+static void saveSamplingConfig() {
+    SamplingConfig config = {SAMPLING_CONFIG_VERSION, configuredRateHz, configuredDlpf};
+    Preferences prefs;
+    if (!prefs.begin(SAMPLING_NVS_NAMESPACE, false)) {
+        Serial.println("MPU6050: ✗ Could not open NVS - sampling config not saved");
+        return;
+    }
+    prefs.putBytes(SAMPLING_NVS_KEY, &config, sizeof(config));
+    prefs.end();
+}
+
+static void configureSampleRate(uint16_t rateHz);
+static void runSelfTests();
+
 void initMPU() {
-    Wire.begin(21, 22);  // SDA = 21, SCL = 22
-    delay(100); // Give I2C time to stabilize
+    beginI2C();
+    loadSamplingConfig();
+    
+    initMotionFilter(accelFilter, accelMeasurementNoise, accelEstimateError, accelProcessNoise);
+    filterRange = accelRange;
+    requestedRange = -1;
     
-    mpu.initialize();
-    if (mpu.testConnection()) {
+    bool primaryFound = waitForMPU();
+    imuExpected[1] = imus[1].probe();
+    if ((primaryFound || imuExpected[1]) && configureMPU()) {
+        configureSampleRate(configuredRateHz);  // DLPF applies in every acquisition mode
         mpu6050Connected = true;
         mpu6050Initialized = true;
         lastValidReading = millis();
         consecutiveFailures = 0;
         Serial.println("MPU6050: ✓ Device detected and initialized");
+        if (imuActive[0] && imuActive[1]) {
+            Serial.println("MPU6050: ✓ Second IMU at 0x69 - samples fused for redundancy");
+        } else if (!imuActive[0]) {
+            Serial.println("MPU6050: ✗ Primary IMU missing - running on 0x69 alone");
+        }
+#if SELF_TEST_AT_BOOT == SELF_TEST_BOOT_BLOCKING
+        runSelfTests();
+#elif SELF_TEST_AT_BOOT == SELF_TEST_BOOT_DEFERRED
+        selfTestDueMs = (millis() + SELF_TEST_DEFER_MS) | 1;
+#endif
     } else {
         mpu6050Connected = false;
         mpu6050Initialized = false;
@@ -41,46 +293,1044 @@ void initMPU() {
     }
 }
 
-void readAccel(float &ax, float &ay, float &az) {
+// Set the accel filter noise for the current rate and DLPF bandwidth
+// Polled samples arrive at the loop() rate, not the ODR, so only the
+// bandwidth term applies there.
+static void deriveFilterNoise() {
+    filterRateHz = sampleRateHz;
+    filterDlpf = dlpfMode;
+    
+    float rateScale = 1.0f;
+    if (acquisitionMode != ACQ_MODE_POLL && sampleRateHz > 0) {
+        rateScale = (float)FILTER_REFERENCE_RATE_HZ / sampleRateHz;
+    }
+    float bandwidthScale = sqrtf((float)DLPF_BANDWIDTH_HZ[filterDlpf] / FILTER_REFERENCE_DLPF_HZ);
+    setMotionFilterNoise(accelFilter, accelMeasurementNoise * bandwidthScale, accelEstimateError,
+                         accelProcessNoise * rateScale);
+}
+
+// Kalman filter raw counts and normalize to g
+static void applyFilter(const MotionSample &sample, float &ax, float &ay, float &az) {
+    // Re-derive the noise terms after a rate or DLPF change
+    if (sampleRateHz != filterRateHz || dlpfMode != filterDlpf) {
+        deriveFilterNoise();
+    }
+    
+    // Keep the filter state continuous across full-scale range changes
+    if (sample.accelRange != filterRange) {
+        rescaleMotionFilter(accelFilter, (int8_t)filterRange - (int8_t)sample.accelRange);
+        filterRange = sample.accelRange;
+    }
+    
+    // Apply Kalman filter
+    int16_t raw[MOTION_FILTER_AXES] = {sample.ax, sample.ay, sample.az};
+    int32_t filtered[MOTION_FILTER_AXES];
+    updateMotionFilter(accelFilter, raw, filtered);
+
+    // Normalize to g for the sample's full-scale range
+    float scale = (1 << sample.accelRange) / (ACCEL_SCALE_LSB_PER_G * (1UL << MOTION_FILTER_Q));
+    ax = filtered[0] * scale;
+    ay = filtered[1] * scale;
+    az = filtered[2] * scale;
+}
+
+// Retune the accel filter at runtime
+// Noise terms are in raw counts at FILTER_REFERENCE_RATE_HZ / FILTER_REFERENCE_DLPF_HZ.
+bool setAccelFilterNoise(float measurementNoise, float estimateError, float processNoise) {
+    if (!(measurementNoise > 0.0f) || !(estimateError > 0.0f) || !(processNoise >= 0.0f)) {
+        return false;
+    }
+    accelMeasurementNoise = measurementNoise;
+    accelEstimateError = estimateError;
+    accelProcessNoise = processNoise;
+    deriveFilterNoise();
+    return true;
+}
+
+void getAccelFilterNoise(float &measurementNoise, float &estimateError, float &processNoise) {
+    measurementNoise = accelMeasurementNoise;
+    estimateError = accelEstimateError;
+    processNoise = accelProcessNoise;
+}
+
+// Decode a 14-byte accel/temp/gyro block (register or FIFO layout)
+static void parseMotionBlock(const uint8_t* block, MotionSample &sample) {
+    sample.ax = (int16_t)((block[0] << 8) | block[1]);
+    sample.ay = (int16_t)((block[2] << 8) | block[3]);
+    sample.az = (int16_t)((block[4] << 8) | block[5]);
+    sample.temperature = (int16_t)((block[6] << 8) | block[7]);
+    sample.gx = (int16_t)((block[8] << 8) | block[9]);
+    sample.gy = (int16_t)((block[10] << 8) | block[11]);
+    sample.gz = (int16_t)((block[12] << 8) | block[13]);
+}
+
+// Is a raw accel value pinned at a rail?
+static bool atRail(int16_t raw) {
+    return raw == INT16_MAX || raw == INT16_MIN;
+}
+
+static int16_t fuseAxis(int16_t a, int16_t b) {
+    if (atRail(a)) return a;
+    if (atRail(b)) return b;
+    return ((int32_t)a + b) / 2;
+}
+
+// Combine the blocks read from the active IMUs (bit per IMU in mask) into one
+// sample. Axes are averaged, but a rail reading on either IMU is kept so
+// auto-ranging and the health monitor still see the clipping.
+static void fuseMotion(const MotionSample parts[], uint8_t mask, MotionSample &out) {
+    if (mask != (1 << IMU_COUNT) - 1) {
+        const MotionSample &only = parts[(mask & 1) ? 0 : 1];
+        out.ax = only.ax;
+        out.ay = only.ay;
+        out.az = only.az;
+        out.gx = only.gx;
+        out.gy = only.gy;
+        out.gz = only.gz;
+        out.temperature = only.temperature;
+        if (imuExpected[0] && imuExpected[1]) {
+            imuStats.singleSamples++;
+        }
+        return;
+    }
+    
+    const MotionSample &a = parts[0];
+    const MotionSample &b = parts[1];
+    int32_t disagreeCounts = IMU_DISAGREE_G * ACCEL_SCALE_LSB_PER_G / (1 << accelRange);
+    if (abs(a.ax - b.ax) > disagreeCounts || abs(a.ay - b.ay) > disagreeCounts ||
+        abs(a.az - b.az) > disagreeCounts) {
+        imuStats.disagreements++;
+    }
+    out.ax = fuseAxis(a.ax, b.ax);
+    out.ay = fuseAxis(a.ay, b.ay);
+    out.az = fuseAxis(a.az, b.az);
+    out.gx = fuseAxis(a.gx, b.gx);
+    out.gy = fuseAxis(a.gy, b.gy);
+    out.gz = fuseAxis(a.gz, b.gz);
+    out.temperature = ((int32_t)a.temperature + b.temperature) / 2;
+    imuStats.fusedSamples++;
+}
+
+// Decide whether the next samples need a different full-scale range
+static void updateAutoRange(const MotionSample &sample) {
+    if (!autoRange) {
+        return;
+    }
+    
+    int peak = max(abs(sample.ax), max(abs(sample.ay), abs(sample.az)));
+    if (sample.accelRange != ACCEL_RANGE_16G) {
+        if (peak >= AUTO_RANGE_HIGH_COUNTS) {
+            requestedRange = ACCEL_RANGE_16G;
+        }
+        calmSinceUs = 0;
+        return;
+    }
+    
+    int calmCounts = AUTO_RANGE_CALM_G * ACCEL_SCALE_LSB_PER_G / (1 << ACCEL_RANGE_16G);
+    if (peak >= calmCounts) {
+        calmSinceUs = 0;
+    } else if (calmSinceUs == 0) {
+        calmSinceUs = sample.timestampUs | 1;
+    } else if (sample.timestampUs - calmSinceUs >= AUTO_RANGE_CALM_MS * 1000UL) {
+        requestedRange = ACCEL_RANGE_2G;
+        calmSinceUs = 0;
+    }
+}
+
+// Write a pending range change to the sensor; returns true if the range changed
+// Call only from the context that owns the I2C bus for the current mode.
+static bool applyRequestedRange() {
+    int8_t range = requestedRange;
+    requestedRange = -1;
+    if (range < 0 || range == accelRange) {
+        return false;
+    }
+    
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            imus[i].setAccelRange(range);
+        }
+    }
+    accelRange = range;
+    rangeChangePending = true;
+    return true;
+}
+
+// Write a pending rate/DLPF change to the sensor; returns true if it was applied
+// Call only from the context that owns the I2C bus for the current mode.
+static bool applyRequestedSampling() {
+    if (!samplingChangeRequested) {
+        return false;
+    }
+    samplingChangeRequested = false;
+    
+    configureSampleRate(configuredRateHz);
+    if (acquisitionMode == ACQ_MODE_INTERRUPT) {
+        memset(&timingStats, 0, sizeof(timingStats));
+    }
+    return true;
+}
+
+// Read accel, temperature and gyro in a single 14-byte I2C burst per IMU
+// At 400 kHz this takes ~0.4 ms, less than the former 6-byte accel-only read at 100 kHz.
+bool readMotion(MotionSample &sample) {
     if (!mpu6050Connected) {
-        ax = 0.0;
-        ay = 0.0;
-        az = 0.0;
+        return false;
+    }
+    
+    MotionSample parts[IMU_COUNT];
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (!imuActive[i]) {
+            continue;
+        }
+        uint8_t block[MPU_MOTION_BLOCK_BYTES];
+        if (readWithRetries([&] { return imus[i].readMotion(block); })) {
+            parseMotionBlock(block, parts[i]);
+            imuFailures[i] = 0;
+            mask |= 1 << i;
+        } else {
+            noteImuFailure(i);
+        }
+    }
+    sample.timestampUs = esp_timer_get_time();
+    sample.flags = 0;
+    
+    if (mask == 0) {
+        return false;
+    }
+    
+    fuseMotion(parts, mask, sample);
+    sample.accelRange = accelRange;
+    if (rangeChangePending) {
+        sample.flags |= SAMPLE_FLAG_RANGE_CHANGE;
+        rangeChangePending = false;
+    }
+    lastValidReading = millis();
+    consecutiveFailures = 0;
+    
+    // The next read is at least one sample period away - switch range now
+    updateAutoRange(sample);
+    applyRequestedRange();
+    applyRequestedSampling();
+    return true;
+}
+
+float accelToG(int16_t raw, uint8_t range) {
+    return raw * (1 << range) / ACCEL_SCALE_LSB_PER_G;
+}
+
+float gyroToDps(int16_t raw) {
+    return raw / GYRO_SCALE_LSB_PER_DPS;
+}
+
+float temperatureToCelsius(int16_t raw) {
+    return raw / TEMP_SCALE_LSB_PER_C + TEMP_OFFSET_C;
+}
+
+// Pick the widest DLPF bandwidth that is still below the Nyquist frequency
+static uint8_t dlpfModeForRate(uint16_t rateHz) {
+    if (rateHz >= 400) return MPU6050_DLPF_BW_188;
+    if (rateHz >= 200) return MPU6050_DLPF_BW_98;
+    if (rateHz >= 100) return MPU6050_DLPF_BW_42;
+    if (rateHz >= 50)  return MPU6050_DLPF_BW_20;
+    if (rateHz >= 20)  return MPU6050_DLPF_BW_10;
+    return MPU6050_DLPF_BW_5;
+}
+
+// Set the sample rate and the configured (or matching) DLPF bandwidth
+// The driver rounds the rate up to one it can produce, so an automatic DLPF
+// picked for the requested rate stays below Nyquist.
+static void configureSampleRate(uint16_t rateHz) {
+    rateHz = constrain(rateHz, (uint16_t)MIN_SAMPLE_RATE_HZ, (uint16_t)MAX_SAMPLE_RATE_HZ);
+    dlpfMode = configuredDlpf == DLPF_AUTO ? dlpfModeForRate(rateHz) : configuredDlpf;
+    
+    uint16_t rate = rateHz;
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            rate = imus[i].setSampleRate(rateHz, dlpfMode);
+        }
+    }
+    samplePeriodUs = 1000000UL / rate;
+    sampleRateHz = rate;
+}
+
+// Reset the FIFOs together so entry N of each IMU is taken at the same time
+static void resetFifo() {
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            imus[i].resetFifo();
+        }
+    }
+    nextSampleUs = esp_timer_get_time() + samplePeriodUs;
+}
+
+static void configureFifo() {
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            imus[i].configureFifo();
+        }
+    }
+    resetFifo();
+}
+
+static void fifoTask(void*);
+
+// Configure the sample-rate divider and FIFO for 6-axis + temperature bursts,
+// drained by the acquisition task every MPU_FIFO_DRAIN_MS
+bool initMPUFifo(uint16_t rateHz) {
+    if (!mpu6050Connected || samplingTaskHandle != nullptr) {
+        return false;
+    }
+    
+    configureSampleRate(rateHz);
+    configureFifo();
+    
+    ringHead = ringTail = 0;
+    pendingGap = false;
+    acquisitionMode = ACQ_MODE_FIFO;
+    xTaskCreatePinnedToCore(fifoTask, "mpu_fifo", SAMPLING_TASK_STACK, nullptr,
+                            SAMPLING_TASK_PRIORITY, &samplingTaskHandle, SAMPLING_TASK_CORE);
+    
+    Serial.print("MPU6050: FIFO acquisition at ");
+    Serial.print(sampleRateHz);
+    Serial.println(" Hz");
+    return true;
+}
+
+static void pushSample(const MotionSample &sample) {
+    uint16_t next = (ringHead + 1) & (SAMPLE_RING_SIZE - 1);
+    if (next == ringTail) {
+        // Consumer fell behind - drop this sample and flag the gap on the next one
+        pendingGap = true;
         return;
     }
+    sampleRing[ringHead] = sample;
+    ringHead = next;
+}
+
+// Parse whole FIFO entries into the ring, assigning each its sample time
+// Entry k of every IMU in mask is fused into one sample.
+static void parseFifoEntries(uint8_t mask, uint16_t entries) {
+    for (uint16_t k = 0; k < entries; k++) {
+        MotionSample parts[IMU_COUNT];
+        for (uint8_t i = 0; i < IMU_COUNT; i++) {
+            if (mask & (1 << i)) {
+                parseMotionBlock(fifoBuffers[i] + k * MPU_FIFO_ENTRY_BYTES, parts[i]);
+            }
+        }
+        MotionSample sample;
+        fuseMotion(parts, mask, sample);
+        sample.timestampUs = nextSampleUs;
+        sample.accelRange = accelRange;
+        sample.flags = pendingGap ? SAMPLE_FLAG_GAP : 0;
+        if (rangeChangePending) {
+            sample.flags |= SAMPLE_FLAG_RANGE_CHANGE;
+            rangeChangePending = false;
+        }
+        pendingGap = false;
+        updateAutoRange(sample);
+        nextSampleUs += samplePeriodUs;
+        pushSample(sample);
+    }
+}
+
+// Give up on this drain after a failed read on one IMU; entry alignment
+// between the FIFOs is lost with it
+static uint16_t abandonDrain(uint8_t index) {
+    noteImuFailure(index);
+    pendingGap = true;
+    resetFifo();
+    return 0;
+}
+
+// Read everything currently in the FIFO(s) into the sample ring
+// Sample times follow the fixed sample period. The timeline is nudged towards
+// the ESP32 clock on every drain so MPU oscillator drift does not accumulate;
+// the newest entry is assumed to be half a period old when read.
+//
+// With two IMUs the FIFOs are read in pairs. Their oscillators differ by up to
+// a few percent, so the faster one slowly gains entries; once its lead passes
+// IMU_MAX_FIFO_SKEW its oldest entry is discarded, keeping paired entries
+// within a couple of sample periods of each other.
+static uint16_t drainFifo() {
+    if (acquisitionMode != ACQ_MODE_FIFO || !mpu6050Connected) {
+        return 0;
+    }
     
-    // Raw sensor values
-    int16_t axRaw, ayRaw, azRaw;
-    mpu.getAcceleration(&axRaw, &ayRaw, &azRaw);
+    uint8_t mask = activeImuMask();
+    uint16_t available[IMU_COUNT] = {0, 0};
+    uint16_t entries = MPU_FIFO_SIZE;
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (!(mask & (1 << i))) {
+            continue;
+        }
+        uint16_t count;
+        bool overflow;
+        if (!readWithRetries([&] { return imus[i].readFifoCount(count, overflow); })) {
+            return abandonDrain(i);
+        }
+        
+        // Overflowed or misaligned - the entry boundaries can no longer be trusted
+        if (overflow || count >= MPU_FIFO_SIZE || count % MPU_FIFO_ENTRY_BYTES != 0) {
+            fifoOverflowCount++;
+            pendingGap = true;
+            resetFifo();
+            return 0;
+        }
+        available[i] = count / MPU_FIFO_ENTRY_BYTES;
+        entries = min(entries, available[i]);
+    }
+    uint64_t now = esp_timer_get_time();
+    
+    if (mask == (1 << IMU_COUNT) - 1) {
+        uint8_t ahead = available[0] > available[1] ? 0 : 1;
+        if (available[ahead] - entries > IMU_MAX_FIFO_SKEW) {
+            if (!readWithRetries([&] { return imus[ahead].readFifo(fifoBuffers[ahead], MPU_FIFO_ENTRY_BYTES); })) {
+                return abandonDrain(ahead);
+            }
+            imuStats.fifoSkewDrops++;
+        }
+    }
+    if (entries == 0) {
+        return 0;
+    }
+    
+    uint64_t expectedNewest = nextSampleUs + (uint64_t)(entries - 1) * samplePeriodUs;
+    int32_t error = (int32_t)(int64_t)(now - expectedNewest) - (int32_t)(samplePeriodUs / 2);
+    int32_t maxStep = samplePeriodUs / 4;  // Keeps timestamps strictly increasing
+    nextSampleUs += constrain(error / 8, -maxStep, maxStep);
+    
+    uint16_t remaining = entries;
+    while (remaining > 0) {
+        uint16_t chunk = min(remaining, (uint16_t)(MPU_FIFO_BURST_BYTES / MPU_FIFO_ENTRY_BYTES));
+        for (uint8_t i = 0; i < IMU_COUNT; i++) {
+            if (!(mask & (1 << i))) {
+                continue;
+            }
+            // Entry alignment is lost with a failed burst
+            if (!readWithRetries([&] { return imus[i].readFifo(fifoBuffers[i], chunk * MPU_FIFO_ENTRY_BYTES); })) {
+                return abandonDrain(i);
+            }
+        }
+        parseFifoEntries(mask, chunk);
+        remaining -= chunk;
+    }
     
-    // Check if values are reasonable (MPU6050 range: -32768 to 32767)
-    bool valuesValid = (axRaw >= -32768 && axRaw <= 32767) &&
-                       (ayRaw >= -32768 && ayRaw <= 32767) &&
-                       (azRaw >= -32768 && azRaw <= 32767);
+    // Discard entries taken since the drain so every FIFO entry after a
+    // switch is at the new range and sample period
+    bool rangeChanged = applyRequestedRange();
+    bool rateChanged = applyRequestedSampling();
+    if (rangeChanged || rateChanged) {
+        pendingGap = true;
+        resetFifo();
+    }
+    
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        imuFailures[i] = 0;
+    }
+    lastValidReading = millis();
+    consecutiveFailures = 0;
+    return entries;
+}
+
+// Data-ready ISR: timestamp the edge and wake the sampling task, nothing else
+static void IRAM_ATTR onMPUDataReady() {
+    isrTimestampUs = esp_timer_get_time();
+    isrCount++;
     
-    if (valuesValid) {
-        // Apply Kalman filter
-        float axFiltered = kalmanAx.updateEstimate(axRaw);
-        float ayFiltered = kalmanAy.updateEstimate(ayRaw);
-        float azFiltered = kalmanAz.updateEstimate(azRaw);
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(samplingTaskHandle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
 
-        // Normalize to -1 to 1 g
-        ax = axFiltered / ACCEL_RANGE;
-        ay = ayFiltered / ACCEL_RANGE;
-        az = azFiltered / ACCEL_RANGE;
+// Fold one sample interval into the running jitter statistics
+static void recordSampleInterval(uint32_t intervalUs) {
+    SampleTimingStats &t = timingStats;
+    if (t.intervals == 0 || intervalUs < t.minIntervalUs) {
+        t.minIntervalUs = intervalUs;
+    }
+    if (intervalUs > t.maxIntervalUs) {
+        t.maxIntervalUs = intervalUs;
+    }
+    t.intervals++;
+    float delta = intervalUs - t.meanIntervalUs;
+    t.meanIntervalUs += delta / t.intervals;
+    t.m2 += delta * (intervalUs - t.meanIntervalUs);
+}
+
+static void attemptRecovery();
+static void attemptRejoin();
+
+// Block the acquisition task while loop() owns the bus; true if it was paused
+static bool waitWhilePaused() {
+    if (!acquisitionPaused) {
+        return false;
+    }
+    acquisitionIdle = true;
+    while (acquisitionPaused) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    acquisitionIdle = false;
+    pendingGap = true;
+    return true;
+}
+
+// FIFO task: drain the FIFO into the sample ring on a fixed period
+static void fifoTask(void*) {
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(MPU_FIFO_DRAIN_MS));
+        if (waitWhilePaused()) {
+            lastWake = xTaskGetTickCount();
+            continue;
+        }
+        if (!mpu6050Connected) {
+            attemptRecovery();
+            continue;
+        }
+        drainFifo();
+        attemptRejoin();
+    }
+}
+
+// Sampling task: read one sample per data-ready edge at the edge's timestamp
+static void samplingTask(void*) {
+    uint32_t lastCount = isrCount;
+    uint64_t lastTimestamp = 0;
+    
+    for (;;) {
+        uint32_t waitMs = mpu6050Connected ? MPU_DATA_TIMEOUT : MPU_REINIT_BACKOFF_MIN_MS;
+        uint32_t notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+        if (waitWhilePaused()) {
+            lastCount = isrCount;
+            lastTimestamp = 0;
+            continue;
+        }
+        if (notified == 0) {
+            // Data-ready never stops on a working sensor - it was reset or unplugged
+            if (mpu6050Connected) {
+                markSensorLost("no data-ready edges");
+            }
+            attemptRecovery();
+            pendingGap = true;
+            lastTimestamp = 0;
+            continue;
+        }
+        if (!mpu6050Connected) {
+            // Lost to bus errors while INT keeps pulsing - recover, don't read
+            attemptRecovery();
+            pendingGap = true;
+            lastCount = isrCount;
+            lastTimestamp = 0;
+            continue;
+        }
         
-        lastValidReading = millis();
-        consecutiveFailures = 0;
-    } else {
-        consecutiveFailures++;
-        ax = 0.0;
-        ay = 0.0;
-        az = 0.0;
+        // A 64-bit store is two writes - retry if an edge landed in between
+        uint32_t count;
+        uint64_t timestamp;
+        do {
+            count = isrCount;
+            timestamp = isrTimestampUs;
+        } while (count != isrCount);
+        uint32_t edges = count - lastCount;
+        lastCount = count;
+        
+        MotionSample sample;
+        if (!readMotion(sample)) {
+            pendingGap = true;
+            lastTimestamp = 0;
+            continue;
+        }
+        if (isrCount != count) {
+            // An edge landed during a late read - the registers may already
+            // hold the newer sample, so this one's time is unknown. The next
+            // pass reads the newer one.
+            timingStats.missed += edges;
+            pendingGap = true;
+            lastTimestamp = 0;
+            continue;
+        }
+        sample.timestampUs = timestamp;
+
+        if (edges > 1) {
+            // Earlier edges were overwritten before we could read them
+            timingStats.missed += edges - 1;
+            pendingGap = true;
+        } else if (lastTimestamp != 0) {
+            recordSampleInterval((uint32_t)(timestamp - lastTimestamp));
+        }
+        lastTimestamp = timestamp;
+        
+        if (pendingGap) {
+            sample.flags |= SAMPLE_FLAG_GAP;
+            pendingGap = false;
+        }
+        pushSample(sample);
+        attemptRejoin();
+    }
+}
+
+// Only the primary's INT line is wired; the secondary is read on its edges
+static void configureDataReadyInterrupt() {
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            imus[i].configureDataReady();
+        }
+    }
+}
+
+// Sample on the MPU6050 data-ready interrupt instead of polling from loop()
+// Returns false (and leaves the current mode unchanged) if no interrupt edge
+// arrives, e.g. because the INT pin is not wired.
+bool initMPUInterrupt(uint16_t rateHz) {
+    if (!mpu6050Connected) {
+        return false;
+    }
+    
+    configureSampleRate(rateHz);
+    configureDataReadyInterrupt();
+    
+    memset(&timingStats, 0, sizeof(timingStats));
+    ringHead = ringTail = 0;
+    pendingGap = false;
+    
+    if (samplingTaskHandle == nullptr) {
+        xTaskCreatePinnedToCore(samplingTask, "mpu_sampling", SAMPLING_TASK_STACK, nullptr,
+                                SAMPLING_TASK_PRIORITY, &samplingTaskHandle, SAMPLING_TASK_CORE);
+    }
+    
+    uint32_t startCount = isrCount;
+    pinMode(MPU_INT_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(MPU_INT_PIN), onMPUDataReady, RISING);
+    delay(MPU_INT_PROBE_MS);
+    
+    if (isrCount == startCount) {
+        detachInterrupt(digitalPinToInterrupt(MPU_INT_PIN));
+        for (uint8_t i = 0; i < IMU_COUNT; i++) {
+            imus[i].disableDataReady();
+        }
+        vTaskDelete(samplingTaskHandle);
+        samplingTaskHandle = nullptr;
+        ringHead = ringTail = 0;
+        Serial.println("MPU6050: ✗ No data-ready interrupt - check INT->GPIO19 wiring");
+        return false;
+    }
+    
+    interruptWired = true;
+    acquisitionMode = ACQ_MODE_INTERRUPT;
+    Serial.print("MPU6050: Interrupt-driven acquisition at ");
+    Serial.print(sampleRateHz);
+    Serial.println(" Hz");
+    return true;
+}
+
+// Re-initialize a lost sensor with exponential backoff
+// Runs in the context that owns the bus, and only while the sensor is marked
+// lost - readMotion() and drainFifo() return early until it succeeds.
+static void attemptRecovery() {
+    if (mpu6050Connected || millis() - lastRecoveryAttempt < recoveryBackoffMs) {
+        return;
+    }
+    lastRecoveryAttempt = millis();
+    i2cStats.reinitAttempts++;
+    
+    recoverI2CBus();
+    if (!configureMPU()) {
+        recoveryBackoffMs = min(recoveryBackoffMs * 2, (uint32_t)MPU_REINIT_BACKOFF_MAX_MS);
+        Serial.print("MPU6050: ✗ Re-init failed - next attempt in ");
+        Serial.print(recoveryBackoffMs);
+        Serial.println(" ms");
+        return;
+    }
+    
+    // Restore the acquisition configuration lost in the reset
+    configureSampleRate(configuredRateHz);
+    if (acquisitionMode == ACQ_MODE_FIFO) {
+        configureFifo();
+    } else if (acquisitionMode == ACQ_MODE_INTERRUPT) {
+        configureDataReadyInterrupt();
+    }
+    pendingGap = true;
+    
+    i2cStats.reinits++;
+    recoveryBackoffMs = MPU_REINIT_BACKOFF_MIN_MS;
+    consecutiveFailures = 0;
+    lastValidReading = millis();
+    mpu6050Initialized = true;
+    mpu6050Connected = true;
+    Serial.println("MPU6050: ✓ Sensor recovered");
+}
+
+// Bring a dropped IMU back while the other one carries on
+// Runs in the context that owns the bus, at the slowest re-init backoff.
+static void attemptRejoin() {
+    if (!mpu6050Connected || millis() - lastRejoinAttempt < MPU_REINIT_BACKOFF_MAX_MS) {
+        return;
+    }
+    lastRejoinAttempt = millis();
+    
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (!imuExpected[i] || imuActive[i] || !imus[i].configure(accelRange)) {
+            continue;
+        }
+        imus[i].setSampleRate(sampleRateHz, dlpfMode);
+        if (acquisitionMode == ACQ_MODE_FIFO) {
+            imus[i].configureFifo();
+        } else if (acquisitionMode == ACQ_MODE_INTERRUPT) {
+            imus[i].configureDataReady();
+        }
+        imuActive[i] = true;
+        imuFailures[i] = 0;
+        if (acquisitionMode == ACQ_MODE_FIFO) {
+            pendingGap = true;
+            resetFifo();
+        }
+        Serial.print("MPU6050: ✓ IMU 0x");
+        Serial.print(imus[i].address(), HEX);
+        Serial.println(" back in use");
+    }
+}
+
+// Polled mode: recover from loop() (the acquisition task does this itself)
+// Polling is only the fallback for a sensor missing at boot, so once it
+// answers acquisition moves to the interrupt or FIFO task as in setup().
+void serviceMPURecovery() {
+    if (samplingTaskHandle != nullptr) {
+        return;
+    }
+    bool wasConnected = mpu6050Connected;
+    attemptRecovery();
+    attemptRejoin();
+    if (!wasConnected && mpu6050Connected && !motionWakeActive) {
+        if (!initMPUInterrupt(configuredRateHz)) {
+            initMPUFifo(configuredRateHz);
+        }
+    }
+}
+
+// Stop the acquisition task and hand the bus to the caller (loop())
+static bool pauseAcquisition() {
+    if (samplingTaskHandle == nullptr) {
+        return true;
+    }
+    if (acquisitionMode == ACQ_MODE_INTERRUPT) {
+        detachInterrupt(digitalPinToInterrupt(MPU_INT_PIN));
+    }
+    acquisitionPaused = true;
+    xTaskNotifyGive(samplingTaskHandle);
+    
+    unsigned long start = millis();
+    while (!acquisitionIdle) {
+        if (millis() - start >= MPU_TASK_PAUSE_TIMEOUT_MS) {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+static void resumeAcquisition() {
+    if (samplingTaskHandle == nullptr) {
+        return;
+    }
+    acquisitionPaused = false;
+    xTaskNotifyGive(samplingTaskHandle);
+    if (acquisitionMode == ACQ_MODE_INTERRUPT) {
+        attachInterrupt(digitalPinToInterrupt(MPU_INT_PIN), onMPUDataReady, RISING);
+    }
+}
+
+// Park the sensor: stop acquisition, put the accel in low-power cycle mode
+// with the gyro and temperature sensor in standby, and latch the motion
+// interrupt on MPU_INT_PIN. Both IMUs are parked and either one's motion
+// status wakes the device. Returns false (acquisition unchanged) if the
+// sensor is not available.
+bool enterMotionWake(float thresholdG) {
+    if (!mpu6050Connected) {
+        return false;
+    }
+    if (!pauseAcquisition()) {
+        resumeAcquisition();
+        return false;
+    }
+    
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            imus[i].enterMotionWake(thresholdG);
+        }
+    }
+    motionWakeActive = true;
+    return true;
+}
+
+// Read and clear the latched motion status of every parked IMU
+// A failed read reports motion - waking up is the safe answer.
+bool isMotionWakePending() {
+    bool pending = false;
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (!imuActive[i]) {
+            continue;
+        }
+        bool motion;
+        if (!readWithRetries([&] { return imus[i].readMotionStatus(motion); })) {
+            noteImuFailure(i);
+            return true;
+        }
+        pending |= motion;
+    }
+    return pending;
+}
+
+// Return to full-rate acquisition in the mode that was active before parking
+void exitMotionWake() {
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            imus[i].exitMotionWake();
+        }
+    }
+    motionWakeActive = false;
+    
+    configureSampleRate(configuredRateHz);
+    if (acquisitionMode == ACQ_MODE_FIFO) {
+        configureFifo();
+    } else if (acquisitionMode == ACQ_MODE_INTERRUPT) {
+        configureDataReadyInterrupt();
+    }
+    bool answered = false;
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            imus[i].clearInterrupts();
+            answered |= imus[i].probe();
+        }
+    }
+    if (!answered) {
+        markSensorLost("no answer after wake");
+    }
+    
+    pendingGap = true;
+    lastValidReading = millis();
+    resumeAcquisition();
+}
+
+bool isMPUInterruptWired() {
+    return interruptWired;
+}
+
+// Self-test every active IMU, then restore the acquisition configuration
+// Call with the bus owned: from initMPU(), or with acquisition paused.
+static void runSelfTests() {
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (!imuActive[i]) {
+            continue;
+        }
+        ImuSelfTest result = {};
+        for (uint8_t attempt = 0; attempt < SELF_TEST_ATTEMPTS && !result.passed; attempt++) {
+            if (!imus[i].selfTest(result)) {
+                break;  // Not answering - left to the normal read failure handling
+            }
+        }
+        selfTestResults[i] = result;
         
-        if (consecutiveFailures >= MAX_CONSECUTIVE_FAILURES) {
-            mpu6050Connected = false;
+        Serial.print("MPU6050: IMU 0x");
+        Serial.print(imus[i].address(), HEX);
+        if (!result.ran) {
+            Serial.println(" self-test not completed");
+        } else if (result.passed) {
+            Serial.print(" ✓ self-test passed");
+            if (result.untestedAxes != 0) {
+                Serial.print(" - no factory trim on axes 0x");
+                Serial.print(result.untestedAxes, HEX);
+            }
+            Serial.println();
+        } else {
+            Serial.print(" ✗ SELF-TEST FAILED - axes 0x");
+            Serial.println(result.failedAxes, HEX);
+        }
+    }
+    
+    // Keep only the good IMU of a pair
+    const ImuSelfTest &first = selfTestResults[0];
+    const ImuSelfTest &second = selfTestResults[1];
+    if (imuActive[0] && imuActive[1] && first.ran && second.ran && first.passed != second.passed) {
+        uint8_t failed = first.passed ? 1 : 0;
+        imuActive[failed] = false;
+        imuExpected[failed] = false;
+        Serial.println("MPU6050: Failed IMU excluded - continuing on the other");
+    }
+    
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i]) {
+            imus[i].configure(accelRange);
+        }
+    }
+    configureSampleRate(configuredRateHz);
+    if (acquisitionMode == ACQ_MODE_FIFO) {
+        configureFifo();
+    } else if (acquisitionMode == ACQ_MODE_INTERRUPT) {
+        configureDataReadyInterrupt();
+    }
+    pendingGap = true;
+    lastValidReading = millis();
+}
+
+// Run the factory self-test now (from loop()); false if it could not run
+bool runMPUSelfTest() {
+    selfTestDueMs = 0;
+    if (!mpu6050Connected || motionWakeActive) {
+        return false;
+    }
+    if (!pauseAcquisition()) {
+        resumeAcquisition();
+        return false;
+    }
+    runSelfTests();
+    resumeAcquisition();
+    return true;
+}
+
+// Run the deferred boot self-test once it is due (call from loop())
+void serviceMPUSelfTest() {
+    if (selfTestDueMs != 0 && (long)(millis() - selfTestDueMs) >= 0) {
+        runMPUSelfTest();
+    }
+}
+
+const ImuSelfTest& getSelfTestResult(uint8_t imu) {
+    return selfTestResults[min(imu, (uint8_t)(IMU_COUNT - 1))];
+}
+
+uint8_t getImuAddress(uint8_t imu) {
+    return imus[min(imu, (uint8_t)(IMU_COUNT - 1))].address();
+}
+
+// Is an IMU in use known to have failed its self-test?
+bool isSelfTestFailed() {
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuActive[i] && selfTestResults[i].ran && !selfTestResults[i].passed) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const I2CStats& getI2CStats() {
+    return i2cStats;
+}
+
+const ImuStats& getImuStats() {
+    imuStats.present = 0;
+    for (uint8_t i = 0; i < IMU_COUNT; i++) {
+        if (imuExpected[i]) {
+            imuStats.present |= 1 << i;
+        }
+    }
+    imuStats.active = activeImuMask();
+    return imuStats;
+}
+
+uint8_t getAcquisitionMode() {
+    return acquisitionMode;
+}
+
+const SampleTimingStats& getSampleTimingStats() {
+    return timingStats;
+}
+
+// Standard deviation of the sample interval
+float getSampleJitterUs() {
+    if (timingStats.intervals < 2) {
+        return 0.0;
+    }
+    return sqrt(timingStats.m2 / (timingStats.intervals - 1));
+}
+
+bool popSample(MotionSample &sample) {
+    if (ringTail == ringHead) {
+        return false;
+    }
+    sample = sampleRing[ringTail];
+    ringTail = (ringTail + 1) & (SAMPLE_RING_SIZE - 1);
+    return true;
+}
+
+uint16_t getSampleCount() {
+    return (ringHead - ringTail) & (SAMPLE_RING_SIZE - 1);
+}
+
+uint16_t getSampleRate() {
+    return acquisitionMode == ACQ_MODE_POLL ? 0 : sampleRateHz;
+}
+
+// Change the output data rate and DLPF mode (MPU6050_DLPF_BW_* or DLPF_AUTO)
+// The setting is stored and takes effect at the next sample read or FIFO drain.
+bool setSamplingConfig(uint16_t rateHz, uint8_t dlpf) {
+    if (rateHz < MIN_SAMPLE_RATE_HZ || rateHz > MAX_SAMPLE_RATE_HZ) {
+        return false;
+    }
+    if (dlpf != DLPF_AUTO && (dlpf < MPU6050_DLPF_BW_188 || dlpf > MPU6050_DLPF_BW_5)) {
+        return false;
+    }
+    configuredRateHz = rateHz;
+    configuredDlpf = dlpf;
+    saveSamplingConfig();
+    samplingChangeRequested = true;
+    return true;
+}
+
+uint16_t getConfiguredSampleRate() {
+    return configuredRateHz;
+}
+
+uint8_t getConfiguredDlpf() {
+    return configuredDlpf;
+}
+
+uint16_t getDlpfBandwidthHz() {
+    return DLPF_BANDWIDTH_HZ[dlpfMode];
+}
+
+// Look up the DLPF mode for a bandwidth in Hz (0 selects DLPF_AUTO)
+bool dlpfModeForBandwidth(uint16_t bandwidthHz, uint8_t &mode) {
+    if (bandwidthHz == 0) {
+        mode = DLPF_AUTO;
+        return true;
+    }
+    for (uint8_t m = MPU6050_DLPF_BW_188; m <= MPU6050_DLPF_BW_5; m++) {
+        if (DLPF_BANDWIDTH_HZ[m] == bandwidthHz) {
+            mode = m;
+            return true;
         }
     }
+    return false;
+}
+
+uint32_t getFifoOverflowCount() {
+    return fifoOverflowCount;
+}
+
+void filterSample(const MotionSample &sample, float &ax, float &ay, float &az) {
+    applyFilter(sample, ax, ay, az);
+}
+
+// Fix the accel full-scale range (disables auto-ranging)
+// Takes effect at the next sample read.
+void setAccelRange(uint8_t range) {
+    autoRange = false;
+    requestedRange = min(range, (uint8_t)ACCEL_RANGE_16G);
+}
+
+void setAccelAutoRange(bool enabled) {
+    calmSinceUs = 0;
+    autoRange = enabled;
+}
+
+uint8_t getAccelRange() {
+    return accelRange;
+}
+
+bool isAccelAutoRange() {
+    return autoRange;
 }
 
 bool isMPU6050Connected() {
@@ -104,19 +1354,32 @@ bool isMPU6050Working() {
 // 0 = MPU6050 device not working (not connected or no I2C communication)
 // 1 = MPU6050 connected but readings unstable/invalid
 // 2 = MPU6050 working properly (valid readings)
+// 3 = MPU6050 output frozen (HEALTH_FROZEN)
+// 4 = MPU6050 accel held at full scale (HEALTH_SATURATED)
+// 5 = MPU6050 gravity reading implausible at rest (HEALTH_GRAVITY)
+// 6 = MPU6050 failed its factory self-test (MPU_STATUS_SELF_TEST_FAILED)
 int getMPUStatus() {
     // Check if MPU6050 is connected via I2C
     if (!mpu6050Connected) {
         return 0; // Device not working
     }
     
-    // Check if MPU6050 has valid recent readings
-    if (isMPU6050Working() && consecutiveFailures == 0) {
-        return 2; // Working properly
+    // MPU6050 is connected but readings are unstable
+    if (!isMPU6050Working() || consecutiveFailures != 0) {
+        return 1; // Readings unstable
     }
     
-    // MPU6050 is connected but readings are unstable
-    return 1; // Readings unstable
+    // A failed self-test outranks the statistical health checks
+    if (isSelfTestFailed()) {
+        return MPU_STATUS_SELF_TEST_FAILED;
+    }
+    
+    // Readings arrive - check that they still measure anything
+    uint8_t health = getSensorHealthStatus();
+    if (health != HEALTH_OK) {
+        return health;
+    }
+    return 2; // Working properly
 }
 
 // Get user-friendly status message
@@ -130,6 +1393,14 @@ const char* getMPUStatusMessage() {
             return "[Status: 1] MPU6050 readings unstable - Check sensor";
         case 2:
             return "[Status: 2] MPU6050 tracking active";
+        case 3:
+            return "[Status: 3] MPU6050 output frozen - Sensor faulty";
+        case 4:
+            return "[Status: 4] MPU6050 readings saturated - Check sensor mounting";
+        case 5:
+            return "[Status: 5] MPU6050 gravity reading implausible - Recalibrate or replace sensor";
+        case 6:
+            return "[Status: 6] MPU6050 self-test failed - Replace sensor before riding";
         default:
             return "[Status: ?] MPU6050 status unknown";
     }
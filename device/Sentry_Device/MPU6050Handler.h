@@ -2,13 +2,215 @@
 #define MPU6050HANDLER_H
 
 #include <MPU6050.h>
+#include "ImuDriver.h"
 
-// MPU6050 by Electronic Cats
+// MPU6050 by Electronic Cats, accessed through Mpu6050Driver (ImuDriver.h)
 
-extern MPU6050 mpu;
+// Acquisition Modes
+#define ACQ_MODE_POLL              0     // One 14-byte accel/temp/gyro burst read per loop() pass
+#define ACQ_MODE_FIFO              1     // Hardware FIFO drained in bursts by a periodic task
+#define ACQ_MODE_INTERRUPT         2     // Data-ready interrupt wakes a dedicated sampling task
+
+// Interrupt Acquisition Constants
+#define MPU_INT_PIN                19    // MPU6050 INT -> GPIO19
+#define SAMPLING_TASK_PRIORITY     5     // Above loop() so samples are read on time
+#define SAMPLING_TASK_STACK        3072
+#define SAMPLING_TASK_CORE         1
+#define MPU_INT_PROBE_MS           100   // Time allowed for the first data-ready edge
+
+// I2C Bus Constants
+#define MPU_SDA_PIN                21
+#define MPU_SCL_PIN                22
+#define MPU_I2C_CLOCK_HZ           400000  // Fast mode - keeps FIFO bursts short
+#define MPU_I2C_TIMEOUT_MS         10    // A stuck slave must not hang the caller
+#define MPU_I2C_MAX_RETRIES        2     // Extra attempts per register read...
+#define MPU_I2C_RETRY_BUDGET_US    2000  // ...while still within this budget
+#define MPU_BUS_RECOVERY_PULSES    9     // SCL pulses to release a slave holding SDA low
+#define MPU_REINIT_BACKOFF_MIN_MS  500   // First automatic re-init after the sensor drops out
+#define MPU_REINIT_BACKOFF_MAX_MS  30000 // Backoff doubles up to this
+#define MPU_STARTUP_TIMEOUT_MS     100   // Power-up to first register access, worst case
+#define MPU_STARTUP_POLL_MS        5
+
+// Redundant IMU Constants
+// A second MPU6050 with AD0 tied high may share the bus. It is probed at boot,
+// configured like the primary, and every sample is the per-axis mean of both;
+// if either one fails the other carries on alone. Both must be mounted with
+// the same axis orientation. The data-ready and motion INT line is taken from
+// the primary.
+#define IMU_PRIMARY_ADDRESS        MPU6050_ADDRESS_AD0_LOW   // 0x68
+#define IMU_SECONDARY_ADDRESS      MPU6050_ADDRESS_AD0_HIGH  // 0x69
+#define IMU_COUNT                  2
+#define IMU_DISAGREE_G             0.5   // Accel difference counted as a disagreement
+#define IMU_MAX_FIFO_SKEW          2     // FIFO entries one IMU may run ahead before one is dropped
+
+// Motion Block Constants
+#define MPU_MOTION_BLOCK_BYTES     14    // ACCEL_XOUT_H..GYRO_ZOUT_L: accel, temp, gyro (big-endian int16)
+#define GYRO_SCALE_LSB_PER_DPS     16.4  // ±2000 °/s full scale
+#define TEMP_SCALE_LSB_PER_C       340.0
+#define TEMP_OFFSET_C              36.53
+
+// Wake-on-Motion Constants
+// Parked, the accel runs in low-power cycle mode and the motion interrupt
+// compares each high-passed sample against the threshold, so motion is seen
+// within one wake period (25 ms at 40 Hz).
+#define MOTION_WAKE_MG_PER_LSB     2     // MOT_THR resolution
+#define MOTION_WAKE_DURATION       1     // Samples above threshold before the interrupt fires
+#define MOTION_WAKE_FREQ           MPU6050_WAKE_FREQ_40
+#define MPU_TASK_PAUSE_TIMEOUT_MS  50    // Time allowed for the acquisition task to go idle
+
+// Self-Test Constants
+// The self-test actuators deflect every axis by a factory-trimmed amount; a
+// response more than 14 % off the trim means a damaged proof mass or gyro
+// drive, which WHO_AM_I alone does not reveal.
+#define SELF_TEST_TOLERANCE        0.14
+#define SELF_TEST_SAMPLES          50    // Samples averaged with the actuators off, then on
+#define SELF_TEST_SETTLE_MS        20
+#define SELF_TEST_ATTEMPTS         2     // A bump during the test can fail it once
+#define SELF_TEST_BOOT_OFF         0
+#define SELF_TEST_BOOT_BLOCKING    1     // Inside initMPU() (~150 ms longer startup)
+#define SELF_TEST_BOOT_DEFERRED    2     // From loop() shortly after startup
+#define SELF_TEST_AT_BOOT          SELF_TEST_BOOT_DEFERRED
+#define SELF_TEST_DEFER_MS         2000  // Boot -> deferred self-test
+#define MPU_STATUS_SELF_TEST_FAILED 6    // getMPUStatus() code
+
+// Accelerometer Full-Scale Range (MPU6050_ACCEL_FS_* register values)
+// Each step doubles the range and halves the counts per g.
+#define ACCEL_RANGE_2G             0
+#define ACCEL_RANGE_4G             1
+#define ACCEL_RANGE_8G             2
+#define ACCEL_RANGE_16G            3
+#define DEFAULT_ACCEL_RANGE        ACCEL_RANGE_2G
+#define ACCEL_SCALE_LSB_PER_G      16384.0  // At ±2 g
+
+// Auto-Ranging
+// ±2 g resolves tilt finely but clips during an impact, so the range jumps to
+// ±16 g as soon as any axis nears full scale and drops back once motion calms.
+#define AUTO_RANGE_HIGH_COUNTS     29491    // 90% of full scale
+#define AUTO_RANGE_CALM_G          1.5      // Every axis below this...
+#define AUTO_RANGE_CALM_MS         2000     // ...for this long returns to ±2 g
+
+// FIFO Acquisition Constants
+#define MPU_FIFO_SIZE              1024  // Bytes of on-chip FIFO
+#define MPU_FIFO_ENTRY_BYTES       MPU_MOTION_BLOCK_BYTES  // Same layout as the register block
+#define MPU_FIFO_DRAIN_MS          10    // Acquisition task drain period (FIFO holds ~70 ms at 1 kHz)
+#define MPU_FIFO_BURST_BYTES       126   // Whole entries that fit I2Cdev::readBytes()' int8_t count
+#define MPU_GYRO_OUTPUT_RATE_HZ    1000  // Sample-rate divider base when the DLPF is enabled
+#define SAMPLE_RING_SIZE           256   // Must be a power of two
+#define DEFAULT_SAMPLE_RATE_HZ     200
+#define MIN_SAMPLE_RATE_HZ         4
+#define MAX_SAMPLE_RATE_HZ         1000
+
+// Sampling Configuration (persisted in NVS)
+// DLPF modes are MPU6050_DLPF_BW_188..MPU6050_DLPF_BW_5; BW_256 is not offered
+// because it switches the divider base to 8 kHz while the accel stays at 1 kHz.
+#define DLPF_AUTO                  0xFF  // Widest bandwidth below Nyquist for the rate
+#define SAMPLING_NVS_NAMESPACE     "sentry"
+#define SAMPLING_NVS_KEY           "sampling"
+#define SAMPLING_CONFIG_VERSION    1
+
+// Filter Tuning Reference
+// Accel filter noise terms are given for this rate and bandwidth and re-derived
+// for the configured ones: process noise per sample scales with the sample
+// period, measurement noise with the square root of the DLPF bandwidth.
+#define FILTER_REFERENCE_RATE_HZ   200
+#define FILTER_REFERENCE_DLPF_HZ   98
+
+// Sample Flags
+#define SAMPLE_FLAG_GAP            0x01  // Samples were lost (FIFO or ring overflow) before this one
+#define SAMPLE_FLAG_RANGE_CHANGE   0x02  // First sample at a new accel full-scale range
+
+// One raw 6-axis sample with its acquisition time
+// Sample times come from esp_timer: a 64-bit microsecond count kept by a
+// hardware timer that runs through light sleep and never wraps in practice.
+// micros() is its low 32 bits, so latency stamps stay comparable.
+struct MotionSample {
+  uint64_t timestampUs;          // esp_timer_get_time() at which the IMU took the sample
+  int16_t ax, ay, az;            // Raw accelerometer counts
+  int16_t gx, gy, gz;            // Raw gyroscope counts
+  int16_t temperature;           // Raw die temperature
+  uint8_t accelRange;            // ACCEL_RANGE_* the accel counts were taken at
+  uint8_t flags;                 // SAMPLE_FLAG_*
+};
+
+// Sample interval statistics (interrupt mode)
+struct SampleTimingStats {
+  uint32_t intervals;            // Intervals measured
+  uint32_t minIntervalUs;
+  uint32_t maxIntervalUs;
+  float meanIntervalUs;
+  float m2;                      // Sum of squared deviations from the mean (Welford)
+  uint32_t missed;               // Data-ready edges not serviced before the next one
+};
+
+// Stored output data rate and DLPF bandwidth
+struct SamplingConfig {
+  uint8_t version;               // SAMPLING_CONFIG_VERSION
+  uint16_t rateHz;
+  uint8_t dlpf;                  // MPU6050_DLPF_BW_* or DLPF_AUTO
+};
+
+// I2C transaction counters
+struct I2CStats {
+  uint32_t transactions;         // Register reads requested
+  uint32_t errors;               // Failed attempts
+  uint32_t retries;              // Attempts made after a failure
+  uint32_t failures;             // Reads that failed after every retry
+  uint32_t busRecoveries;        // SCL clock-pulse recoveries performed
+  uint32_t reinitAttempts;
+  uint32_t reinits;              // Successful automatic re-initializations
+};
+
+// Redundant IMU counters
+struct ImuStats {
+  uint8_t present;               // Bit per IMU expected on the bus (primary always)
+  uint8_t active;                // Bit per IMU currently sampled
+  uint32_t fusedSamples;         // Samples averaged from both IMUs
+  uint32_t singleSamples;        // Samples from one IMU while the other was out
+  uint32_t disagreements;        // Fused samples whose accel differed by more than IMU_DISAGREE_G
+  uint32_t fifoSkewDrops;        // FIFO entries dropped to keep the two IMUs paired
+  uint32_t dropouts;             // Times one IMU was taken out while the other carried on
+};
 
 void initMPU();
-void readAccel(float &ax, float &ay, float &az);
+bool readMotion(MotionSample &sample);
+float accelToG(int16_t raw, uint8_t range);
+float gyroToDps(int16_t raw);
+float temperatureToCelsius(int16_t raw);
+
+// FIFO burst / interrupt-driven acquisition
+uint8_t getAcquisitionMode();
+bool initMPUFifo(uint16_t sampleRateHz);
+bool initMPUInterrupt(uint16_t sampleRateHz);
+bool popSample(MotionSample &sample);
+uint16_t getSampleCount();
+uint16_t getSampleRate();
+bool setSamplingConfig(uint16_t rateHz, uint8_t dlpf);
+uint16_t getConfiguredSampleRate();
+uint8_t getConfiguredDlpf();
+uint16_t getDlpfBandwidthHz();
+bool dlpfModeForBandwidth(uint16_t bandwidthHz, uint8_t &mode);
+uint32_t getFifoOverflowCount();
+const SampleTimingStats& getSampleTimingStats();
+float getSampleJitterUs();
+void filterSample(const MotionSample &sample, float &ax, float &ay, float &az);
+bool setAccelFilterNoise(float measurementNoise, float estimateError, float processNoise);
+void getAccelFilterNoise(float &measurementNoise, float &estimateError, float &processNoise);
+void setAccelRange(uint8_t range);
+void setAccelAutoRange(bool enabled);
+uint8_t getAccelRange();
+bool isAccelAutoRange();
+void serviceMPURecovery();
+bool enterMotionWake(float thresholdG);
+bool isMotionWakePending();
+void exitMotionWake();
+bool isMPUInterruptWired();
+bool runMPUSelfTest();
+void serviceMPUSelfTest();
+const ImuSelfTest& getSelfTestResult(uint8_t imu);
+uint8_t getImuAddress(uint8_t imu);
+bool isSelfTestFailed();
+const I2CStats& getI2CStats();
+const ImuStats& getImuStats();
 bool isMPU6050Connected();
 bool isMPU6050Working();
 int getMPUStatus();
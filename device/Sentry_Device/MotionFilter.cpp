@@ -0,0 +1,131 @@
+#include "MotionFilter.h"
+
+#define MOTION_FILTER_MIN_NOISE    1e-6f       // Keeps the gain denominator non-zero
+
+// Gain the error terms converge to: the fixed point of
+//   p = (1 - k) * (p + q),  k = (p + q) / (p + q + r)
+// Only the ratio q / r matters, so the gain survives a change of units.
+float getMotionFilterSteadyGain(float measurementNoise, float processNoise) {
+    float r = max(measurementNoise, MOTION_FILTER_MIN_NOISE);
+    float q = max(processNoise, 0.0f);
+    float predicted = (q + sqrtf(q * q + 4.0f * q * r)) / 2.0f;
+    return predicted / (predicted + r);
+}
+
+static uint16_t toGainQ15(float gain) {
+    long scaled = lroundf(gain * (1UL << MOTION_FILTER_GAIN_Q));
+    return (uint16_t)constrain(scaled, 1L, (long)MOTION_FILTER_MAX_GAIN);
+}
+
+// Advance the error terms by one sample and set the gain for the next one;
+// settled once the Q15 gain is within one step of the steady-state gain
+static void stepGain(MotionFilter &filter) {
+    float predicted = filter.errEstimate + filter.processNoise;
+    float gain = predicted / (predicted + filter.errMeasure);
+    filter.errEstimate = (1.0f - gain) * predicted;
+    filter.gain = toGainQ15(gain);
+    if (abs((int)filter.gain - (int)filter.steadyGain) <= 1) {
+        filter.gain = filter.steadyGain;
+        filter.settling = false;
+    }
+}
+
+void setMotionFilterNoise(MotionFilter &filter, float measurementNoise, float estimateError, float processNoise) {
+    filter.errMeasure = max(measurementNoise, MOTION_FILTER_MIN_NOISE);
+    filter.processNoise = max(processNoise, 0.0f);
+    filter.errEstimate = max(estimateError, 0.0f);
+    filter.steadyGain = toGainQ15(getMotionFilterSteadyGain(filter.errMeasure, filter.processNoise));
+    filter.settling = true;
+    stepGain(filter);
+}
+
+void initMotionFilter(MotionFilter &filter, float measurementNoise, float estimateError, float processNoise) {
+    setMotionFilterNoise(filter, measurementNoise, estimateError, processNoise);
+    filter.primed = false;
+}
+
+// Filter one 3-axis sample; outputs are Q16.16 counts
+void updateMotionFilter(MotionFilter &filter, const int16_t raw[MOTION_FILTER_AXES], int32_t out[MOTION_FILTER_AXES]) {
+    if (!filter.primed) {
+        for (uint8_t i = 0; i < MOTION_FILTER_AXES; i++) {
+            filter.estimate[i] = (int32_t)raw[i] << MOTION_FILTER_Q;
+            out[i] = filter.estimate[i];
+        }
+        filter.primed = true;
+        return;
+    }
+    
+    // With estimate = high * 2^16 + low, the Q16.16 step gain * (raw - estimate)
+    // is 2 * gain * (raw - high) - gain * low / 2^15. Both products fit in 32
+    // bits; the sum may wrap, but it is exact modulo 2^32 and the new estimate
+    // lies between the old one and raw, so it comes out right.
+    uint32_t gain = filter.gain;
+    int32_t next[MOTION_FILTER_AXES];
+    for (uint8_t i = 0; i < MOTION_FILTER_AXES; i++) {
+        int32_t estimate = filter.estimate[i];
+        int32_t high = estimate >> MOTION_FILTER_Q;
+        uint32_t low = (uint32_t)estimate & ((1UL << MOTION_FILTER_Q) - 1);
+        uint32_t step = (uint32_t)(raw[i] - high) * (gain << 1) - ((low * gain) >> MOTION_FILTER_GAIN_Q);
+        next[i] = (int32_t)((uint32_t)estimate + step);
+    }
+    // Stored only once all axes are computed, so no load waits on a store
+    for (uint8_t i = 0; i < MOTION_FILTER_AXES; i++) {
+        filter.estimate[i] = next[i];
+        out[i] = next[i];
+    }
+    
+    if (filter.settling) {
+        stepGain(filter);
+    }
+}
+
+// Re-express the estimate in counts 2^shift times as fine, e.g. after the
+// sensor full-scale range changes; the gain does not depend on the units
+void rescaleMotionFilter(MotionFilter &filter, int8_t shift) {
+    for (uint8_t i = 0; i < MOTION_FILTER_AXES; i++) {
+        if (shift >= 0) {
+            int32_t limit = INT32_MAX >> shift;
+            filter.estimate[i] = (int32_t)((uint32_t)constrain(filter.estimate[i], -limit, limit) << shift);
+        } else {
+            filter.estimate[i] >>= -shift;
+        }
+    }
+}
+
+void setMotionFilterNoise(MotionFilterFloat &filter, float measurementNoise, float estimateError, float processNoise) {
+    filter.errMeasure = max(measurementNoise, MOTION_FILTER_MIN_NOISE);
+    filter.processNoise = max(processNoise, 0.0f);
+    filter.errEstimate = max(estimateError, 0.0f);
+}
+
+void initMotionFilter(MotionFilterFloat &filter, float measurementNoise, float estimateError, float processNoise) {
+    setMotionFilterNoise(filter, measurementNoise, estimateError, processNoise);
+    filter.primed = false;
+}
+
+// Float reference: outputs are counts
+void updateMotionFilter(MotionFilterFloat &filter, const int16_t raw[MOTION_FILTER_AXES], float out[MOTION_FILTER_AXES]) {
+    if (!filter.primed) {
+        for (uint8_t i = 0; i < MOTION_FILTER_AXES; i++) {
+            filter.estimate[i] = raw[i];
+            out[i] = filter.estimate[i];
+        }
+        filter.primed = true;
+        return;
+    }
+    
+    float predicted = filter.errEstimate + filter.processNoise;
+    float gain = predicted / (predicted + filter.errMeasure);
+    filter.errEstimate = (1.0f - gain) * predicted;
+    for (uint8_t i = 0; i < MOTION_FILTER_AXES; i++) {
+        filter.estimate[i] += gain * (raw[i] - filter.estimate[i]);
+        out[i] = filter.estimate[i];
+    }
+}
+
+void rescaleMotionFilter(MotionFilterFloat &filter, int8_t shift) {
+    float factor = ldexpf(1.0f, shift);
+    for (uint8_t i = 0; i < MOTION_FILTER_AXES; i++) {
+        filter.estimate[i] *= factor;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef MOTIONFILTER_H
+#define MOTIONFILTER_H
+
+#include <Arduino.h>
+
+// 3-axis scalar Kalman filter on raw int16 sensor counts
+// Each axis is a random walk seen through measurement noise:
+//   errPredicted = errEstimate + processNoise
+//   gain         = errPredicted / (errPredicted + errMeasure)
+//   estimate     = estimate + gain * (measurement - estimate)
+//   errEstimate  = (1 - gain) * errPredicted
+// The error terms do not depend on the data, so the gain sequence is shared
+// by all three axes and converges to a steady-state gain fixed by the noise
+// terms alone. That gain is precomputed when the filter is tuned; while the
+// gain settles after a retune it is stepped once per sample, not per axis.
+// The fixed-point version keeps the estimate in Q16.16 counts and the gain in
+// Q15, and updates each axis with two 32-bit multiplies: no divide and no
+// 64-bit arithmetic. MotionFilterFloat is the float reference implementation.
+
+#define MOTION_FILTER_AXES             3
+#define MOTION_FILTER_Q                16          // Fractional bits of the estimate
+#define MOTION_FILTER_GAIN_Q           15          // Fractional bits of the gain
+#define MOTION_FILTER_MAX_GAIN         32767       // Just under 1.0 in Q15
+
+// Defaults: measurement and estimate error of 2 counts², process noise of
+// 0.01 counts² per sample at FILTER_REFERENCE_RATE_HZ (steady gain ~0.068)
+#define MOTION_FILTER_DEFAULT_MEASUREMENT  2.0
+#define MOTION_FILTER_DEFAULT_ESTIMATE     2.0
+#define MOTION_FILTER_DEFAULT_PROCESS      0.01
+
+struct MotionFilter {
+    int32_t estimate[MOTION_FILTER_AXES];  // Q16.16 counts
+    uint16_t gain;                         // Q15, gain for the next sample
+    uint16_t steadyGain;                   // Q15, where gain settles
+    bool settling;                         // gain still moving towards steadyGain
+    float errEstimate;                     // Only stepped while settling
+    float errMeasure;
+    float processNoise;
+    bool primed;                           // Estimate seeded from the first sample
+};
+
+struct MotionFilterFloat {
+    float estimate[MOTION_FILTER_AXES];
+    float errEstimate;
+    float errMeasure;
+    float processNoise;
+    bool primed;
+};
+
+float getMotionFilterSteadyGain(float measurementNoise, float processNoise);
+
+void initMotionFilter(MotionFilter &filter, float measurementNoise, float estimateError, float processNoise);
+void setMotionFilterNoise(MotionFilter &filter, float measurementNoise, float estimateError, float processNoise);
+void updateMotionFilter(MotionFilter &filter, const int16_t raw[MOTION_FILTER_AXES], int32_t out[MOTION_FILTER_AXES]);
+void rescaleMotionFilter(MotionFilter &filter, int8_t shift);
+
+void initMotionFilter(MotionFilterFloat &filter, float measurementNoise, float estimateError, float processNoise);
+void setMotionFilterNoise(MotionFilterFloat &filter, float measurementNoise, float estimateError, float processNoise);
+void updateMotionFilter(MotionFilterFloat &filter, const int16_t raw[MOTION_FILTER_AXES], float out[MOTION_FILTER_AXES]);
+void rescaleMotionFilter(MotionFilterFloat &filter, int8_t shift);
+
+#endif
@@ -0,0 +1,68 @@
+#include "MotionRecorder.h"
+#include "PacketCodec.h"
+
+static MotionSample history[RECORDER_SAMPLES];
+static uint16_t historyHead = 0;     // Next slot to write
+static uint16_t historyCount = 0;
+static bool frozen = false;
+
+void recordMotionSample(const MotionSample& sample) {
+    if (frozen) {
+        return;
+    }
+    history[historyHead] = sample;
+    historyHead = (historyHead + 1) % RECORDER_SAMPLES;
+    if (historyCount < RECORDER_SAMPLES) {
+        historyCount++;
+    }
+}
+
+void freezeMotionRecorder() {
+    frozen = true;
+}
+
+// Start a new window; the samples held so far are dropped
+void resumeMotionRecorder() {
+    frozen = false;
+    historyCount = 0;
+}
+
+bool isMotionRecorderFrozen() {
+    return frozen;
+}
+
+uint32_t getMotionRecorderBytes() {
+    return (uint32_t)historyCount * RECORDER_RECORD_SIZE;
+}
+
+static void encodeRecord(const MotionSample& s, uint8_t* record) {
+    putLE64(&record[0], s.timestampUs);
+    putLE16(&record[8], s.ax);
+    putLE16(&record[10], s.ay);
+    putLE16(&record[12], s.az);
+    putLE16(&record[14], s.gx);
+    putLE16(&record[16], s.gy);
+    putLE16(&record[18], s.gz);
+    putLE16(&record[20], s.temperature);
+    record[22] = s.accelRange;
+    record[23] = s.flags;
+}
+
+// Read the window as a byte stream of records, oldest first
+// Only meaningful while frozen; a recording window shifts under the reader.
+size_t readMotionRecorder(void*, uint32_t offset, uint8_t* out, size_t length) {
+    uint32_t total = getMotionRecorderBytes();
+    size_t copied = 0;
+    while (copied < length && offset < total) {
+        uint16_t index = offset / RECORDER_RECORD_SIZE;
+        uint16_t slot = (historyHead + RECORDER_SAMPLES - historyCount + index) % RECORDER_SAMPLES;
+        uint8_t record[RECORDER_RECORD_SIZE];
+        encodeRecord(history[slot], record);
+        uint8_t within = offset % RECORDER_RECORD_SIZE;
+        size_t chunk = min((size_t)(RECORDER_RECORD_SIZE - within), length - copied);
+        memcpy(out + copied, record + within, chunk);
+        copied += chunk;
+        offset += chunk;
+    }
+    return copied;
+}
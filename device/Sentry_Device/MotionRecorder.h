@@ -0,0 +1,32 @@
+#ifndef MOTION_RECORDER_H
+#define MOTION_RECORDER_H
+
+#include <Arduino.h>
+#include "MPU6050Handler.h"
+
+// Pre-crash motion recorder
+// Keeps the last RECORDER_SAMPLES raw samples in RAM. A tilt event freezes
+// the window, so the samples leading up to it are kept until a client reads
+// them over the bulk channel (CMD_BULK_READ); a completed read resumes
+// recording. Samples are stored as read, before calibration.
+
+#define RECORDER_SAMPLES           1024   // ~5 s at 200 Hz, 24 KB of RAM
+#define RECORDER_RECORD_SIZE       24     // Bytes per sample as read out
+
+// Record Layout (little-endian), oldest sample first
+//   [0-7]   sample time in microseconds since boot (u64)
+//   [8-13]  ax, ay, az raw counts (int16)
+//   [14-19] gx, gy, gz raw counts (int16)
+//   [20-21] raw die temperature (int16)
+//   [22]    accel range (ACCEL_RANGE_*)
+//   [23]    flags (SAMPLE_FLAG_*)
+
+void recordMotionSample(const MotionSample& sample);
+void freezeMotionRecorder();
+void resumeMotionRecorder();
+bool isMotionRecorderFrozen();
+uint32_t getMotionRecorderBytes();
+// Copies recorded bytes from `offset`; a BulkReadFn
+size_t readMotionRecorder(void* ctx, uint32_t offset, uint8_t* out, size_t length);
+
+#endif
@@ -0,0 +1,181 @@
+#include "Mpu6050Driver.h"
+
+// Reset the sensor and apply the ranges in use; true if it answered
+bool Mpu6050Driver::configureImpl(uint8_t accelRange) {
+    device.initialize();
+    if (!device.testConnection()) {
+        return false;
+    }
+    device.setFullScaleGyroRange(MPU6050_GYRO_FS_2000);  // Rollover/spin rates exceed ±250 °/s
+    device.setFullScaleAccelRange(accelRange);
+    return true;
+}
+
+// Set the sample-rate divider and DLPF mode; returns the rate actually set
+uint16_t Mpu6050Driver::setSampleRateImpl(uint16_t rateHz, uint8_t dlpfMode) {
+    uint16_t divider = MPU_GYRO_OUTPUT_RATE_HZ / rateHz - 1;
+    device.setDLPFMode(dlpfMode);
+    device.setRate(divider);
+    return MPU_GYRO_OUTPUT_RATE_HZ / (divider + 1);
+}
+
+// Queue accel, temperature and gyro; the caller resets the FIFO afterwards
+void Mpu6050Driver::configureFifoImpl() {
+    device.setFIFOEnabled(false);
+    device.setAccelFIFOEnabled(true);
+    device.setTempFIFOEnabled(true);
+    device.setXGyroFIFOEnabled(true);
+    device.setYGyroFIFOEnabled(true);
+    device.setZGyroFIFOEnabled(true);
+    device.setFIFOEnabled(true);
+}
+
+// FIFO byte count plus the overflow flag (reading INT_STATUS clears it)
+bool Mpu6050Driver::readFifoCountImpl(uint16_t &bytes, bool &overflow) {
+    uint8_t intStatus;
+    uint8_t countBytes[2];
+    if (I2Cdev::readBytes(i2cAddress, MPU6050_RA_INT_STATUS, 1, &intStatus, MPU_I2C_TIMEOUT_MS) != 1 ||
+        I2Cdev::readBytes(i2cAddress, MPU6050_RA_FIFO_COUNTH, 2, countBytes, MPU_I2C_TIMEOUT_MS) != 2) {
+        return false;
+    }
+    bytes = (countBytes[0] << 8) | countBytes[1];
+    overflow = intStatus & (1 << MPU6050_INTERRUPT_FIFO_OFLOW_BIT);
+    return true;
+}
+
+void Mpu6050Driver::configureDataReadyImpl() {
+    device.setFIFOEnabled(false);
+    device.setInterruptMode(false);       // Active high
+    device.setInterruptDrive(false);      // Push-pull
+    device.setInterruptLatch(false);      // 50 us pulse - no status read needed to clear
+    device.setIntDataReadyEnabled(true);
+}
+
+// Accel in low-power cycle mode, gyro and temperature sensor in standby, and
+// the motion interrupt latched on INT
+void Mpu6050Driver::enterMotionWakeImpl(float thresholdG) {
+    device.setIntDataReadyEnabled(false);
+    device.setFIFOEnabled(false);
+    device.setInterruptLatch(true);          // Hold INT high until INT_STATUS is read
+    device.setInterruptLatchClear(false);
+    device.setDHPFMode(MPU6050_DHPF_5);      // Motion is judged on high-passed accel
+    device.setMotionDetectionThreshold(constrain(thresholdG * 1000.0f / MOTION_WAKE_MG_PER_LSB, 1.0f, 255.0f));
+    device.setMotionDetectionDuration(MOTION_WAKE_DURATION);
+    device.setIntMotionEnabled(true);
+    device.setTempSensorEnabled(false);
+    device.setStandbyXGyroEnabled(true);
+    device.setStandbyYGyroEnabled(true);
+    device.setStandbyZGyroEnabled(true);
+    device.setWakeFrequency(MOTION_WAKE_FREQ);
+    device.setWakeCycleEnabled(true);
+    device.getIntStatus();                   // Clear anything latched while configuring
+}
+
+// Undo enterMotionWakeImpl(); rate, FIFO and interrupt setup are restored by the caller
+void Mpu6050Driver::exitMotionWakeImpl() {
+    device.setWakeCycleEnabled(false);
+    device.setStandbyXGyroEnabled(false);
+    device.setStandbyYGyroEnabled(false);
+    device.setStandbyZGyroEnabled(false);
+    device.setTempSensorEnabled(true);
+    device.setIntMotionEnabled(false);
+    device.setDHPFMode(MPU6050_DHPF_RESET);
+    device.setInterruptLatch(false);
+}
+
+// Read and clear the latched motion status
+bool Mpu6050Driver::readMotionStatusImpl(bool &motion) {
+    uint8_t status;
+    if (I2Cdev::readBytes(i2cAddress, MPU6050_RA_INT_STATUS, 1, &status, MPU_I2C_TIMEOUT_MS) != 1) {
+        return false;
+    }
+    motion = status & (1 << MPU6050_INTERRUPT_MOT_BIT);
+    return true;
+}
+
+// Mean accel and gyro output over SELF_TEST_SAMPLES reads
+bool Mpu6050Driver::averageMotion(float mean[IMU_SELF_TEST_AXES]) {
+    int32_t sum[IMU_SELF_TEST_AXES] = {0, 0, 0, 0, 0, 0};
+    for (uint8_t n = 0; n < SELF_TEST_SAMPLES; n++) {
+        delay(1);  // One sample period at 1 kHz
+        uint8_t block[MPU_MOTION_BLOCK_BYTES];
+        if (!readMotionImpl(block)) {
+            return false;
+        }
+        for (uint8_t axis = 0; axis < IMU_SELF_TEST_AXES; axis++) {
+            uint8_t offset = axis < 3 ? axis * 2 : 8 + (axis - 3) * 2;  // Skip the temperature word
+            sum[axis] += (int16_t)((block[offset] << 8) | block[offset + 1]);
+        }
+    }
+    for (uint8_t axis = 0; axis < IMU_SELF_TEST_AXES; axis++) {
+        mean[axis] = (float)sum[axis] / SELF_TEST_SAMPLES;
+    }
+    return true;
+}
+
+// Expected self-test response in counts for a 5-bit trim code (register map
+// rev 4.2, section 4.1); 0 when the part carries no trim for the axis
+static float factoryTrim(uint8_t axis, uint8_t code) {
+    if (code == 0) {
+        return 0.0f;
+    }
+    if (axis < 3) {
+        return 4096.0f * 0.34f * powf(0.92f / 0.34f, (code - 1) / 30.0f);  // ±8 g
+    }
+    float trim = 25.0f * 131.0f * powf(1.046f, code - 1);               // ±250 °/s
+    return axis == 4 ? -trim : trim;                                       // Y gyro deflects negatively
+}
+
+// Factory self-test: the output change with the self-test actuators on must
+// be within SELF_TEST_TOLERANCE of the factory trim, at ±8 g and ±250 °/s
+bool Mpu6050Driver::selfTestImpl(ImuSelfTest &result) {
+    memset(&result, 0, sizeof(result));
+    device.setDLPFMode(MPU6050_DLPF_BW_42);
+    device.setRate(0);
+    I2Cdev::writeByte(i2cAddress, MPU6050_RA_ACCEL_CONFIG, MPU6050_ACCEL_FS_8 << 3);
+    I2Cdev::writeByte(i2cAddress, MPU6050_RA_GYRO_CONFIG, MPU6050_GYRO_FS_250 << 3);
+    delay(SELF_TEST_SETTLE_MS);
+    
+    float idle[IMU_SELF_TEST_AXES];
+    float excited[IMU_SELF_TEST_AXES];
+    if (!averageMotion(idle)) {
+        return false;
+    }
+    I2Cdev::writeByte(i2cAddress, MPU6050_RA_ACCEL_CONFIG, 0xE0 | (MPU6050_ACCEL_FS_8 << 3));   // XA/YA/ZA_ST
+    I2Cdev::writeByte(i2cAddress, MPU6050_RA_GYRO_CONFIG, 0xE0 | (MPU6050_GYRO_FS_250 << 3));   // XG/YG/ZG_ST
+    delay(SELF_TEST_SETTLE_MS);
+    bool ok = averageMotion(excited);
+    I2Cdev::writeByte(i2cAddress, MPU6050_RA_ACCEL_CONFIG, MPU6050_ACCEL_FS_8 << 3);
+    I2Cdev::writeByte(i2cAddress, MPU6050_RA_GYRO_CONFIG, MPU6050_GYRO_FS_250 << 3);
+    
+    uint8_t trim[4];
+    if (!ok || I2Cdev::readBytes(i2cAddress, MPU6050_RA_SELF_TEST_X, 4, trim, MPU_I2C_TIMEOUT_MS) != 4) {
+        return false;
+    }
+    
+    // Accel codes are split between SELF_TEST_X/Y/Z [7:5] and SELF_TEST_A
+    uint8_t codes[IMU_SELF_TEST_AXES] = {
+        (uint8_t)(((trim[0] >> 3) & 0x1C) | ((trim[3] >> 4) & 0x03)),
+        (uint8_t)(((trim[1] >> 3) & 0x1C) | ((trim[3] >> 2) & 0x03)),
+        (uint8_t)(((trim[2] >> 3) & 0x1C) | (trim[3] & 0x03)),
+        (uint8_t)(trim[0] & 0x1F),
+        (uint8_t)(trim[1] & 0x1F),
+        (uint8_t)(trim[2] & 0x1F)
+    };
+    
+    result.ran = true;
+    for (uint8_t axis = 0; axis < IMU_SELF_TEST_AXES; axis++) {
+        float expected = factoryTrim(axis, codes[axis]);
+        if (expected == 0.0f) {
+            result.deviation[axis] = NAN;
+            result.untestedAxes |= 1 << axis;
+            continue;
+        }
+        result.deviation[axis] = (excited[axis] - idle[axis] - expected) / expected;
+        if (fabsf(result.deviation[axis]) > SELF_TEST_TOLERANCE) {
+            result.failedAxes |= 1 << axis;
+        }
+    }
+    result.passed = result.failedAxes == 0;
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef MPU6050_DRIVER_H
+#define MPU6050_DRIVER_H
+
+#include <MPU6050.h>
+#include "ImuDriver.h"
+#include "MPU6050Handler.h"
+
+// MPU6050 driver for ImuDriver
+// Register-level configuration goes through the Electronic Cats library; the
+// sample-path reads are inline raw I2Cdev bursts with a bounded timeout.
+class Mpu6050Driver : public ImuDriver<Mpu6050Driver> {
+public:
+  explicit Mpu6050Driver(uint8_t address) : device(address), i2cAddress(address) {}
+
+  uint8_t addressImpl() const { return i2cAddress; }
+  bool probeImpl() { return device.testConnection(); }
+  bool configureImpl(uint8_t accelRange);
+  void setAccelRangeImpl(uint8_t range) { device.setFullScaleAccelRange(range); }
+  uint16_t setSampleRateImpl(uint16_t rateHz, uint8_t dlpfMode);
+
+  bool readMotionImpl(uint8_t* block) {
+    return I2Cdev::readBytes(i2cAddress, MPU6050_RA_ACCEL_XOUT_H, MPU_MOTION_BLOCK_BYTES, block,
+                             MPU_I2C_TIMEOUT_MS) == MPU_MOTION_BLOCK_BYTES;
+  }
+  void configureFifoImpl();
+  void resetFifoImpl() { device.resetFIFO(); }
+  bool readFifoCountImpl(uint16_t &bytes, bool &overflow);
+  bool readFifoImpl(uint8_t* data, uint8_t length) {
+    return I2Cdev::readBytes(i2cAddress, MPU6050_RA_FIFO_R_W, length, data, MPU_I2C_TIMEOUT_MS) == length;
+  }
+  void configureDataReadyImpl();
+  void disableDataReadyImpl() { device.setIntDataReadyEnabled(false); }
+  void clearInterruptsImpl() { device.getIntStatus(); }
+
+  void enterMotionWakeImpl(float thresholdG);
+  void exitMotionWakeImpl();
+  bool readMotionStatusImpl(bool &motion);
+
+  bool selfTestImpl(ImuSelfTest &result);
+
+private:
+  bool averageMotion(float mean[IMU_SELF_TEST_AXES]);
+
+  MPU6050 device;
+  uint8_t i2cAddress;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "OrientationFilter.h"
+#include "TiltDetection.h"
+#include <math.h>
+
+static Orientation orientation = {1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+static OrientationStats stats;
+static bool initialized = false;
+
+static const float DEG_TO_RAD_F = M_PI / 180.0;
+static const float RAD_TO_DEG_F = 180.0 / M_PI;
+
+// Derive Euler angles and linear acceleration from the current quaternion
+static void updateOutputs(float ax, float ay, float az) {
+    Orientation &o = orientation;
+    
+    // Gravity direction in the sensor frame
+    float gX = 2.0f * (o.q1 * o.q3 - o.q0 * o.q2);
+    float gY = 2.0f * (o.q0 * o.q1 + o.q2 * o.q3);
+    float gZ = o.q0 * o.q0 - o.q1 * o.q1 - o.q2 * o.q2 + o.q3 * o.q3;
+    
+    // Same conventions as calculateTilt(): roll about X, pitch about Y
+    o.roll  = atan2f(gY, gZ) * RAD_TO_DEG_F;
+    o.pitch = asinf(constrain(-gX, -1.0f, 1.0f)) * RAD_TO_DEG_F;
+    o.yaw   = atan2f(o.q1 * o.q2 + o.q0 * o.q3, 0.5f - o.q2 * o.q2 - o.q3 * o.q3) * RAD_TO_DEG_F;
+    
+    o.linAx = ax - gX;
+    o.linAy = ay - gY;
+    o.linAz = az - gZ;
+}
+
+// Start from the attitude implied by gravity alone (yaw = 0)
+void resetOrientation(float ax, float ay, float az) {
+    float roll, pitch;
+    calculateTilt(ax, ay, az, roll, pitch);
+    
+    float cr = cosf(roll * DEG_TO_RAD_F * 0.5f);
+    float sr = sinf(roll * DEG_TO_RAD_F * 0.5f);
+    float cp = cosf(pitch * DEG_TO_RAD_F * 0.5f);
+    float sp = sinf(pitch * DEG_TO_RAD_F * 0.5f);
+    
+    orientation.q0 = cr * cp;
+    orientation.q1 = sr * cp;
+    orientation.q2 = cr * sp;
+    orientation.q3 = -sr * sp;
+    
+    initialized = true;
+    updateOutputs(ax, ay, az);
+}
+
+// One filter step: gyro in °/s, accel in g, dt in seconds
+void updateOrientation(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+    if (!initialized) {
+        resetOrientation(ax, ay, az);
+        return;
+    }
+    
+    uint32_t start = micros();
+    Orientation &o = orientation;
+    float q0 = o.q0, q1 = o.q1, q2 = o.q2, q3 = o.q3;
+    
+    dt = constrain(dt, 0.0f, (float)ORIENTATION_MAX_DT_S);
+    gx *= DEG_TO_RAD_F;
+    gy *= DEG_TO_RAD_F;
+    gz *= DEG_TO_RAD_F;
+    
+    // Rate of change of quaternion from gyroscope
+    float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qDot1 = 0.5f * ( q0 * gx + q2 * gz - q3 * gy);
+    float qDot2 = 0.5f * ( q0 * gy - q1 * gz + q3 * gx);
+    float qDot3 = 0.5f * ( q0 * gz + q1 * gy - q2 * gx);
+    
+    // Gradient-descent correction towards the measured gravity vector,
+    // only while the accelerometer is dominated by gravity
+    float norm = sqrtf(ax * ax + ay * ay + az * az);
+    if (norm > 0.0f && fabsf(norm - 1.0f) < ORIENTATION_ACCEL_GATE_G) {
+        float nax = ax / norm, nay = ay / norm, naz = az / norm;
+        
+        float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+        float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+        float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+        float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+        
+        float s0 = _4q0 * q2q2 + _2q2 * nax + _4q0 * q1q1 - _2q1 * nay;
+        float s1 = _4q1 * q3q3 - _2q3 * nax + 4.0f * q0q0 * q1 - _2q0 * nay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * naz;
+        float s2 = 4.0f * q0q0 * q2 + _2q0 * nax + _4q2 * q3q3 - _2q3 * nay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * naz;
+        float s3 = 4.0f * q1q1 * q3 - _2q1 * nax + 4.0f * q2q2 * q3 - _2q2 * nay;
+        
+        float sNorm = sqrtf(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+        if (sNorm > 0.0f) {
+            qDot0 -= ORIENTATION_BETA * s0 / sNorm;
+            qDot1 -= ORIENTATION_BETA * s1 / sNorm;
+            qDot2 -= ORIENTATION_BETA * s2 / sNorm;
+            qDot3 -= ORIENTATION_BETA * s3 / sNorm;
+        }
+    }
+    
+    // Integrate and renormalise
+    q0 += qDot0 * dt;
+    q1 += qDot1 * dt;
+    q2 += qDot2 * dt;
+    q3 += qDot3 * dt;
+    float qNorm = sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    o.q0 = q0 / qNorm;
+    o.q1 = q1 / qNorm;
+    o.q2 = q2 / qNorm;
+    o.q3 = q3 / qNorm;
+    
+    updateOutputs(ax, ay, az);
+    
+    uint32_t elapsed = micros() - start;
+    stats.updates++;
+    stats.totalUpdateUs += elapsed;
+    if (elapsed > stats.maxUpdateUs) {
+        stats.maxUpdateUs = elapsed;
+    }
+}
+
+bool isOrientationInitialized() {
+    return initialized;
+}
+
+// Re-seed from gravity on the next update (e.g. after the sample frame changes)
+void invalidateOrientation() {
+    initialized = false;
+}
+
+const Orientation& getOrientation() {
+    return orientation;
+}
+
+const OrientationStats& getOrientationStats() {
+    return stats;
+}
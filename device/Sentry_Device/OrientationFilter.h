@@ -0,0 +1,35 @@
+#ifndef ORIENTATIONFILTER_H
+#define ORIENTATIONFILTER_H
+
+#include <Arduino.h>
+
+// Madgwick gradient-descent orientation filter (gyro + accel, no magnetometer)
+// Gyro integration tracks orientation through acceleration, braking and
+// cornering; the accelerometer only slowly corrects drift, and not at all
+// while the measured force is far from 1 g.
+
+#define ORIENTATION_BETA           0.1   // Accel correction gain (higher = faster, noisier)
+#define ORIENTATION_ACCEL_GATE_G   0.3   // Skip accel correction when | |a| - 1 g | exceeds this
+#define ORIENTATION_MAX_DT_S       0.5   // Clamp integration step (polled mode runs at 2 Hz)
+
+struct Orientation {
+    float q0, q1, q2, q3;        // Unit quaternion, sensor frame relative to earth
+    float roll, pitch, yaw;      // degrees
+    float linAx, linAy, linAz;   // Linear (gravity-free) acceleration in the sample frame
+                                 // (vehicle frame once aligned), g
+};
+
+struct OrientationStats {
+    uint32_t updates;
+    uint32_t maxUpdateUs;
+    uint64_t totalUpdateUs;
+};
+
+void resetOrientation(float ax, float ay, float az);
+void updateOrientation(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+bool isOrientationInitialized();
+void invalidateOrientation();
+const Orientation& getOrientation();
+const OrientationStats& getOrientationStats();
+
+#endif
@@ -0,0 +1,47 @@
+#include "PacketCodec.h"
+
+// Calculate CRC-16 (CCITT polynomial)
+// Pass the previous result as `crc` to continue a CRC across several buffers
+uint16_t calculateCRC16(const uint8_t* data, size_t length, uint16_t crc) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t j = 0; j < 8; j++) {
+      if (crc & 0x8000) {
+        crc = (crc << 1) ^ CRC_POLYNOMIAL;
+      } else {
+        crc <<= 1;
+      }
+    }
+  }
+  return crc;
+}
+
+// Write little-endian values into a binary payload
+void putLE16(uint8_t* buf, uint16_t value) {
+  buf[0] = value & 0xFF;
+  buf[1] = (value >> 8) & 0xFF;
+}
+
+void putLE32(uint8_t* buf, uint32_t value) {
+  putLE16(buf, value & 0xFFFF);
+  putLE16(buf + 2, (value >> 16) & 0xFFFF);
+}
+
+void putLE48(uint8_t* buf, uint64_t value) {
+  putLE32(buf, value & 0xFFFFFFFF);
+  putLE16(buf + 4, (value >> 32) & 0xFFFF);
+}
+
+void putLE64(uint8_t* buf, uint64_t value) {
+  putLE32(buf, value & 0xFFFFFFFF);
+  putLE32(buf + 4, value >> 32);
+}
+
+// Read little-endian values from a received packet
+uint16_t getLE16(const uint8_t* buf) {
+  return buf[0] | (buf[1] << 8);
+}
+
+uint32_t getLE32(const uint8_t* buf) {
+  return getLE16(buf) | ((uint32_t)getLE16(buf + 2) << 16);
+}
@@ -0,0 +1,19 @@
+#ifndef PACKET_CODEC_H
+#define PACKET_CODEC_H
+
+#include <Arduino.h>
+
+// Binary packet helpers shared by the BLE frames and the bulk stream
+// Everything on the wire is little-endian and checked with CRC-16/CCITT.
+
+#define CRC_POLYNOMIAL             0x1021
+
+uint16_t calculateCRC16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+void putLE16(uint8_t* buf, uint16_t value);
+void putLE32(uint8_t* buf, uint32_t value);
+void putLE48(uint8_t* buf, uint64_t value);
+void putLE64(uint8_t* buf, uint64_t value);
+uint16_t getLE16(const uint8_t* buf);
+uint32_t getLE32(const uint8_t* buf);
+
+#endif
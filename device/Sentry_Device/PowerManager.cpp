@@ -0,0 +1,124 @@
+#include "PowerManager.h"
+#include "MPU6050Handler.h"
+#include "BluetoothHandler.h"
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+static bool parked = false;
+static unsigned long lastMotionMs = 0;
+static unsigned long windowStartMs = 0;      // Start of the current advertising window
+static int64_t parkedSinceUs = 0;
+static PowerStats stats;
+
+// Called for every processed sample; any real movement postpones parking
+void notePowerActivity(float gx, float gy, float gz, float ax, float ay, float az) {
+    float accelDeviation = fabs(sqrt(ax * ax + ay * ay + az * az) - 1.0f);
+    if (accelDeviation > PARK_STILL_G || fabs(gx) > PARK_STILL_DPS ||
+        fabs(gy) > PARK_STILL_DPS || fabs(gz) > PARK_STILL_DPS) {
+        lastMotionMs = millis();
+    }
+}
+
+static void enterParked() {
+    if (!enterMotionWake(PARK_MOTION_THRESHOLD_G)) {
+        lastMotionMs = millis();  // Sensor unavailable - try again after another idle period
+        return;
+    }
+    parked = true;
+    parkedSinceUs = esp_timer_get_time();
+    windowStartMs = millis();     // Stay connectable for one window before sleeping
+    stats.parks++;
+    Serial.println("POWER: Parked - waiting for motion");
+}
+
+// wakeUs is when the CPU learned about the motion (or the connection)
+static void exitParked(int64_t wakeUs) {
+    exitMotionWake();
+    setAdvertisingEnabled(true);
+
+    int64_t now = esp_timer_get_time();
+    uint32_t latency = now - wakeUs;
+    stats.lastWakeLatencyUs = latency;
+    stats.maxWakeLatencyUs = max(stats.maxWakeLatencyUs, latency);
+    stats.parkedUs += now - parkedSinceUs;
+    stats.wakes++;
+
+    parked = false;
+    lastMotionMs = millis();
+    Serial.print("POWER: Awake - acquisition resumed in ");
+    Serial.print(latency);
+    Serial.println(" us");
+}
+
+// Light-sleep until the INT pin rises or timeoutMs passes; returns the wake time
+static int64_t lightSleep(uint32_t timeoutMs) {
+    if (isMPUInterruptWired()) {
+        gpio_wakeup_enable((gpio_num_t)MPU_INT_PIN, GPIO_INTR_HIGH_LEVEL);
+        esp_sleep_enable_gpio_wakeup();
+    }
+    esp_sleep_enable_timer_wakeup((uint64_t)timeoutMs * 1000);
+    Serial.flush();
+
+    int64_t start = esp_timer_get_time();
+    esp_light_sleep_start();
+    int64_t wakeUs = esp_timer_get_time();
+    stats.sleepUs += wakeUs - start;
+
+    if (isMPUInterruptWired()) {
+        gpio_wakeup_disable((gpio_num_t)MPU_INT_PIN);
+    }
+    return wakeUs;
+}
+
+// Enter parked mode once idle; while parked, sleep between advertising
+// windows and wake on motion or a connection (call from loop())
+void servicePowerManager(bool busy) {
+    if (!parked) {
+        if (!busy && millis() - lastMotionMs >= PARK_IDLE_MS) {
+            enterParked();
+        }
+        return;
+    }
+
+    if (busy || isMotionWakePending()) {
+        exitParked(esp_timer_get_time());
+        return;
+    }
+    if (millis() - windowStartMs < PARK_ADVERTISE_WINDOW_MS) {
+        return;
+    }
+
+    // Radio off until the next window; without the INT pin the motion
+    // status is polled from short sleeps instead
+    setAdvertisingEnabled(false);
+    uint32_t sliceMs = isMPUInterruptWired() ? PARK_ADVERTISE_PERIOD_MS : PARK_MOTION_POLL_MS;
+    while (millis() - windowStartMs < PARK_ADVERTISE_PERIOD_MS) {
+        uint32_t remaining = PARK_ADVERTISE_PERIOD_MS - (millis() - windowStartMs);
+        int64_t wakeUs = lightSleep(min(sliceMs, remaining));
+        if (isMotionWakePending()) {
+            exitParked(wakeUs);
+            return;
+        }
+    }
+    setAdvertisingEnabled(true);
+    windowStartMs = millis();
+}
+
+bool isParked() {
+    return parked;
+}
+
+float getParkedDutyCycle() {
+    uint64_t parkedUs = stats.parkedUs;
+    if (parked) {
+        parkedUs += esp_timer_get_time() - parkedSinceUs;
+    }
+    if (parkedUs == 0) {
+        return 1.0;
+    }
+    return 1.0 - (float)stats.sleepUs / parkedUs;
+}
+
+const PowerStats& getPowerStats() {
+    return stats;
+}
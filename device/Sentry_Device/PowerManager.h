@@ -0,0 +1,40 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+
+// Parked mode (wake-on-motion)
+// After PARK_IDLE_MS without motion or a connected client, acquisition stops,
+// the MPU6050 drops to low-power motion detection and the CPU light-sleeps.
+// Advertising only runs in short windows so a phone can still connect. Motion
+// above PARK_MOTION_THRESHOLD_G resumes full-rate acquisition.
+//
+// Wake latency from motion onset is bounded by one accel wake period (25 ms),
+// plus PARK_MOTION_POLL_MS when the INT pin is not wired, plus the light-sleep
+// exit and sensor reconfiguration measured in PowerStats.
+
+// Parking Constants
+#define PARK_IDLE_MS               300000  // Still and unconnected this long -> parked
+#define PARK_STILL_G               0.05    // |a| within this of 1 g...
+#define PARK_STILL_DPS             3.0     // ...and every gyro axis below this counts as still
+#define PARK_MOTION_THRESHOLD_G    0.08    // High-passed accel change that wakes the device
+#define PARK_ADVERTISE_PERIOD_MS   30000   // A connectable advertising window every 30 s...
+#define PARK_ADVERTISE_WINDOW_MS   2000    // ...lasting 2 s
+#define PARK_MOTION_POLL_MS        200     // Motion status poll period when INT is not wired
+
+struct PowerStats {
+  uint32_t parks;                // Times parked mode was entered
+  uint32_t wakes;                // Motion wake-ups
+  uint32_t lastWakeLatencyUs;    // Motion seen by the CPU -> acquisition running
+  uint32_t maxWakeLatencyUs;
+  uint64_t parkedUs;             // Time spent parked (finished periods)
+  uint64_t sleepUs;              // Time spent in light sleep
+};
+
+void notePowerActivity(float gx, float gy, float gz, float ax, float ay, float az);
+void servicePowerManager(bool busy);
+bool isParked();
+float getParkedDutyCycle();      // Fraction of parked time spent awake
+const PowerStats& getPowerStats();
+
+#endif
@@ -0,0 +1,100 @@
+#include "SensorHealth.h"
+
+#define HEALTH_ALPHA               (1.0f / HEALTH_EWMA_SAMPLES)
+#define ACCEL_RAIL_HIGH            32767
+#define ACCEL_RAIL_LOW             -32768
+
+static SensorHealth health;
+
+// Fold one raw sample into the health state and re-evaluate the status
+// Call with the uncorrected sample so rails and repeats are seen as read.
+void updateSensorHealth(const MotionSample &sample) {
+    const int16_t raw[HEALTH_AXES] = {sample.ax, sample.ay, sample.az, sample.gx, sample.gy, sample.gz};
+    bool first = health.samples == 0;
+    bool frozen = !first;
+    bool saturated = false;
+    
+    for (uint8_t i = 0; i < HEALTH_AXES; i++) {
+        // Run length of identical raw values
+        if (!first && raw[i] == health.last[i]) {
+            health.run[i]++;
+        } else {
+            health.run[i] = 0;
+            health.runStartUs[i] = sample.timestampUs;
+            frozen = false;
+        }
+        health.last[i] = raw[i];
+        
+        // Exponentially weighted mean and variance in physical units, so
+        // accel range changes do not disturb them
+        float value = i < 3 ? accelToG(raw[i], sample.accelRange) : gyroToDps(raw[i]);
+        if (first) {
+            health.mean[i] = value;
+            health.variance[i] = 0.0f;
+        } else {
+            float delta = value - health.mean[i];
+            health.mean[i] += HEALTH_ALPHA * delta;
+            health.variance[i] = (1.0f - HEALTH_ALPHA) * (health.variance[i] + HEALTH_ALPHA * delta * delta);
+        }
+        
+        if (i < 3 && (raw[i] == ACCEL_RAIL_HIGH || raw[i] == ACCEL_RAIL_LOW)) {
+            saturated = true;
+        }
+    }
+    health.frozenRun = frozen ? health.frozenRun + 1 : 0;
+    health.samples++;
+    
+    if (saturated) {
+        health.saturationCount++;
+        if (!health.saturated) {
+            health.saturationStartUs = sample.timestampUs;
+        }
+    }
+    health.saturated = saturated;
+    
+    // Gravity magnitude can only be judged while nothing else accelerates
+    if (health.samples >= HEALTH_EWMA_SAMPLES) {
+        const float accelLimit = HEALTH_REST_ACCEL_STD_G * HEALTH_REST_ACCEL_STD_G;
+        const float gyroLimit = HEALTH_REST_GYRO_STD_DPS * HEALTH_REST_GYRO_STD_DPS;
+        health.atRest = true;
+        for (uint8_t i = 0; i < HEALTH_AXES; i++) {
+            if (health.variance[i] >= (i < 3 ? accelLimit : gyroLimit)) {
+                health.atRest = false;
+            }
+        }
+        if (health.atRest) {
+            health.gravityG = sqrt(health.mean[0] * health.mean[0] + health.mean[1] * health.mean[1] +
+                                   health.mean[2] * health.mean[2]);
+        }
+    }
+    
+    // A rail also repeats the same value, so saturation is checked first
+    bool axisStuck = false;
+    for (uint8_t i = 0; i < 3; i++) {
+        if (health.run[i] > 0 && sample.timestampUs - health.runStartUs[i] >= HEALTH_STUCK_AXIS_MS * 1000UL) {
+            axisStuck = true;
+        }
+    }
+    
+    if (health.saturated && sample.timestampUs - health.saturationStartUs >= HEALTH_SATURATION_MS * 1000UL) {
+        health.status = HEALTH_SATURATED;
+    } else if (health.frozenRun >= HEALTH_STUCK_SAMPLES || axisStuck) {
+        health.status = HEALTH_FROZEN;
+    } else if (health.gravityG > 0.0f && fabs(health.gravityG - 1.0f) > HEALTH_GRAVITY_TOLERANCE_G) {
+        health.status = HEALTH_GRAVITY;
+    } else {
+        health.status = HEALTH_OK;
+    }
+}
+
+uint8_t getSensorHealthStatus() {
+    return health.status;
+}
+
+float getAxisNoise(uint8_t axis) {
+    return axis < HEALTH_AXES ? sqrt(health.variance[axis]) : 0.0f;
+}
+
+const SensorHealth& getSensorHealth() {
+    return health;
+}
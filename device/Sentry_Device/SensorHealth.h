@@ -0,0 +1,51 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <Arduino.h>
+#include "MPU6050Handler.h"
+
+// Streaming sensor health monitor
+// Catches a sensor that still answers on I2C but no longer measures: frozen
+// output, accel pinned at a rail, or a gravity reading that cannot be right.
+// Each sample costs O(1): exponentially weighted mean/variance per axis plus
+// run-length counters, no sample history.
+
+// Health Codes (extend the getMPUStatus() codes)
+#define HEALTH_OK                  0
+#define HEALTH_FROZEN              3     // Output no longer changes
+#define HEALTH_SATURATED           4     // Accel held at full scale
+#define HEALTH_GRAVITY             5     // |a| at rest far from 1 g
+
+#define HEALTH_AXES                6     // ax, ay, az, gx, gy, gz
+
+// Health Monitor Constants
+#define HEALTH_EWMA_SAMPLES        32    // Mean/variance time constant in samples
+#define HEALTH_STUCK_SAMPLES       20    // Identical 6-axis samples in a row -> frozen
+#define HEALTH_STUCK_AXIS_MS       2000  // One accel axis unchanged this long -> frozen
+#define HEALTH_SATURATION_MS       500   // Accel rail held this long -> saturated (an impact is shorter)
+#define HEALTH_REST_ACCEL_STD_G    0.02  // Below these the device counts as at rest
+#define HEALTH_REST_GYRO_STD_DPS   1.0
+#define HEALTH_GRAVITY_TOLERANCE_G 0.25  // Loose enough for an uncalibrated zero-g offset
+
+struct SensorHealth {
+  float mean[HEALTH_AXES];       // Accel in g, gyro in °/s
+  float variance[HEALTH_AXES];
+  int16_t last[HEALTH_AXES];     // Previous raw value
+  uint32_t run[HEALTH_AXES];     // Samples the raw value has been unchanged
+  uint64_t runStartUs[HEALTH_AXES];
+  uint32_t frozenRun;            // Samples with all six axes unchanged
+  uint32_t saturationCount;      // Samples with any accel axis at a rail
+  uint64_t saturationStartUs;    // Start of the current run of saturated samples
+  bool saturated;                // The last sample had an accel axis at a rail
+  float gravityG;                // |mean a| at the last rest detection
+  bool atRest;
+  uint8_t status;                // HEALTH_*
+  uint32_t samples;
+};
+
+void updateSensorHealth(const MotionSample &sample);
+uint8_t getSensorHealthStatus();
+float getAxisNoise(uint8_t axis);  // Standard deviation, g or °/s
+const SensorHealth& getSensorHealth();
+
+#endif
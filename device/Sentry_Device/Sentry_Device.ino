@@ -1,6 +1,13 @@
 #include <Arduino.h>
 #include "MPU6050Handler.h"
 #include "TiltDetection.h"
+#include "OrientationFilter.h"
+#include "Calibration.h"
+#include "Alignment.h"
+#include "PowerManager.h"
+#include "SensorHealth.h"
+#include "Decimator.h"
+#include "MotionRecorder.h"
 #include "BluetoothHandler.h"
 
 // Data collection variables
@@ -9,6 +16,30 @@ const unsigned long SEND_INTERVAL = 2500;  // Send every 2.5n  seconds
 
 // Tilt detection configuration
 const float TILT_THRESHOLD = 60.0;  // degrees - adjust for sensitivity (lower = more sensitive)
+const float ROLLOVER_THRESHOLD = 90.0;  // degrees - device on its side or upside down
+bool lastTilt = false;
+
+// Acquisition configuration
+const unsigned long POLL_LOOP_DELAY_MS = 500;  // Legacy polling: one sample per pass
+const unsigned long FIFO_LOOP_DELAY_MS = 10;   // FIFO/ring hold far more than 10 ms of samples
+const uint16_t STREAM_MIN_DECIMATED_HZ = 10;   // Slower streams repeat a 10 Hz output (bounds its delay)
+
+// Latest processed sample (streamed to clients at their own rate)
+LatencyStamp stamp = {};
+float ax = 0, ay = 0, az = 0;
+float gx = 0, gy = 0, gz = 0;
+float temperature = 0;
+float roll = 0, pitch = 0, yaw = 0;
+bool currentTilt = false;
+uint64_t lastSampleUs = 0;
+
+// Stream path: detection sees every sample, clients get accel, gyro and
+// linear acceleration decimated to the fastest stream rate any of them asked for
+Decimator streamDecimator;
+float streamAccel[3] = {0, 0, 0};  // g
+float streamGyro[3] = {0, 0, 0};   // °/s
+float streamLinear[3] = {0, 0, 0}; // g, gravity removed
+uint64_t streamTimeUs = 0;         // Acquisition time the stream values describe
 
 void setup() {
   Serial.begin(115200);
@@ -21,36 +52,221 @@ void setup() {
   // Initialize MPU6050
   initMPU();
   Serial.println("MPU6050 initialized");
+  loadCalibration();
+  loadAlignment();
+
+  // Prefer interrupt-driven sampling, then FIFO bursts, then polling
+  uint16_t sampleRate = getConfiguredSampleRate();
+  if (!initMPUInterrupt(sampleRate) && !initMPUFifo(sampleRate)) {
+    Serial.println("MPU6050: FIFO unavailable - using polled acquisition");
+  }
   
+  initDecimator(streamDecimator, 1);
   lastSendTime = millis();
   Serial.println("Device Ready - Waiting for Bluetooth connection...");
 }
 
+// Run tilt/accident detection on the latest orientation estimate
+void detectTilt() {
+  // Check if tilt exceeds threshold (accident detection)
+  currentTilt = isTiltExceeded(roll, pitch, TILT_THRESHOLD);
+  stampLatency(&stamp, LAT_DETECTED);
+
+  // No link to notify over - broadcast the event in advertising data immediately
+  if (currentTilt && !lastTilt && !isBluetoothConnected()) {
+    uint8_t severity = isTiltExceeded(roll, pitch, ROLLOVER_THRESHOLD) ?
+                       BEACON_SEVERITY_ROLLOVER : BEACON_SEVERITY_TILT;
+    startCrashBeacon(severity, roll, pitch);
+  }
+  // Keep the samples that led up to the event for CMD_BULK_READ
+  if (currentTilt && !lastTilt) {
+    freezeMotionRecorder();
+  }
+  lastTilt = currentTilt;
+}
+
+// Pick the decimation ratio for the fastest subscribed stream
+// Polled samples arrive at the loop() rate and pass through undecimated.
+void updateStreamDecimation() {
+  uint16_t rate = getSampleRate();
+  uint16_t intervalMs = getFastestStreamIntervalMs();
+  uint16_t ratio = 1;
+  if (rate > 0 && intervalMs > 0) {
+    uint16_t maxRatio = min((uint16_t)(rate / STREAM_MIN_DECIMATED_HZ), (uint16_t)DECIMATOR_MAX_RATIO);
+    ratio = constrain((uint32_t)rate * intervalMs / 1000, (uint32_t)1, (uint32_t)max(maxRatio, (uint16_t)1));
+  }
+  if (ratio != streamDecimator.ratio) {
+    initDecimator(streamDecimator, ratio);
+  }
+}
+
+// Feed the stream decimator; until it has settled the stream follows the
+// full-rate values. Decimated values are stamped with the time they describe,
+// the newest input less the filter's group delay.
+void decimateForStream(const MotionSample& sample) {
+  const Orientation& orientation = getOrientation();
+  float accel[3] = {ax, ay, az};
+  float gyro[3] = {gx, gy, gz};
+  float linear[3] = {orientation.linAx, orientation.linAy, orientation.linAz};
+  int32_t in[DECIMATOR_CHANNELS] = {0, 0, 0, sample.gx, sample.gy, sample.gz, 0, 0, 0};
+  for (uint8_t i = 0; i < 3; i++) {
+    in[i] = (int32_t)lroundf(accel[i] * ACCEL_SCALE_LSB_PER_G);  // ±2 g counts
+    in[6 + i] = (int32_t)lroundf(linear[i] * ACCEL_SCALE_LSB_PER_G);
+  }
+  
+  int32_t out[DECIMATOR_CHANNELS];
+  bool decimated = updateDecimator(streamDecimator, in, out);
+  uint16_t rate = getSampleRate();
+  if (decimated) {
+    streamTimeUs = sample.timestampUs;
+    if (rate > 0) {
+      streamTimeUs -= (uint64_t)lroundf(getDecimatorDelay(streamDecimator) * 1000000.0f / rate);
+    }
+  } else if (!isDecimatorSettled(streamDecimator)) {
+    streamTimeUs = sample.timestampUs;
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    if (decimated) {
+      streamAccel[i] = out[i] / ACCEL_SCALE_LSB_PER_G;
+      streamGyro[i] = gyroToDps(out[3 + i]);
+      streamLinear[i] = out[6 + i] / ACCEL_SCALE_LSB_PER_G;
+    } else if (!isDecimatorSettled(streamDecimator)) {
+      streamAccel[i] = accel[i];
+      streamGyro[i] = gyro[i];
+      streamLinear[i] = linear[i];
+    }
+  }
+}
+
+// Anything that needs full-rate acquisition keeps the device out of parked mode
+bool isDeviceBusy() {
+  return isBluetoothConnected() || isCrashBeaconActive() || currentTilt ||
+         getCalibrationStatus().state == CALIB_STATE_COLLECTING ||
+         getAlignmentStatus().state == ALIGN_STATE_LEVEL ||
+         getAlignmentStatus().state == ALIGN_STATE_FORWARD;
+}
+
+// Correct, rotate into the vehicle frame, filter and convert one raw sample,
+// then run detection on it
+void processSample(const MotionSample& raw) {
+  stamp.us[LAT_ACQUIRED] = (uint32_t)raw.timestampUs;  // micros() domain
+  updateSensorHealth(raw);
+  recordMotionSample(raw);
+  feedCalibrationSample(raw);
+  MotionSample sample = raw;
+  applyCalibration(sample);
+  feedAlignmentSample(sample);
+  applyAlignment(sample);
+  filterSample(sample, ax, ay, az);
+  gx = gyroToDps(sample.gx);
+  gy = gyroToDps(sample.gy);
+  gz = gyroToDps(sample.gz);
+  temperature = temperatureToCelsius(sample.temperature);
+
+  // Fuse the unsmoothed accel with the gyro - tilt follows rotation
+  // immediately and is not fooled by braking or cornering forces
+  float dt = lastSampleUs ? (uint32_t)(sample.timestampUs - lastSampleUs) / 1000000.0f : 0.0f;
+  lastSampleUs = sample.timestampUs;
+  updateOrientation(gx, gy, gz,
+                    accelToG(sample.ax, sample.accelRange), accelToG(sample.ay, sample.accelRange),
+                    accelToG(sample.az, sample.accelRange), dt);
+  const Orientation& orientation = getOrientation();
+  roll = orientation.roll;
+  pitch = orientation.pitch;
+  yaw = orientation.yaw;
+  notePowerActivity(gx, gy, gz,
+                    accelToG(sample.ax, sample.accelRange), accelToG(sample.ay, sample.accelRange),
+                    accelToG(sample.az, sample.accelRange));
+  stampLatency(&stamp, LAT_FILTERED);
+  detectTilt();
+  decimateForStream(sample);
+}
+
 void loop() {
+  uint32_t passStartUs = micros();
+  
   // Handle Bluetooth reconnection
   handleBluetoothReconnection();
 
+  // Parked: acquisition is stopped and the CPU sleeps until motion, a
+  // connection or the next advertising window
+  if (isParked()) {
+    servicePowerManager(isDeviceBusy());
+    delay(FIFO_LOOP_DELAY_MS);
+    return;
+  }
+
+  // Re-initialize the sensor if it dropped off the bus
+  serviceMPURecovery();
+  serviceMPUSelfTest();
+
   // Read sensor data from MPU6050
-  float ax, ay, az;
-  readAccel(ax, ay, az);
+  updateStreamDecimation();
+  uint8_t acquisitionMode = getAcquisitionMode();
+  MotionSample sample;
+  bool freshSample = false;
+  if (acquisitionMode != ACQ_MODE_POLL) {
+    // Every sample taken since the last pass goes through detection; the
+    // acquisition task does all bus transfers, so this never waits on I2C
+    while (popSample(sample)) {
+      processSample(sample);
+      freshSample = true;
+    }
+  } else if (readMotion(sample)) {
+    processSample(sample);
+    freshSample = true;
+  } else {
+    // Sensor not responding - report zeros alongside the failure status
+    ax = ay = az = 0;
+    gx = gy = gz = 0;
+    roll = pitch = yaw = 0;
+    memset(streamAccel, 0, sizeof(streamAccel));
+    memset(streamGyro, 0, sizeof(streamGyro));
+    memset(streamLinear, 0, sizeof(streamLinear));
+    streamTimeUs = esp_timer_get_time();
+    detectTilt();
+  }
+  serviceCalibration();
+  serviceAlignment();
 
-  // Calculate tilt angles
-  float roll, pitch;
-  calculateTilt(ax, ay, az, roll, pitch);
+  // Get MPU6050 status message and status code
+  const char* mpuStatusMsg = getMPUStatusMessage();
+  int mpuStatus = getMPUStatus();
 
-  // Check if tilt exceeds threshold (accident detection)
-  bool currentTilt = isTiltExceeded(roll, pitch, TILT_THRESHOLD);
+  // Stream real sensor data - each client receives it at its own requested rate
+  SensorFrame frame;
+  frame.timeUs = streamTimeUs;
+  frame.ax = streamAccel[0];
+  frame.ay = streamAccel[1];
+  frame.az = streamAccel[2];
+  frame.gx = streamGyro[0];
+  frame.gy = streamGyro[1];
+  frame.gz = streamGyro[2];
+  frame.linAx = streamLinear[0];
+  frame.linAy = streamLinear[1];
+  frame.linAz = streamLinear[2];
+  frame.accelMagnitude = sqrtf(frame.ax * frame.ax + frame.ay * frame.ay + frame.az * frame.az);
+  frame.linearMagnitude = sqrtf(frame.linAx * frame.linAx + frame.linAy * frame.linAy +
+                                frame.linAz * frame.linAz);
+  frame.temperature = temperature;
+  frame.accelRange = getAccelRange();
+  frame.roll = roll;
+  frame.pitch = pitch;
+  frame.yaw = yaw;
+  frame.tiltDetected = currentTilt;
+  frame.statusMessage = mpuStatusMsg;
+  frame.statusCode = mpuStatus;
+  // Only a newly acquired sample has stage times to report; a pass that found
+  // none resends the old values and must not count their latency again
+  frame.stamp = freshSample ? &stamp : nullptr;
+  sendSensorData(frame);
 
-  // Send data via Bluetooth every SEND_INTERVAL milliseconds
+  // Send device status and log every SEND_INTERVAL milliseconds
   unsigned long currentTime = millis();
   if (currentTime - lastSendTime >= SEND_INTERVAL) {
     if (isBluetoothConnected()) {
-      // Get MPU6050 status message and status code
-      const char* mpuStatusMsg = getMPUStatusMessage();
-      int mpuStatus = getMPUStatus();
-      
-      // Send real sensor data from MPU6050 with status message and status code
-      sendSensorData(ax, ay, az, roll, pitch, currentTilt, mpuStatusMsg, mpuStatus);
+      Serial.print("BLE: Connected clients: ");
+      Serial.println(getConnectionCount());
       
       // Display appropriate status message based on MPU6050 state
       if (mpuStatus == 0) {
@@ -61,6 +277,10 @@ void loop() {
         // MPU6050 readings unstable
         Serial.print("BLE: MPU6050 Status [Code: 1] - ⚠️ MPU6050 readings unstable - Check sensor");
         Serial.println();
+      } else if (mpuStatus >= 3) {
+        // MPU6050 answers but its readings fail the health checks
+        Serial.print("BLE: MPU6050 Status - ⚠️ ");
+        Serial.println(mpuStatusMsg);
       } else if (mpuStatus == 2) {
         // MPU6050 working
         if (currentTilt) {
@@ -76,11 +296,19 @@ void loop() {
       
       Serial.println("---");
     } else {
-      Serial.println("BLE: Waiting for connection...");
+      if (isCrashBeaconActive()) {
+        Serial.println("BLE: ⚠️ Crash beacon advertising - Waiting for connection...");
+      } else {
+        Serial.println("BLE: Waiting for connection...");
+      }
     }
     
     lastSendTime = currentTime;
   }
 
-  delay(500);
+  // Park once nothing has moved for a while and no client is connected
+  servicePowerManager(isDeviceBusy());
+
+  recordLoopPass(micros() - passStartUs);
+  delay(acquisitionMode == ACQ_MODE_POLL ? POLL_LOOP_DELAY_MS : FIFO_LOOP_DELAY_MS);
 }
\ No newline at end of file
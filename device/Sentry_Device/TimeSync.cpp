@@ -0,0 +1,154 @@
+#include "TimeSync.h"
+
+// Kept points (ring) and the best exchange of the burst in progress
+static TimeSyncPoint points[TIME_SYNC_POINTS];
+static uint8_t pointHead = 0;                // Next slot to write
+static uint8_t pointCount = 0;
+static TimeSyncPoint burstBest;
+static bool burstHasExchange = false;
+static TimeSyncStats stats;
+
+// Fitted line, relative to the newest point so the doubles stay small:
+// offset(t) = lineOffsetUs + lineIntercept + lineSlope * (t - lineDeviceUs)
+static int64_t lineDeviceUs = 0;
+static int64_t lineOffsetUs = 0;
+static double lineIntercept = 0.0;
+static double lineSlope = 0.0;
+
+void resetTimeSync() {
+  pointHead = 0;
+  pointCount = 0;
+  burstHasExchange = false;
+  memset(&stats, 0, sizeof(stats));
+  lineDeviceUs = 0;
+  lineOffsetUs = 0;
+  lineIntercept = 0.0;
+  lineSlope = 0.0;
+}
+
+// Offset the line predicts at a device time
+static int64_t predictOffset(int64_t deviceUs) {
+  return lineOffsetUs + (int64_t)llround(lineIntercept + lineSlope * (double)(deviceUs - lineDeviceUs));
+}
+
+// Add one answered request to the current burst
+void addTimeSyncExchange(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+  stats.exchanges++;
+  int64_t delay = (t4 - t1) - (t3 - t2);
+  if (t3 < t2 || delay < 0 || delay > TIME_SYNC_MAX_DELAY_US) {
+    stats.rejected++;
+    return;
+  }
+
+  TimeSyncPoint point;
+  point.deviceUs = t1 + (t4 - t1) / 2;
+  point.offsetUs = ((t2 - t1) + (t3 - t4)) / 2;
+  point.delayUs = delay;
+  if (!burstHasExchange || point.delayUs < burstBest.delayUs) {
+    burstBest = point;
+    burstHasExchange = true;
+  }
+}
+
+void noteTimeSyncLost() {
+  stats.lost++;
+}
+
+// Fit weight; the 1 ms floor is the phone's timestamp resolution
+static double pointWeight(const TimeSyncPoint& point) {
+  double delay = point.delayUs + 1000.0;
+  return 1.0 / (delay * delay);
+}
+
+// Least-squares line through the kept points; flat through the newest point
+// until there are enough of them to tell drift from delay noise
+static void fitLine() {
+  const TimeSyncPoint& newest = points[(pointHead + TIME_SYNC_POINTS - 1) % TIME_SYNC_POINTS];
+  lineDeviceUs = newest.deviceUs;
+  lineOffsetUs = newest.offsetUs;
+  lineIntercept = 0.0;
+  lineSlope = 0.0;
+  stats.residualUs = 0;
+  if (pointCount < TIME_SYNC_MIN_POINTS) {
+    return;
+  }
+
+  double sumW = 0.0, meanX = 0.0, meanY = 0.0;
+  for (uint8_t i = 0; i < pointCount; i++) {
+    double w = pointWeight(points[i]);
+    sumW += w;
+    meanX += w * (double)(points[i].deviceUs - lineDeviceUs);
+    meanY += w * (double)(points[i].offsetUs - lineOffsetUs);
+  }
+  meanX /= sumW;
+  meanY /= sumW;
+
+  double sxx = 0.0, sxy = 0.0;
+  for (uint8_t i = 0; i < pointCount; i++) {
+    double w = pointWeight(points[i]);
+    double dx = (double)(points[i].deviceUs - lineDeviceUs) - meanX;
+    double dy = (double)(points[i].offsetUs - lineOffsetUs) - meanY;
+    sxx += w * dx * dx;
+    sxy += w * dx * dy;
+  }
+  if (sxx > 0.0) {
+    double maxSlope = TIME_SYNC_MAX_DRIFT_PPM * 1e-6;
+    lineSlope = constrain(sxy / sxx, -maxSlope, maxSlope);
+  }
+  lineIntercept = meanY - lineSlope * meanX;
+
+  double sumSquares = 0.0;
+  for (uint8_t i = 0; i < pointCount; i++) {
+    double residual = (double)(points[i].offsetUs - predictOffset(points[i].deviceUs));
+    sumSquares += residual * residual;
+  }
+  stats.residualUs = (uint32_t)sqrt(sumSquares / pointCount);
+}
+
+// Keep the burst's lowest-delay exchange and refit
+void endTimeSyncBurst() {
+  if (!burstHasExchange) {
+    return;
+  }
+  burstHasExchange = false;
+  TimeSyncPoint point = burstBest;
+
+  // The phone clock was set (or the line was wrong) - start over from here
+  if (stats.synced &&
+      llabs(point.offsetUs - predictOffset(point.deviceUs)) > TIME_SYNC_STEP_US + point.delayUs / 2) {
+    pointHead = 0;
+    pointCount = 0;
+    stats.steps++;
+  }
+
+  points[pointHead] = point;
+  pointHead = (pointHead + 1) % TIME_SYNC_POINTS;
+  if (pointCount < TIME_SYNC_POINTS) {
+    pointCount++;
+  }
+  fitLine();
+
+  stats.synced = true;
+  stats.offsetUs = point.offsetUs;
+  stats.driftPpm = lineSlope * 1e6;
+  stats.delayUs = point.delayUs;
+  stats.points = pointCount;
+  stats.lastPointUs = point.deviceUs;
+}
+
+// Phone time (Unix µs) at a device time; false until the first burst
+bool deviceToPhoneTime(uint64_t deviceUs, int64_t &phoneUs) {
+  if (!stats.synced) {
+    return false;
+  }
+  phoneUs = (int64_t)deviceUs + predictOffset((int64_t)deviceUs);
+  return true;
+}
+
+bool isTimeSynced() {
+  return stats.synced;
+}
+
+const TimeSyncStats& getTimeSyncStats() {
+  return stats;
+}
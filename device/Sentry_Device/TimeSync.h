@@ -0,0 +1,62 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <Arduino.h>
+
+// Device-to-phone clock synchronization (NTP-style)
+// The device sends a request at t1 (its own clock); the phone stamps receipt
+// t2 and reply t3 on its clock (Unix time, µs) and the reply arrives at t4.
+// Each exchange gives
+//   offset = ((t2 - t1) + (t3 - t4)) / 2    phone minus device
+//   delay  = (t4 - t1) - (t3 - t2)          round trip spent on the link
+// and the offset is wrong by at most delay / 2, when the link is asymmetric.
+// Over BLE it is: a reply written right after a notification always waits
+// most of a connection interval. Both sides therefore send after a random
+// delay of up to TIME_SYNC_SPREAD_MS, which spreads either leg evenly over
+// the interval. Exchanges run in bursts and only the lowest-delay one of a
+// burst is kept. Kept offsets are fitted with a least-squares line against
+// device time, weighted by 1/delay^2; its slope is the drift between the two
+// crystals, so sample times stay aligned between bursts.
+
+// Time Sync Constants
+#define TIME_SYNC_BURST            8       // Exchanges per burst (~1 s)
+#define TIME_SYNC_SPREAD_MS        50      // Random send delay, at least the longest connection interval
+#define TIME_SYNC_INTERVAL_MS      15000   // Between bursts once the drift is fitted
+#define TIME_SYNC_FAST_INTERVAL_MS 2000    // Between bursts until then
+#define TIME_SYNC_REPLY_TIMEOUT_MS 1000    // An unanswered request counts as lost
+#define TIME_SYNC_MAX_DELAY_US     150000  // Slower round trips are discarded
+#define TIME_SYNC_POINTS           32      // Burst results in the fit (~8 min at the slow interval)
+#define TIME_SYNC_MIN_POINTS       4       // Drift is fitted from this many
+#define TIME_SYNC_STEP_US          50000   // A point this far off the line means the phone clock was set
+#define TIME_SYNC_MAX_DRIFT_PPM    500     // Larger slopes are noise, not crystals
+
+// One kept exchange
+struct TimeSyncPoint {
+  int64_t deviceUs;              // Device time midway through the exchange
+  int64_t offsetUs;              // Phone minus device
+  uint32_t delayUs;
+};
+
+struct TimeSyncStats {
+  bool synced;                   // Frames can be stamped in phone time
+  int64_t offsetUs;              // Phone minus device at the newest point
+  float driftPpm;                // Phone clock rate relative to the device's
+  uint32_t delayUs;              // Round trip of the newest point
+  uint32_t residualUs;           // RMS distance of the points from the fitted line
+  uint8_t points;                // Points in the fit
+  uint32_t exchanges;            // Replies received
+  uint32_t rejected;             // Replies too slow or inconsistent to use
+  uint32_t lost;                 // Requests never answered
+  uint32_t steps;                // Phone clock steps (fit restarted)
+  uint64_t lastPointUs;          // Device time of the newest point
+};
+
+void resetTimeSync();
+void addTimeSyncExchange(int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+void noteTimeSyncLost();
+void endTimeSyncBurst();
+bool deviceToPhoneTime(uint64_t deviceUs, int64_t &phoneUs);
+bool isTimeSynced();
+const TimeSyncStats& getTimeSyncStats();
+
+#endif
@@ -0,0 +1,84 @@
+#include "HostTest.h"
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+struct HostTestCase {
+    const char* group;
+    const char* name;
+    HostTestFunction function;
+};
+
+static std::vector<HostTestCase>& registry() {
+    static std::vector<HostTestCase> cases;
+    return cases;
+}
+
+HostTestRegistrar::HostTestRegistrar(const char* group, const char* name, HostTestFunction function) {
+    registry().push_back({group, name, function});
+}
+
+void hostTestFail(const char* file, int line, const char* expression, const char* values) {
+    printf("  %s:%d: CHECK(%s) failed", file, line, expression);
+    if (values != nullptr) {
+        printf(" (%s)", values);
+    }
+    printf("\n");
+    fflush(stdout);
+    _exit(1);
+}
+
+// Run one case in a child process; true if it passed
+static bool runCase(const HostTestCase& test) {
+    printf("[ RUN  ] %s.%s\n", test.group, test.name);
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        test.function();
+        fflush(stdout);
+        _exit(0);  // Simulated tasks may still be parked on their threads
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    bool passed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (WIFSIGNALED(status)) {
+        printf("  terminated by signal %d\n", WTERMSIG(status));
+    }
+    printf("[ %s ] %s.%s\n", passed ? "PASS" : "FAIL", test.group, test.name);
+    return passed;
+}
+
+static bool matches(const HostTestCase& test, const char* filter) {
+    std::string full = std::string(test.group) + "." + test.name;
+    return filter == nullptr || strcmp(filter, test.group) == 0 || full == filter;
+}
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    if (filter != nullptr && strcmp(filter, "--list") == 0) {
+        for (const HostTestCase& test : registry()) {
+            printf("%s.%s\n", test.group, test.name);
+        }
+        return 0;
+    }
+
+    int run = 0;
+    int failed = 0;
+    for (const HostTestCase& test : registry()) {
+        if (!matches(test, filter)) {
+            continue;
+        }
+        run++;
+        if (!runCase(test)) {
+            failed++;
+        }
+    }
+    if (run == 0) {
+        printf("No test matches '%s'\n", filter);
+        return 1;
+    }
+    printf("%d of %d passed\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
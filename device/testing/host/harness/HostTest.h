@@ -0,0 +1,55 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <math.h>
+
+// Minimal test registry for the host tests
+// HOST_TEST(group, name) registers a case. Each case runs in a child process,
+// so the sketch's file-scope state starts from power-on every time. A failed
+// CHECK prints the expression (and both values) and ends the case.
+//
+//   sentry_host_tests               run everything
+//   sentry_host_tests fifo          run one group (one ctest entry per group)
+//   sentry_host_tests fifo.overflow run one case
+//   sentry_host_tests --list
+
+typedef void (*HostTestFunction)();
+
+struct HostTestRegistrar {
+    HostTestRegistrar(const char* group, const char* name, HostTestFunction function);
+};
+
+void hostTestFail(const char* file, int line, const char* expression, const char* values);
+
+#define HOST_TEST(group, name) \
+    static void hostTest_##group##_##name(); \
+    static HostTestRegistrar hostTestRegistrar_##group##_##name(#group, #name, hostTest_##group##_##name); \
+    static void hostTest_##group##_##name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            hostTestFail(__FILE__, __LINE__, #condition, nullptr); \
+        } \
+    } while (0)
+
+#define HOST_TEST_COMPARE(a, op, b) \
+    do { \
+        double hostTestA = (double)(a); \
+        double hostTestB = (double)(b); \
+        if (!(hostTestA op hostTestB)) { \
+            char hostTestValues[96]; \
+            snprintf(hostTestValues, sizeof(hostTestValues), "%.9g " #op " %.9g", hostTestA, hostTestB); \
+            hostTestFail(__FILE__, __LINE__, #a " " #op " " #b, hostTestValues); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) HOST_TEST_COMPARE(a, ==, b)
+#define CHECK_LT(a, b) HOST_TEST_COMPARE(a, <, b)
+#define CHECK_LE(a, b) HOST_TEST_COMPARE(a, <=, b)
+#define CHECK_GT(a, b) HOST_TEST_COMPARE(a, >, b)
+#define CHECK_GE(a, b) HOST_TEST_COMPARE(a, >=, b)
+#define CHECK_NEAR(a, b, tolerance) HOST_TEST_COMPARE(fabs((double)(a) - (double)(b)), <=, tolerance)
+
+#endif
@@ -0,0 +1,507 @@
+#include "SimMpu6050.h"
+#include <Wire.h>
+
+#define SIM_MPU_WHO_AM_I           0x68
+#define SIM_MPU_TEMP_OFFSET_C      36.53
+#define SIM_MPU_TEMP_LSB_PER_C     340.0
+#define SIM_MPU_ACCEL_LSB_PER_G    16384.0   // At ±2 g
+#define SIM_MPU_GYRO_LSB_PER_DPS   131.0     // At ±250 °/s
+#define SIM_MPU_MOT_MG_PER_LSB     2
+
+TwoWire Wire;
+
+static const float WAKE_FREQ_HZ[] = {1.25f, 5.0f, 20.0f, 40.0f};
+
+SimMotion simRestingMotion(uint64_t timeUs) {
+    return {{0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}, 25.0f};
+}
+
+static int16_t toCounts(double value, double lsbPerUnit) {
+    return (int16_t)constrain(lround(value * lsbPerUnit), (long)INT16_MIN, (long)INT16_MAX);
+}
+
+SimMpu6050::SimMpu6050(uint8_t address, int pin) : i2cAddress(address), intPin(pin), motion(simRestingMotion) {
+    powerOnReset();
+    SimI2CBus::instance().attach(this);
+    simAddEventSource(this);
+}
+
+SimMpu6050::~SimMpu6050() {
+    simRemoveEventSource(this);
+    SimI2CBus::instance().detach(this);
+}
+
+// Register defaults after power-up: asleep, nothing enabled
+void SimMpu6050::powerOnReset() {
+    memset(regs, 0, sizeof(regs));
+    regs[MPU6050_RA_PWR_MGMT_1] = 1 << MPU6050_PWR1_SLEEP_BIT;
+    regs[MPU6050_RA_WHO_AM_I] = SIM_MPU_WHO_AM_I;
+    memcpy(&regs[MPU6050_RA_SELF_TEST_X], trimRegs, sizeof(trimRegs));
+    fifo.clear();
+    clockRunning = false;
+    pulseEndUs = UINT64_MAX;
+    haveCycleAccel = false;
+    motionCount = 0;
+    setIntPin(false);
+}
+
+void SimMpu6050::setPresent(bool isPresent) {
+    if (isPresent && !present) {
+        powerOnReset();
+    }
+    present = isPresent;
+    if (!present) {
+        clockRunning = false;
+        setIntPin(false);
+    }
+}
+
+// Pack the codes as the part stores them: gyro in SELF_TEST_X/Y/Z [4:0],
+// accel split between SELF_TEST_X/Y/Z [7:5] and SELF_TEST_A [5:0]
+void SimMpu6050::setSelfTestTrim(const uint8_t codes[6]) {
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        trimRegs[axis] = (uint8_t)(((codes[axis] & 0x1C) << 3) | (codes[3 + axis] & 0x1F));
+    }
+    trimRegs[3] = (uint8_t)(((codes[0] & 0x03) << 4) | ((codes[1] & 0x03) << 2) | (codes[2] & 0x03));
+    memcpy(&regs[MPU6050_RA_SELF_TEST_X], trimRegs, sizeof(trimRegs));
+}
+
+void SimMpu6050::setSelfTestResponse(const float response[6]) {
+    memcpy(selfTestResponse, response, sizeof(selfTestResponse));
+}
+
+bool SimMpu6050::isSampling() const {
+    return present && !bit(MPU6050_RA_PWR_MGMT_1, MPU6050_PWR1_SLEEP_BIT);
+}
+
+// Output period in true time; the part's own oscillator sets the rate
+double SimMpu6050::samplePeriodUs() const {
+    double rateHz;
+    if (bit(MPU6050_RA_PWR_MGMT_1, MPU6050_PWR1_CYCLE_BIT)) {
+        rateHz = WAKE_FREQ_HZ[regs[MPU6050_RA_PWR_MGMT_2] >> 6];
+    } else {
+        uint8_t dlpf = regs[MPU6050_RA_CONFIG] & 0x07;
+        double baseHz = (dlpf == 0 || dlpf == 7) ? 8000.0 : 1000.0;
+        rateHz = baseHz / (1 + regs[MPU6050_RA_SMPLRT_DIV]);
+    }
+    return 1e6 / (rateHz * (1.0 + oscillatorPpm * 1e-6));
+}
+
+void SimMpu6050::restartSampleClock() {
+    if (!isSampling()) {
+        clockRunning = false;
+        return;
+    }
+    // A new divider takes effect from the next sample on
+    double period = samplePeriodUs();
+    if (!clockRunning) {
+        nextSampleUs = simNowUs() + period;
+        clockRunning = true;
+    } else {
+        nextSampleUs = min(nextSampleUs, simNowUs() + period);
+    }
+}
+
+uint64_t SimMpu6050::nextEventUs() const {
+    uint64_t next = pulseEndUs;
+    if (clockRunning) {
+        next = min(next, (uint64_t)ceil(nextSampleUs));
+    }
+    return next;
+}
+
+void SimMpu6050::runEvent(uint64_t nowUs) {
+    if (pulseEndUs <= nowUs) {
+        pulseEndUs = UINT64_MAX;
+        setIntPin(false);
+    }
+    if (clockRunning && nextSampleUs <= nowUs) {
+        nextSampleUs += samplePeriodUs();
+        takeSample(nowUs);
+    }
+}
+
+// Latch one sample into the data registers and the FIFO
+void SimMpu6050::takeSample(uint64_t nowUs) {
+    SimMotion m = motion(nowUs);
+    uint8_t accelRange = (regs[MPU6050_RA_ACCEL_CONFIG] >> 3) & 0x03;
+    uint8_t gyroRange = (regs[MPU6050_RA_GYRO_CONFIG] >> 3) & 0x03;
+    double accelLsb = SIM_MPU_ACCEL_LSB_PER_G / (1 << accelRange);
+    double gyroLsb = SIM_MPU_GYRO_LSB_PER_DPS / (1 << gyroRange);
+
+    // XA/YA/ZA_ST and XG/YG/ZG_ST are bits 7..5
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        if (bit(MPU6050_RA_ACCEL_CONFIG, 7 - axis)) {
+            m.accelG[axis] += selfTestResponse[axis];
+        }
+        if (bit(MPU6050_RA_GYRO_CONFIG, 7 - axis)) {
+            m.gyroDps[axis] += selfTestResponse[3 + axis];
+        }
+    }
+
+    int16_t values[7];
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        values[axis] = toCounts(m.accelG[axis], accelLsb);
+        values[4 + axis] = toCounts(m.gyroDps[axis], gyroLsb);
+    }
+    values[3] = toCounts(m.temperatureC - SIM_MPU_TEMP_OFFSET_C, SIM_MPU_TEMP_LSB_PER_C);
+
+    // Low-power cycle mode: accel only, judged for motion
+    if (bit(MPU6050_RA_PWR_MGMT_1, MPU6050_PWR1_CYCLE_BIT)) {
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            regs[MPU6050_RA_ACCEL_XOUT_H + axis * 2] = (uint8_t)(values[axis] >> 8);
+            regs[MPU6050_RA_ACCEL_XOUT_H + axis * 2 + 1] = (uint8_t)values[axis];
+        }
+        detectMotion(values);
+        return;
+    }
+
+    sampleTimesUs.push_back(nowUs);
+    for (uint8_t i = 0; i < 7; i++) {
+        regs[MPU6050_RA_ACCEL_XOUT_H + i * 2] = (uint8_t)(values[i] >> 8);
+        regs[MPU6050_RA_ACCEL_XOUT_H + i * 2 + 1] = (uint8_t)values[i];
+    }
+
+    if (bit(MPU6050_RA_USER_CTRL, MPU6050_USERCTRL_FIFO_EN_BIT)) {
+        // Enabled fields in register order: accel, temperature, gyro X/Y/Z
+        static const struct { uint8_t enableBit; uint8_t first; uint8_t words; } fields[] = {
+            {MPU6050_ACCEL_FIFO_EN_BIT, 0, 3}, {MPU6050_TEMP_FIFO_EN_BIT, 3, 1}, {MPU6050_XG_FIFO_EN_BIT, 4, 1},
+            {MPU6050_YG_FIFO_EN_BIT, 5, 1}, {MPU6050_ZG_FIFO_EN_BIT, 6, 1}};
+        for (const auto& field : fields) {
+            if (!bit(MPU6050_RA_FIFO_EN, field.enableBit)) {
+                continue;
+            }
+            for (uint8_t w = 0; w < field.words; w++) {
+                fifo.push_back((uint8_t)(values[field.first + w] >> 8));
+                fifo.push_back((uint8_t)values[field.first + w]);
+            }
+        }
+        if (fifo.size() > SIM_MPU_FIFO_SIZE) {
+            fifo.erase(fifo.begin(), fifo.begin() + (fifo.size() - SIM_MPU_FIFO_SIZE));
+            overflows++;
+            raiseInterrupt(MPU6050_INTERRUPT_FIFO_OFLOW_BIT);
+        }
+    }
+    raiseInterrupt(MPU6050_INTERRUPT_DATA_RDY_BIT);
+}
+
+// Motion when an axis moved more than MOT_THR since the previous wake-up
+// sample, for MOT_DUR samples in a row
+void SimMpu6050::detectMotion(const int16_t accel[3]) {
+    if (haveCycleAccel) {
+        double mgPerCount = 1000.0 / (SIM_MPU_ACCEL_LSB_PER_G / (1 << ((regs[MPU6050_RA_ACCEL_CONFIG] >> 3) & 0x03)));
+        double largest = 0.0;
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            largest = max(largest, fabs((double)(accel[axis] - lastCycleAccel[axis])) * mgPerCount);
+        }
+        if (largest > regs[MPU6050_RA_MOT_THR] * SIM_MPU_MOT_MG_PER_LSB) {
+            motionCount++;
+        } else {
+            motionCount = 0;
+        }
+        if (motionCount >= max((uint8_t)1, regs[MPU6050_RA_MOT_DUR])) {
+            motionCount = 0;
+            motionEvents++;
+            raiseInterrupt(MPU6050_INTERRUPT_MOT_BIT);
+        }
+    }
+    memcpy(lastCycleAccel, accel, sizeof(lastCycleAccel));
+    haveCycleAccel = true;
+}
+
+void SimMpu6050::raiseInterrupt(uint8_t statusBit) {
+    regs[MPU6050_RA_INT_STATUS] |= 1 << statusBit;
+    if (!bit(MPU6050_RA_INT_ENABLE, statusBit)) {
+        return;
+    }
+    setIntPin(true);
+    if (!bit(MPU6050_RA_INT_PIN_CFG, MPU6050_INTCFG_LATCH_INT_EN_BIT)) {
+        pulseEndUs = simNowUs() + SIM_MPU_INT_PULSE_US;
+    }
+}
+
+void SimMpu6050::setIntPin(bool high) {
+    if (intPin >= 0) {
+        simSetPinLevel(intPin, high);
+    }
+}
+
+bool SimMpu6050::acknowledges() {
+    if (!present) {
+        return false;
+    }
+    if (failuresLeft > 0) {
+        failuresLeft--;
+        return false;
+    }
+    transferCount++;
+    return true;
+}
+
+bool SimMpu6050::read(uint8_t reg, uint8_t* data, uint8_t length) {
+    for (uint8_t i = 0; i < length; i++) {
+        // FIFO_R_W does not auto-increment
+        if (reg == MPU6050_RA_FIFO_R_W) {
+            if (fifo.empty()) {
+                data[i] = 0xFF;
+            } else {
+                data[i] = fifo.front();
+                fifo.erase(fifo.begin());
+            }
+            continue;
+        }
+        uint8_t r = (reg + i) % SIM_MPU_REGISTERS;
+        if (r == MPU6050_RA_FIFO_COUNTH) {
+            data[i] = fifo.size() >> 8;
+        } else if (r == MPU6050_RA_FIFO_COUNTL) {
+            data[i] = fifo.size() & 0xFF;
+        } else if (r == MPU6050_RA_INT_STATUS) {
+            data[i] = regs[r];
+            regs[r] = 0;
+            if (bit(MPU6050_RA_INT_PIN_CFG, MPU6050_INTCFG_LATCH_INT_EN_BIT)) {
+                setIntPin(false);
+            }
+        } else {
+            data[i] = regs[r];
+        }
+    }
+    return true;
+}
+
+void SimMpu6050::write(uint8_t reg, const uint8_t* data, uint8_t length) {
+    for (uint8_t i = 0; i < length; i++) {
+        writeRegister((reg + i) % SIM_MPU_REGISTERS, data[i]);
+    }
+}
+
+void SimMpu6050::writeRegister(uint8_t reg, uint8_t value) {
+    switch (reg) {
+        case MPU6050_RA_INT_STATUS:
+        case MPU6050_RA_FIFO_COUNTH:
+        case MPU6050_RA_FIFO_COUNTL:
+        case MPU6050_RA_FIFO_R_W:
+        case MPU6050_RA_WHO_AM_I:
+            return;  // Read-only (FIFO writes are not modelled)
+        case MPU6050_RA_PWR_MGMT_1:
+            if (value & (1 << MPU6050_PWR1_DEVICE_RESET_BIT)) {
+                powerOnReset();
+                return;
+            }
+            if ((value ^ regs[reg]) & (1 << MPU6050_PWR1_CYCLE_BIT)) {
+                haveCycleAccel = false;
+                clockRunning = false;
+            }
+            regs[reg] = value;
+            restartSampleClock();
+            return;
+        case MPU6050_RA_SMPLRT_DIV:
+        case MPU6050_RA_CONFIG:
+        case MPU6050_RA_PWR_MGMT_2:
+            regs[reg] = value;
+            restartSampleClock();
+            return;
+        case MPU6050_RA_USER_CTRL:
+            if (value & (1 << MPU6050_USERCTRL_FIFO_RESET_BIT)) {
+                fifo.clear();
+            }
+            regs[reg] = value & ~(1 << MPU6050_USERCTRL_FIFO_RESET_BIT);
+            return;
+        default:
+            regs[reg] = value;
+            return;
+    }
+}
+
+// Bus
+
+SimI2CBus& SimI2CBus::instance() {
+    static SimI2CBus bus;
+    return bus;
+}
+
+void SimI2CBus::attach(SimMpu6050* device) {
+    devices.push_back(device);
+}
+
+void SimI2CBus::detach(SimMpu6050* device) {
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (devices[i] == device) {
+            devices.erase(devices.begin() + i);
+            return;
+        }
+    }
+}
+
+SimMpu6050* SimI2CBus::find(uint8_t address) {
+    for (SimMpu6050* device : devices) {
+        if (device->address() == address) {
+            return device;
+        }
+    }
+    return nullptr;
+}
+
+// SDA reads low while held; each low-high SCL transition clocks out one bit
+void SimI2CBus::wirePins(uint8_t sda, uint8_t scl) {
+    simSetPinReader(sda, [this] { return sdaHeldPulses > 0 ? LOW : HIGH; });
+    simSetPinWriter(scl, [this](uint8_t level) {
+        if (level == LOW) {
+            sclLow = true;
+        } else if (sclLow) {
+            sclLow = false;
+            if (sdaHeldPulses > 0) {
+                sdaHeldPulses--;
+            }
+        }
+    });
+}
+
+void SimI2CBus::holdSdaLow(uint8_t clockPulses) {
+    sdaHeldPulses = clockPulses;
+}
+
+uint32_t SimI2CBus::clockHz() const {
+    return clockOverrideHz > 0 ? clockOverrideHz : Wire.getClock();
+}
+
+uint64_t SimI2CBus::transferUs(uint16_t bits) const {
+    return ((uint64_t)bits * 1000000 + clockHz() - 1) / clockHz();
+}
+
+// A held bus fails every transfer after the Wire timeout
+bool SimI2CBus::transferBlocked(uint16_t timeoutMs) {
+    if (sdaHeldPulses == 0) {
+        return false;
+    }
+    uint64_t stallUs = (uint64_t)min(timeoutMs, Wire.getTimeOut()) * 1000;
+    busyTimeUs += stallUs;
+    stuckCount++;
+    simElapseUs(stallUs);
+    return true;
+}
+
+bool SimI2CBus::read(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length, uint16_t timeoutMs) {
+    if (!Wire.isStarted() || transferBlocked(timeoutMs)) {
+        return false;
+    }
+    SimMpu6050* device = find(address);
+    if (device == nullptr || !device->acknowledges()) {
+        busyTimeUs += transferUs(SIM_I2C_ADDRESS_ONLY_BITS);
+        simElapseUs(transferUs(SIM_I2C_ADDRESS_ONLY_BITS));
+        return false;
+    }
+    // The part latches a burst when it is addressed, so a sample landing while
+    // the bytes are clocked out shows up in the next read, not this one
+    uint64_t us = transferUs(SIM_I2C_READ_BITS + SIM_I2C_BYTE_BITS * length);
+    uint64_t addressingUs = transferUs(SIM_I2C_READ_BITS);
+    busyTimeUs += us;
+    simElapseUs(addressingUs);
+    bool ok = device->read(reg, data, length);
+    simElapseUs(us - addressingUs);
+    return ok;
+}
+
+bool SimI2CBus::write(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length) {
+    if (!Wire.isStarted() || transferBlocked(Wire.getTimeOut())) {
+        return false;
+    }
+    SimMpu6050* device = find(address);
+    if (device == nullptr || !device->acknowledges()) {
+        busyTimeUs += transferUs(SIM_I2C_ADDRESS_ONLY_BITS);
+        simElapseUs(transferUs(SIM_I2C_ADDRESS_ONLY_BITS));
+        return false;
+    }
+    uint64_t us = transferUs(SIM_I2C_WRITE_BITS + SIM_I2C_BYTE_BITS * length);
+    busyTimeUs += us;
+    simElapseUs(us);
+    device->write(reg, data, length);
+    return true;
+}
+
+// Wire
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    started = true;
+    if (frequency > 0) {
+        clockHz = frequency;
+    }
+    return true;
+}
+
+bool TwoWire::end() {
+    started = false;
+    return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+    clockHz = frequency;
+    return true;
+}
+
+void TwoWire::setTimeOut(uint16_t timeout) {
+    timeoutMs = timeout;
+}
+
+// I2Cdev
+
+uint16_t I2Cdev::readTimeout = 1000;
+
+int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data, uint16_t timeout,
+                         void* wireObj) {
+    return SimI2CBus::instance().read(devAddr, regAddr, data, length, timeout) ? (int8_t)length : -1;
+}
+
+int8_t I2Cdev::readByte(uint8_t devAddr, uint8_t regAddr, uint8_t* data, uint16_t timeout, void* wireObj) {
+    return readBytes(devAddr, regAddr, 1, data, timeout, wireObj);
+}
+
+int8_t I2Cdev::readBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8_t length, uint8_t* data,
+                        uint16_t timeout, void* wireObj) {
+    uint8_t b;
+    int8_t count = readByte(devAddr, regAddr, &b, timeout, wireObj);
+    if (count > 0) {
+        uint8_t shift = bitStart - length + 1;
+        *data = (b >> shift) & ((1 << length) - 1);
+    }
+    return count;
+}
+
+int8_t I2Cdev::readBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t* data, uint16_t timeout,
+                       void* wireObj) {
+    uint8_t b;
+    int8_t count = readByte(devAddr, regAddr, &b, timeout, wireObj);
+    if (count > 0) {
+        *data = b & (1 << bitNum);
+    }
+    return count;
+}
+
+bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data, void* wireObj) {
+    return SimI2CBus::instance().write(devAddr, regAddr, data, length);
+}
+
+bool I2Cdev::writeByte(uint8_t devAddr, uint8_t regAddr, uint8_t data, void* wireObj) {
+    return writeBytes(devAddr, regAddr, 1, &data, wireObj);
+}
+
+// Read-modify-write, two transfers as in the library
+bool I2Cdev::writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8_t length, uint8_t data,
+                       void* wireObj) {
+    uint8_t b;
+    if (readByte(devAddr, regAddr, &b, readTimeout, wireObj) != 1) {
+        return false;
+    }
+    uint8_t shift = bitStart - length + 1;
+    uint8_t mask = ((1 << length) - 1) << shift;
+    b = (b & ~mask) | ((data << shift) & mask);
+    return writeByte(devAddr, regAddr, b, wireObj);
+}
+
+bool I2Cdev::writeBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t data, void* wireObj) {
+    uint8_t b;
+    if (readByte(devAddr, regAddr, &b, readTimeout, wireObj) != 1) {
+        return false;
+    }
+    b = data != 0 ? (b | (1 << bitNum)) : (b & ~(1 << bitNum));
+    return writeByte(devAddr, regAddr, b, wireObj);
+}
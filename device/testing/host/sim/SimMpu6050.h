@@ -0,0 +1,151 @@
+#ifndef SIM_MPU6050_H
+#define SIM_MPU6050_H
+
+#include "SimRtos.h"
+#include <MPU6050.h>
+#include <functional>
+#include <vector>
+
+// Register-level MPU6050 on a simulated I2C bus
+// The model keeps the register file and acts on what the sketch writes:
+// sample-rate divider and DLPF set the output rate (from a 1 kHz or 8 kHz
+// base, off by the oscillator error), FIFO_EN and USER_CTRL route samples
+// into a 1024-byte FIFO that drops its oldest bytes and flags FIFO_OFLOW when
+// full, INT_ENABLE/INT_PIN_CFG drive the INT pin (50 µs pulse or latched until
+// INT_STATUS is read), and CYCLE mode samples the accel at LP_WAKE_CTRL for
+// motion detection against MOT_THR/MOT_DUR. Data registers and FIFO entries
+// carry the motion source's values in the configured ranges, plus the
+// self-test response on axes whose XA..ZG_ST bit is set. The factory trim
+// codes in SELF_TEST_X..A survive resets.
+//
+// Bus transfers take their time on the wire at the Wire clock: 9 bit times
+// per byte plus start, restart and stop, so a 14-byte register burst costs
+// 387.5 µs at 400 kHz. Faults: an absent device NACKs its address, a
+// device can be told to fail its next transfers, and a slave can hold SDA
+// low until SCL is clocked (every transfer then times out).
+
+#define SIM_MPU_FIFO_SIZE          1024
+#define SIM_MPU_REGISTERS          128
+#define SIM_MPU_INT_PULSE_US       50
+
+// I2C framing in bit times (9 per byte including ACK)
+#define SIM_I2C_ADDRESS_ONLY_BITS  11        // START, address NACKed, STOP
+#define SIM_I2C_READ_BITS          29        // START, address+W, register, RESTART, address+R, STOP
+#define SIM_I2C_WRITE_BITS         20        // START, address+W, register, STOP
+#define SIM_I2C_BYTE_BITS          9
+
+// Physical motion at the sensor
+struct SimMotion {
+    float accelG[3];
+    float gyroDps[3];
+    float temperatureC;
+};
+
+typedef std::function<SimMotion(uint64_t timeUs)> SimMotionSource;
+
+// Level, still, 25 °C
+SimMotion simRestingMotion(uint64_t timeUs);
+
+class SimMpu6050 : public SimEventSource {
+public:
+    SimMpu6050(uint8_t address, int intPin = -1);
+    ~SimMpu6050();
+
+    // Environment
+    void setMotion(SimMotionSource source) { motion = source; }
+    void setOscillatorErrorPpm(float ppm) { oscillatorPpm = ppm; }
+    void setPresent(bool present);           // Unplugged parts lose their configuration
+    void failTransfers(uint32_t count) { failuresLeft = count; }
+    // Self-test: 5-bit trim codes and the output change with the actuators
+    // on, per axis in ax..gz order (g and °/s)
+    void setSelfTestTrim(const uint8_t codes[6]);
+    void setSelfTestResponse(const float response[6]);
+
+    // Introspection
+    uint8_t address() const { return i2cAddress; }
+    uint8_t registerValue(uint8_t reg) const { return regs[reg % SIM_MPU_REGISTERS]; }
+    uint16_t fifoBytes() const { return fifo.size(); }
+    bool isSampling() const;
+    uint32_t samplesTaken() const { return sampleTimesUs.size(); }
+    const std::vector<uint64_t>& sampleTimes() const { return sampleTimesUs; }  // True time of each sample
+    uint32_t fifoOverflows() const { return overflows; }
+    uint32_t transfers() const { return transferCount; }
+    uint32_t motionInterrupts() const { return motionEvents; }
+
+    // Bus side (SimI2CBus)
+    bool acknowledges();
+    bool read(uint8_t reg, uint8_t* data, uint8_t length);
+    void write(uint8_t reg, const uint8_t* data, uint8_t length);
+
+    // SimEventSource
+    uint64_t nextEventUs() const override;
+    void runEvent(uint64_t nowUs) override;
+
+private:
+    void powerOnReset();
+    void writeRegister(uint8_t reg, uint8_t value);
+    void restartSampleClock();
+    double samplePeriodUs() const;
+    void takeSample(uint64_t nowUs);
+    void detectMotion(const int16_t accel[3]);
+    void raiseInterrupt(uint8_t statusBit);
+    void setIntPin(bool high);
+    bool bit(uint8_t reg, uint8_t bitNum) const { return regs[reg] & (1 << bitNum); }
+
+    uint8_t i2cAddress;
+    int intPin;
+    bool present = true;
+    uint32_t failuresLeft = 0;
+    float oscillatorPpm = 0.0f;
+    SimMotionSource motion;
+    uint8_t trimRegs[4] = {0, 0, 0, 0};
+    float selfTestResponse[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+
+    uint8_t regs[SIM_MPU_REGISTERS];
+    std::vector<uint8_t> fifo;
+    double nextSampleUs = 0.0;
+    bool clockRunning = false;
+    uint64_t pulseEndUs = UINT64_MAX;
+    int16_t lastCycleAccel[3] = {0, 0, 0};
+    bool haveCycleAccel = false;
+    uint8_t motionCount = 0;
+
+    std::vector<uint64_t> sampleTimesUs;
+    uint32_t overflows = 0;
+    uint32_t transferCount = 0;
+    uint32_t motionEvents = 0;
+};
+
+// The shared bus; devices attach themselves on construction
+class SimI2CBus {
+public:
+    static SimI2CBus& instance();
+
+    void attach(SimMpu6050* device);
+    void detach(SimMpu6050* device);
+    void wirePins(uint8_t sda, uint8_t scl);
+    void holdSdaLow(uint8_t clockPulses);   // A slave stuck mid-byte until clocked out
+    void setClockOverrideHz(uint32_t hz) { clockOverrideHz = hz; }
+
+    // Transfers on behalf of I2Cdev; false when not acknowledged
+    bool read(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length, uint16_t timeoutMs);
+    bool write(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length);
+
+    uint32_t clockHz() const;
+    uint64_t transferUs(uint16_t bits) const;
+    uint64_t busyUs() const { return busyTimeUs; }
+    uint32_t stuckTransfers() const { return stuckCount; }
+
+private:
+    SimMpu6050* find(uint8_t address);
+    bool transferBlocked(uint16_t timeoutMs);
+
+    std::vector<SimMpu6050*> devices;
+    uint8_t sdaHeldPulses = 0;
+    bool sclLow = false;
+    uint32_t clockOverrideHz = 0;
+    uint64_t busyTimeUs = 0;
+    uint32_t stuckCount = 0;
+};
+
+#endif
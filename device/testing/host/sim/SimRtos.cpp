@@ -0,0 +1,497 @@
+#include "SimRtos.h"
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+
+#define SIM_GPIO_COUNT             40
+#define SIM_NO_WAKE                UINT64_MAX
+
+// One FreeRTOS task, run on its own thread but only while handed the CPU
+struct SimTask {
+    void (*entry)(void*);
+    void* param;
+    std::string name;
+    std::thread thread;
+    bool started = false;
+    bool finished = false;
+    bool cancelled = false;
+    bool waitingNotify = false;           // Blocked in ulTaskNotifyTake()
+    uint32_t notifications = 0;
+    uint64_t wakeUs = SIM_NO_WAKE;        // Blocked until this time
+};
+
+// Thrown inside a deleted task to unwind it off its thread
+struct SimTaskExit {};
+
+struct SimPendingIsr {
+    uint64_t atUs;
+    void (*isr)(void);
+};
+
+struct SimPin {
+    bool level = false;
+    void (*isr)(void) = nullptr;
+    int isrMode = 0;
+    std::function<int()> reader;
+    std::function<void(uint8_t)> writer;
+};
+
+static uint64_t nowUs = 0;
+static std::vector<SimEventSource*> sources;
+static std::vector<std::unique_ptr<SimTask>> tasks;
+static std::vector<SimPendingIsr> pendingIsrs;
+static SimPin pins[SIM_GPIO_COUNT];
+static bool tasksStarved = false;
+static bool sleeping = false;
+static uint32_t isrLatencyMinUs = 0;
+static uint32_t isrLatencyMaxUs = 0;
+static std::mt19937 rng(12345);
+
+// Sleep state
+static uint64_t sleepTimerUs = 0;
+static bool gpioWakeEnabled = false;
+static int gpioWakePin = -1;
+static uint64_t sleptUs = 0;
+static uint32_t sleeps = 0;
+
+// CPU hand-off between the test thread and the task threads
+static std::mutex handoffMutex;
+static std::condition_variable handoff;
+static SimTask* running = SIM_LOOP_CONTEXT;
+static thread_local SimTask* self = SIM_LOOP_CONTEXT;
+
+void simAddEventSource(SimEventSource* source) {
+    sources.push_back(source);
+}
+
+void simRemoveEventSource(SimEventSource* source) {
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (sources[i] == source) {
+            sources.erase(sources.begin() + i);
+            return;
+        }
+    }
+}
+
+uint64_t simNowUs() {
+    return nowUs;
+}
+
+bool simInTask() {
+    return self != SIM_LOOP_CONTEXT;
+}
+
+// Give the CPU to a task and wait until it blocks again (test thread only)
+static void resumeTask(SimTask* task) {
+    std::unique_lock<std::mutex> lock(handoffMutex);
+    running = task;
+    handoff.notify_all();
+    handoff.wait(lock, [] { return running == SIM_LOOP_CONTEXT; });
+}
+
+// Hand the CPU back from the calling task until something resumes it
+static void blockTask() {
+    SimTask* task = self;
+    {
+        std::unique_lock<std::mutex> lock(handoffMutex);
+        running = SIM_LOOP_CONTEXT;
+        handoff.notify_all();
+        handoff.wait(lock, [task] { return running == task; });
+    }
+    if (task->cancelled) {
+        throw SimTaskExit();
+    }
+}
+
+static void taskThread(SimTask* task) {
+    self = task;
+    {
+        std::unique_lock<std::mutex> lock(handoffMutex);
+        handoff.wait(lock, [task] { return running == task; });
+    }
+    task->started = true;
+    if (!task->cancelled) {
+        try {
+            task->entry(task->param);
+        } catch (const SimTaskExit&) {
+        }
+    }
+    task->finished = true;
+    std::unique_lock<std::mutex> lock(handoffMutex);
+    running = SIM_LOOP_CONTEXT;
+    handoff.notify_all();
+}
+
+static bool isTaskReady(const SimTask* task) {
+    if (task->finished) {
+        return false;
+    }
+    if (!task->started || task->cancelled) {
+        return true;
+    }
+    if (task->waitingNotify && task->notifications > 0) {
+        return true;
+    }
+    return task->wakeUs <= nowUs;
+}
+
+// Run every task that can run now; tasks only ever start from loop()'s context
+static void runReadyTasks() {
+    if (simInTask() || tasksStarved || sleeping) {
+        return;
+    }
+    for (;;) {
+        SimTask* next = nullptr;
+        for (auto& task : tasks) {
+            if (isTaskReady(task.get())) {
+                next = task.get();
+                break;
+            }
+        }
+        if (next == nullptr) {
+            return;
+        }
+        resumeTask(next);
+    }
+}
+
+static uint64_t nextEventUs() {
+    uint64_t next = SIM_NO_WAKE;
+    for (SimEventSource* source : sources) {
+        next = min(next, source->nextEventUs());
+    }
+    for (const SimPendingIsr& pending : pendingIsrs) {
+        next = min(next, pending.atUs);
+    }
+    if (!simInTask() && !tasksStarved && !sleeping) {
+        for (auto& task : tasks) {
+            if (!task->finished) {
+                next = min(next, task->wakeUs);
+            }
+        }
+    }
+    return next;
+}
+
+static void runDueEvents() {
+    bool ran = true;
+    while (ran) {
+        ran = false;
+        for (size_t i = 0; i < pendingIsrs.size(); i++) {
+            if (pendingIsrs[i].atUs <= nowUs) {
+                void (*isr)(void) = pendingIsrs[i].isr;
+                pendingIsrs.erase(pendingIsrs.begin() + i);
+                isr();
+                ran = true;
+                break;
+            }
+        }
+        for (size_t i = 0; i < sources.size(); i++) {
+            if (sources[i]->nextEventUs() <= nowUs) {
+                sources[i]->runEvent(nowUs);
+                ran = true;
+            }
+        }
+    }
+}
+
+bool simElapseUntil(uint64_t deadlineUs, const std::function<bool()>& wake) {
+    for (;;) {
+        runReadyTasks();
+        if (wake && wake()) {
+            return true;
+        }
+        uint64_t next = nextEventUs();
+        if (next > deadlineUs) {
+            break;
+        }
+        nowUs = max(nowUs, next);
+        runDueEvents();
+    }
+    nowUs = max(nowUs, deadlineUs);
+    runReadyTasks();
+    return wake && wake();
+}
+
+void simElapseUntilUs(uint64_t timeUs) {
+    simElapseUntil(timeUs, nullptr);
+}
+
+void simElapseUs(uint64_t us) {
+    simElapseUntil(nowUs + us, nullptr);
+}
+
+void simSetTasksStarved(bool starved) {
+    tasksStarved = starved;
+    runReadyTasks();
+}
+
+uint32_t simTaskCount() {
+    uint32_t count = 0;
+    for (auto& task : tasks) {
+        if (!task->finished) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void simSetIsrLatencyUs(uint32_t minUs, uint32_t maxUs) {
+    isrLatencyMinUs = minUs;
+    isrLatencyMaxUs = max(minUs, maxUs);
+}
+
+// Arduino time
+
+unsigned long millis() {
+    return nowUs / 1000;
+}
+
+unsigned long micros() {
+    return (uint32_t)nowUs;  // 32 bits, as on the ESP32
+}
+
+int64_t esp_timer_get_time() {
+    return nowUs;
+}
+
+void delay(uint32_t ms) {
+    if (simInTask()) {
+        vTaskDelay(pdMS_TO_TICKS(ms));
+    } else {
+        simElapseUs((uint64_t)ms * 1000);
+    }
+}
+
+void delayMicroseconds(uint32_t us) {
+    simElapseUs(us);
+}
+
+void yield() {
+}
+
+long random(long howbig) {
+    return howbig <= 0 ? 0 : (long)(rng() % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig) {
+    return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+// GPIO
+
+static SimPin& pin(uint8_t number) {
+    return pins[number % SIM_GPIO_COUNT];
+}
+
+void pinMode(uint8_t number, uint8_t mode) {
+    if (mode == INPUT_PULLUP) {
+        pin(number).level = true;
+    }
+}
+
+void digitalWrite(uint8_t number, uint8_t level) {
+    SimPin& p = pin(number);
+    p.level = level != LOW;
+    if (p.writer) {
+        p.writer(level);
+    }
+}
+
+int digitalRead(uint8_t number) {
+    SimPin& p = pin(number);
+    return p.reader ? p.reader() : (p.level ? HIGH : LOW);
+}
+
+void attachInterrupt(uint8_t number, void (*isr)(void), int mode) {
+    pin(number).isr = isr;
+    pin(number).isrMode = mode;
+}
+
+void detachInterrupt(uint8_t number) {
+    pin(number).isr = nullptr;
+}
+
+bool simIsInterruptAttached(uint8_t number) {
+    return pin(number).isr != nullptr;
+}
+
+void simSetPinLevel(uint8_t number, bool high) {
+    SimPin& p = pin(number);
+    bool rising = high && !p.level;
+    bool falling = !high && p.level;
+    p.level = high;
+    if (p.isr == nullptr ||
+        !((rising && (p.isrMode == RISING || p.isrMode == CHANGE)) ||
+          (falling && (p.isrMode == FALLING || p.isrMode == CHANGE)))) {
+        return;
+    }
+    if (isrLatencyMaxUs == 0) {
+        p.isr();
+        return;
+    }
+    std::uniform_int_distribution<uint32_t> latency(isrLatencyMinUs, isrLatencyMaxUs);
+    pendingIsrs.push_back({nowUs + latency(rng), p.isr});
+}
+
+bool simPinLevel(uint8_t number) {
+    return pin(number).level;
+}
+
+void simSetPinReader(uint8_t number, std::function<int()> reader) {
+    pin(number).reader = reader;
+}
+
+void simSetPinWriter(uint8_t number, std::function<void(uint8_t)> writer) {
+    pin(number).writer = writer;
+}
+
+// FreeRTOS
+
+BaseType_t xTaskCreatePinnedToCore(void (*entry)(void*), const char* name, uint32_t stackDepth, void* param,
+                                   unsigned int priority, TaskHandle_t* handle, int core) {
+    SimTask* task = new SimTask();
+    task->entry = entry;
+    task->param = param;
+    task->name = name;
+    tasks.emplace_back(task);
+    task->thread = std::thread(taskThread, task);
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    runReadyTasks();  // Higher priority than loop() - starts at once
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    SimTask* task = handle != nullptr ? (SimTask*)handle : self;
+    if (task == self) {
+        task->cancelled = true;
+        throw SimTaskExit();
+    }
+    if (!task->finished) {
+        task->cancelled = true;
+        resumeTask(task);
+    }
+    task->thread.join();
+    for (size_t i = 0; i < tasks.size(); i++) {
+        if (tasks[i].get() == task) {
+            tasks.erase(tasks.begin() + i);
+            break;
+        }
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (!simInTask()) {
+        simElapseUs((uint64_t)ticks * 1000);
+        return;
+    }
+    self->wakeUs = nowUs + (uint64_t)ticks * 1000;
+    blockTask();
+    self->wakeUs = SIM_NO_WAKE;
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t ticks) {
+    *previousWake += ticks;
+    uint64_t wakeUs = (uint64_t)*previousWake * 1000;
+    if (wakeUs <= nowUs) {
+        return;
+    }
+    if (!simInTask()) {
+        simElapseUntilUs(wakeUs);
+        return;
+    }
+    self->wakeUs = wakeUs;
+    blockTask();
+    self->wakeUs = SIM_NO_WAKE;
+}
+
+TickType_t xTaskGetTickCount() {
+    return nowUs / 1000;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    SimTask* task = self;
+    if (task->notifications == 0 && ticksToWait != 0) {
+        task->waitingNotify = true;
+        task->wakeUs = ticksToWait == portMAX_DELAY ? SIM_NO_WAKE : nowUs + (uint64_t)ticksToWait * 1000;
+        blockTask();
+        task->waitingNotify = false;
+        task->wakeUs = SIM_NO_WAKE;
+    }
+    uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clearOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+void xTaskNotifyGive(TaskHandle_t handle) {
+    if (handle == nullptr) {
+        return;
+    }
+    ((SimTask*)handle)->notifications++;
+    runReadyTasks();
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t handle, BaseType_t* higherPriorityTaskWoken) {
+    if (handle == nullptr) {
+        return;
+    }
+    ((SimTask*)handle)->notifications++;
+    if (higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+// Light sleep: nothing runs until the timer or a high level on the wake pin
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs) {
+    sleepTimerUs = timeUs;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+    gpioWakeEnabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio, gpio_int_type_t type) {
+    gpioWakePin = gpio;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio) {
+    if (gpioWakePin == gpio) {
+        gpioWakePin = -1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start() {
+    uint64_t start = nowUs;
+    uint64_t deadline = sleepTimerUs > 0 ? nowUs + sleepTimerUs : SIM_NO_WAKE;
+    sleeping = true;
+    simElapseUntil(deadline, [] { return gpioWakeEnabled && gpioWakePin >= 0 && pin(gpioWakePin).level; });
+    sleeping = false;
+    sleptUs += nowUs - start;
+    sleeps++;
+    return ESP_OK;
+}
+
+uint64_t simLightSleepUs() {
+    return sleptUs;
+}
+
+uint32_t simLightSleeps() {
+    return sleeps;
+}
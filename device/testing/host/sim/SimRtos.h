@@ -0,0 +1,53 @@
+#ifndef SIM_RTOS_H
+#define SIM_RTOS_H
+
+#include <Arduino.h>
+#include <functional>
+
+// Virtual time, GPIO and a cooperative FreeRTOS stand-in
+// Exactly one context runs at a time: the test thread, which plays loop(), or
+// one task on its own thread. Time moves only when code waits or spends it -
+// delay(), delayMicroseconds(), a bus transfer, light sleep, simElapseUs() -
+// and event sources (simulated devices) act at their event times on the way.
+// A task made ready by an event, a notification or its wake time runs before
+// the test thread continues, as it would at a higher priority than loop().
+// Task code is never interrupted, so tasks see no preemption by each other.
+
+#define SIM_LOOP_CONTEXT nullptr
+
+// Anything that acts on its own schedule (a sensor's sample clock)
+class SimEventSource {
+public:
+    virtual ~SimEventSource() {}
+    virtual uint64_t nextEventUs() const = 0;   // UINT64_MAX when idle
+    virtual void runEvent(uint64_t nowUs) = 0;
+};
+
+void simAddEventSource(SimEventSource* source);
+void simRemoveEventSource(SimEventSource* source);
+
+// Time
+uint64_t simNowUs();
+void simElapseUs(uint64_t us);                  // Spend time in the calling context
+void simElapseUntilUs(uint64_t timeUs);
+bool simElapseUntil(uint64_t deadlineUs, const std::function<bool()>& wake);  // true if wake() ended it
+
+// Scheduling
+bool simInTask();                               // Called from a task rather than loop()
+void simSetTasksStarved(bool starved);          // Tasks get no CPU (a long job above their priority)
+uint32_t simTaskCount();
+void simSetIsrLatencyUs(uint32_t minUs, uint32_t maxUs);   // Edge to ISR entry, uniformly drawn
+
+// GPIO
+// Inputs driven by the simulation; an edge runs the ISR attached to the pin.
+void simSetPinLevel(uint8_t pin, bool high);
+bool simPinLevel(uint8_t pin);
+void simSetPinReader(uint8_t pin, std::function<int()> reader);       // digitalRead() override
+void simSetPinWriter(uint8_t pin, std::function<void(uint8_t)> writer);  // digitalWrite() observer
+bool simIsInterruptAttached(uint8_t pin);
+
+// Light sleep bookkeeping
+uint64_t simLightSleepUs();
+uint32_t simLightSleeps();
+
+#endif
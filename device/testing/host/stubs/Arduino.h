@@ -0,0 +1,118 @@
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+// Host stand-in for the ESP32 Arduino core
+// Only what the sketch uses. Time is virtual and GPIO, interrupts and the
+// FreeRTOS calls are served by the simulation in sim/SimRtos.cpp.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+
+#define ARDUINO 10819
+#define ESP32 1
+
+#define HEX 16
+#define DEC 10
+
+#define INPUT             0x01
+#define OUTPUT            0x03
+#define INPUT_PULLUP      0x05
+#define OUTPUT_OPEN_DRAIN 0x13
+#define LOW               0x0
+#define HIGH              0x1
+#define RISING            0x01
+#define FALLING           0x02
+#define CHANGE            0x03
+
+#define IRAM_ATTR
+
+using std::min;
+using std::max;
+
+template <class T>
+T constrain(T value, T low, T high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s ? s : "") {}
+    String(const std::string& s) : std::string(s) {}
+    String(int value) : std::string(std::to_string(value)) {}
+    String(unsigned int value) : std::string(std::to_string(value)) {}
+    String(long value) : std::string(std::to_string(value)) {}
+    String(unsigned long value) : std::string(std::to_string(value)) {}
+    unsigned int length() const { return size(); }
+};
+
+// Serial output is discarded; tests report through stdout themselves
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    void flush() {}
+    template <class T> size_t print(const T&) { return 0; }
+    template <class T> size_t print(const T&, int) { return 0; }
+    template <class T> size_t println(const T&) { return 0; }
+    template <class T> size_t println(const T&, int) { return 0; }
+    size_t println() { return 0; }
+    size_t printf(const char*, ...) { return 0; }
+};
+extern HardwareSerial Serial;
+
+// Virtual time (sim/SimRtos.cpp)
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+int64_t esp_timer_get_time();
+
+// GPIO and interrupts
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+// Critical sections: only one simulated context ever runs at a time
+typedef struct {
+    uint32_t owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+
+// FreeRTOS (1 ms tick)
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stackDepth, void* param,
+                                   unsigned int priority, TaskHandle_t* handle, int core);
+void vTaskDelete(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t ticks);
+TickType_t xTaskGetTickCount();
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+void xTaskNotifyGive(TaskHandle_t handle);
+void vTaskNotifyGiveFromISR(TaskHandle_t handle, BaseType_t* higherPriorityTaskWoken);
+
+#endif
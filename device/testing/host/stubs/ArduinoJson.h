@@ -0,0 +1,6 @@
+#ifndef ARDUINO_JSON_STUB_H
+#define ARDUINO_JSON_STUB_H
+
+// Host stand-in: included through BluetoothHandler.h, which declares no JSON types
+
+#endif
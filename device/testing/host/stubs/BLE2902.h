@@ -0,0 +1,6 @@
+#ifndef BLE2902_STUB_H
+#define BLE2902_STUB_H
+
+#include <BLEDevice.h>
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef BLE_DEVICE_STUB_H
+#define BLE_DEVICE_STUB_H
+
+// Host stand-in: BluetoothHandler.h only needs the type names; the BLE code
+// itself is not built for the host tests
+class BLECharacteristic;
+
+#endif
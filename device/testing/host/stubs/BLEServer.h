@@ -0,0 +1,6 @@
+#ifndef BLESERVER_STUB_H
+#define BLESERVER_STUB_H
+
+#include <BLEDevice.h>
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef BLEUTILS_STUB_H
+#define BLEUTILS_STUB_H
+
+#include <BLEDevice.h>
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef I2CDEV_STUB_H
+#define I2CDEV_STUB_H
+
+// Host stand-in for I2Cdevlib's register access
+// Same signatures and return conventions as the library (byte count or -1 /
+// success flag). Transfers go to the simulated bus in sim/SimMpu6050.cpp,
+// which charges their duration on the wire to virtual time.
+
+#include <Arduino.h>
+
+class I2Cdev {
+public:
+    static int8_t readBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t* data,
+                          uint16_t timeout = I2Cdev::readTimeout, void* wireObj = nullptr);
+    static int8_t readBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8_t length, uint8_t* data,
+                           uint16_t timeout = I2Cdev::readTimeout, void* wireObj = nullptr);
+    static int8_t readByte(uint8_t devAddr, uint8_t regAddr, uint8_t* data,
+                           uint16_t timeout = I2Cdev::readTimeout, void* wireObj = nullptr);
+    static int8_t readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data,
+                            uint16_t timeout = I2Cdev::readTimeout, void* wireObj = nullptr);
+
+    static bool writeBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t data, void* wireObj = nullptr);
+    static bool writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8_t length, uint8_t data,
+                          void* wireObj = nullptr);
+    static bool writeByte(uint8_t devAddr, uint8_t regAddr, uint8_t data, void* wireObj = nullptr);
+    static bool writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data, void* wireObj = nullptr);
+
+    static uint16_t readTimeout;
+};
+
+#endif
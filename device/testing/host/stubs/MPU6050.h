@@ -0,0 +1,159 @@
+#ifndef MPU6050_STUB_H
+#define MPU6050_STUB_H
+
+// Host stand-in for the Electronic Cats MPU6050 library
+// The methods the sketch calls, written on I2Cdev register accesses the way
+// the library does them, so the simulated sensor sees the real register
+// traffic. Register names and bit positions follow the library header.
+
+#include "I2Cdev.h"
+
+#define MPU6050_ADDRESS_AD0_LOW     0x68
+#define MPU6050_ADDRESS_AD0_HIGH    0x69
+#define MPU6050_DEFAULT_ADDRESS     MPU6050_ADDRESS_AD0_LOW
+
+#define MPU6050_RA_SELF_TEST_X      0x0D
+#define MPU6050_RA_SELF_TEST_Y      0x0E
+#define MPU6050_RA_SELF_TEST_Z      0x0F
+#define MPU6050_RA_SELF_TEST_A      0x10
+#define MPU6050_RA_SMPLRT_DIV       0x19
+#define MPU6050_RA_CONFIG           0x1A
+#define MPU6050_RA_GYRO_CONFIG      0x1B
+#define MPU6050_RA_ACCEL_CONFIG     0x1C
+#define MPU6050_RA_MOT_THR          0x1F
+#define MPU6050_RA_MOT_DUR          0x20
+#define MPU6050_RA_FIFO_EN          0x23
+#define MPU6050_RA_INT_PIN_CFG      0x37
+#define MPU6050_RA_INT_ENABLE       0x38
+#define MPU6050_RA_INT_STATUS       0x3A
+#define MPU6050_RA_ACCEL_XOUT_H     0x3B
+#define MPU6050_RA_TEMP_OUT_H       0x41
+#define MPU6050_RA_GYRO_XOUT_H      0x43
+#define MPU6050_RA_GYRO_ZOUT_L      0x48
+#define MPU6050_RA_USER_CTRL        0x6A
+#define MPU6050_RA_PWR_MGMT_1       0x6B
+#define MPU6050_RA_PWR_MGMT_2       0x6C
+#define MPU6050_RA_FIFO_COUNTH      0x72
+#define MPU6050_RA_FIFO_COUNTL      0x73
+#define MPU6050_RA_FIFO_R_W         0x74
+#define MPU6050_RA_WHO_AM_I         0x75
+
+#define MPU6050_CFG_DLPF_CFG_BIT    2
+#define MPU6050_CFG_DLPF_CFG_LENGTH 3
+#define MPU6050_GCONFIG_FS_SEL_BIT      4
+#define MPU6050_GCONFIG_FS_SEL_LENGTH   2
+#define MPU6050_ACONFIG_AFS_SEL_BIT     4
+#define MPU6050_ACONFIG_AFS_SEL_LENGTH  2
+#define MPU6050_ACONFIG_ACCEL_HPF_BIT   2
+#define MPU6050_ACONFIG_ACCEL_HPF_LENGTH 3
+
+#define MPU6050_TEMP_FIFO_EN_BIT    7
+#define MPU6050_XG_FIFO_EN_BIT      6
+#define MPU6050_YG_FIFO_EN_BIT      5
+#define MPU6050_ZG_FIFO_EN_BIT      4
+#define MPU6050_ACCEL_FIFO_EN_BIT   3
+
+#define MPU6050_INTCFG_INT_LEVEL_BIT     7
+#define MPU6050_INTCFG_INT_OPEN_BIT      6
+#define MPU6050_INTCFG_LATCH_INT_EN_BIT  5
+#define MPU6050_INTCFG_INT_RD_CLEAR_BIT  4
+
+#define MPU6050_INTERRUPT_MOT_BIT        6
+#define MPU6050_INTERRUPT_FIFO_OFLOW_BIT 4
+#define MPU6050_INTERRUPT_DATA_RDY_BIT   0
+
+#define MPU6050_USERCTRL_FIFO_EN_BIT     6
+#define MPU6050_USERCTRL_FIFO_RESET_BIT  2
+
+#define MPU6050_PWR1_DEVICE_RESET_BIT    7
+#define MPU6050_PWR1_SLEEP_BIT           6
+#define MPU6050_PWR1_CYCLE_BIT           5
+#define MPU6050_PWR1_TEMP_DIS_BIT        3
+#define MPU6050_PWR1_CLKSEL_BIT          2
+#define MPU6050_PWR1_CLKSEL_LENGTH       3
+
+#define MPU6050_PWR2_LP_WAKE_CTRL_BIT    7
+#define MPU6050_PWR2_LP_WAKE_CTRL_LENGTH 2
+#define MPU6050_PWR2_STBY_XG_BIT         2
+#define MPU6050_PWR2_STBY_YG_BIT         1
+#define MPU6050_PWR2_STBY_ZG_BIT         0
+
+#define MPU6050_WHO_AM_I_BIT        6
+#define MPU6050_WHO_AM_I_LENGTH     6
+
+#define MPU6050_CLOCK_PLL_XGYRO     0x01
+
+#define MPU6050_GYRO_FS_250         0x00
+#define MPU6050_GYRO_FS_500         0x01
+#define MPU6050_GYRO_FS_1000        0x02
+#define MPU6050_GYRO_FS_2000        0x03
+
+#define MPU6050_ACCEL_FS_2          0x00
+#define MPU6050_ACCEL_FS_4          0x01
+#define MPU6050_ACCEL_FS_8          0x02
+#define MPU6050_ACCEL_FS_16         0x03
+
+#define MPU6050_DLPF_BW_256         0x00
+#define MPU6050_DLPF_BW_188         0x01
+#define MPU6050_DLPF_BW_98          0x02
+#define MPU6050_DLPF_BW_42          0x03
+#define MPU6050_DLPF_BW_20          0x04
+#define MPU6050_DLPF_BW_10          0x05
+#define MPU6050_DLPF_BW_5           0x06
+
+#define MPU6050_DHPF_RESET          0x00
+#define MPU6050_DHPF_5              0x01
+#define MPU6050_DHPF_HOLD           0x07
+
+#define MPU6050_WAKE_FREQ_1P25      0x0
+#define MPU6050_WAKE_FREQ_5         0x1
+#define MPU6050_WAKE_FREQ_20        0x2
+#define MPU6050_WAKE_FREQ_40        0x3
+
+class MPU6050 {
+public:
+    explicit MPU6050(uint8_t address = MPU6050_DEFAULT_ADDRESS) : devAddr(address) {}
+
+    void initialize();
+    bool testConnection();
+    uint8_t getDeviceID();
+
+    void setRate(uint8_t rate);
+    void setDLPFMode(uint8_t mode);
+    void setDHPFMode(uint8_t mode);
+    void setFullScaleGyroRange(uint8_t range);
+    void setFullScaleAccelRange(uint8_t range);
+    void setMotionDetectionThreshold(uint8_t threshold);
+    void setMotionDetectionDuration(uint8_t duration);
+
+    void setTempFIFOEnabled(bool enabled);
+    void setXGyroFIFOEnabled(bool enabled);
+    void setYGyroFIFOEnabled(bool enabled);
+    void setZGyroFIFOEnabled(bool enabled);
+    void setAccelFIFOEnabled(bool enabled);
+    void setFIFOEnabled(bool enabled);
+    void resetFIFO();
+
+    void setInterruptMode(bool mode);
+    void setInterruptDrive(bool drive);
+    void setInterruptLatch(bool latch);
+    void setInterruptLatchClear(bool clear);
+    void setIntMotionEnabled(bool enabled);
+    void setIntDataReadyEnabled(bool enabled);
+    uint8_t getIntStatus();
+
+    void setClockSource(uint8_t source);
+    void setSleepEnabled(bool enabled);
+    void setWakeCycleEnabled(bool enabled);
+    void setTempSensorEnabled(bool enabled);
+    void setWakeFrequency(uint8_t frequency);
+    void setStandbyXGyroEnabled(bool enabled);
+    void setStandbyYGyroEnabled(bool enabled);
+    void setStandbyZGyroEnabled(bool enabled);
+
+private:
+    uint8_t devAddr;
+    uint8_t buffer[14];
+};
+
+#endif
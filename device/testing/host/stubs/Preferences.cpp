@@ -0,0 +1,65 @@
+#include "Preferences.h"
+#include <map>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t>> PreferencesSpace;
+static std::map<std::string, PreferencesSpace> store;
+
+bool Preferences::begin(const char* name, bool readOnlyMode) {
+    space = name;
+    open = true;
+    readOnly = readOnlyMode;
+    return true;
+}
+
+void Preferences::end() {
+    open = false;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (!open || readOnly) {
+        return 0;
+    }
+    const uint8_t* bytes = (const uint8_t*)value;
+    store[space][key].assign(bytes, bytes + length);
+    return length;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    if (!open || !isKey(key)) {
+        return 0;
+    }
+    const std::vector<uint8_t>& value = store[space][key];
+    if (value.size() > maxLength) {
+        return 0;
+    }
+    memcpy(buffer, value.data(), value.size());
+    return value.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    return open && isKey(key) ? store[space][key].size() : 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    return open && store.count(space) && store[space].count(key);
+}
+
+bool Preferences::remove(const char* key) {
+    if (!open || readOnly) {
+        return false;
+    }
+    return store[space].erase(key) > 0;
+}
+
+bool Preferences::clear() {
+    if (!open || readOnly) {
+        return false;
+    }
+    store[space].clear();
+    return true;
+}
+
+void clearPreferencesStore() {
+    store.clear();
+}
@@ -0,0 +1,31 @@
+#ifndef PREFERENCES_STUB_H
+#define PREFERENCES_STUB_H
+
+// Host stand-in for the ESP32 Preferences (NVS) library
+// Namespaces live in memory for the life of the test process, so a test can
+// store coefficients, "reboot" by reloading, and find them again.
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+
+    size_t putBytes(const char* key, const void* value, size_t length);
+    size_t getBytes(const char* key, void* buffer, size_t maxLength);
+    size_t getBytesLength(const char* key);
+    bool isKey(const char* key);
+    bool remove(const char* key);
+    bool clear();
+
+private:
+    std::string space;
+    bool open = false;
+    bool readOnly = false;
+};
+
+// Drop every stored namespace (factory-fresh flash)
+void clearPreferencesStore();
+
+#endif
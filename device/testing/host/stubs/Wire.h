@@ -0,0 +1,29 @@
+#ifndef WIRE_STUB_H
+#define WIRE_STUB_H
+
+// Host stand-in for the ESP32 Wire library
+// Keeps the bus configuration; transfers go through I2Cdev to the simulated
+// bus, which times them at the clock set here (sim/SimMpu6050.cpp).
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    bool begin(int sda, int scl, uint32_t frequency = 0);
+    bool end();
+    bool setClock(uint32_t frequency);
+    void setTimeOut(uint16_t timeoutMs);
+
+    uint32_t getClock() const { return clockHz; }
+    uint16_t getTimeOut() const { return timeoutMs; }
+    bool isStarted() const { return started; }
+
+private:
+    bool started = false;
+    uint32_t clockHz = 100000;
+    uint16_t timeoutMs = 50;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef ESP_SLEEP_STUB_H
+#define ESP_SLEEP_STUB_H
+
+// Host stand-in for ESP-IDF light sleep; sleeping lets virtual time run until
+// the timer or a GPIO wake-up (sim/SimRtos.cpp)
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs);
+esp_err_t esp_sleep_enable_gpio_wakeup();
+esp_err_t esp_light_sleep_start();
+
+#endif
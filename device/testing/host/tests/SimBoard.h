@@ -0,0 +1,57 @@
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+#include "SimMpu6050.h"
+#include "MPU6050Handler.h"
+#include <memory>
+#include <vector>
+
+// The Sentry sensor wiring: primary MPU6050 at 0x68 with INT on MPU_INT_PIN,
+// optionally a second one at 0x69 whose INT is not connected, and the bus
+// on MPU_SDA_PIN / MPU_SCL_PIN
+struct SimBoard {
+    SimMpu6050 primary;
+    std::unique_ptr<SimMpu6050> secondary;
+
+    explicit SimBoard(bool intWired = true, bool secondImu = false)
+        : primary(IMU_PRIMARY_ADDRESS, intWired ? MPU_INT_PIN : -1) {
+        if (secondImu) {
+            secondary.reset(new SimMpu6050(IMU_SECONDARY_ADDRESS));
+        }
+        SimI2CBus::instance().wirePins(MPU_SDA_PIN, MPU_SCL_PIN);
+    }
+};
+
+// Make every sample carry its index n (modulo SIM_SAMPLE_INDEX_WRAP):
+// ax = gx = temperature = n and ay = -n in raw counts at the default ranges
+#define SIM_SAMPLE_INDEX_WRAP 8192
+
+inline void numberSamples(SimMpu6050& imu) {
+    imu.setMotion([&imu](uint64_t timeUs) {
+        float n = imu.samplesTaken() % SIM_SAMPLE_INDEX_WRAP;
+        return SimMotion{{n / 16384.0f, -n / 16384.0f, 1.0f}, {n / 16.4f, 0.0f, 0.0f}, 36.53f + n / 340.0f};
+    });
+}
+
+// True time at which the numbered sample with this ax was taken (the latest
+// one carrying that index)
+inline uint64_t numberedSampleTime(const SimMpu6050& imu, int16_t ax) {
+    const std::vector<uint64_t>& times = imu.sampleTimes();
+    size_t n = times.size() - 1;
+    while (n % SIM_SAMPLE_INDEX_WRAP != (size_t)ax) {
+        n--;
+    }
+    return times[n];
+}
+
+// Everything waiting in the sample ring
+inline std::vector<MotionSample> popAllSamples() {
+    std::vector<MotionSample> samples;
+    MotionSample sample;
+    while (popSample(sample)) {
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+#endif
@@ -0,0 +1,378 @@
+// Bulk transfer over a loopback stand-in for the BLE notify link: framing,
+// sequence and CRC as a client checks them, the credit window, timeout,
+// owner checks and throughput in virtual time; and the pre-crash recorder
+// read out through it
+#include "HostTest.h"
+#include "BulkTransfer.h"
+#include "MotionRecorder.h"
+#include "PacketCodec.h"
+#include "SimRtos.h"
+#include <deque>
+#include <random>
+#include <vector>
+
+#define OWNER_ID       1
+#define OTHER_ID       2
+#define LOOP_PASS_US   10000      // loop() runs serviceBulkTransfer() this often
+
+typedef std::vector<uint8_t> Packet;
+
+// Notifications queue in the stack and go out a few per connection event;
+// the client's control writes arrive on the next event
+struct LoopbackLink {
+    uint16_t mtu = 247;
+    uint32_t intervalUs = 15000;
+    uint32_t packetsPerEvent = 6;
+    size_t queueDepth = 12;        // send() fails (congested) beyond this
+    bool connected = true;
+    std::deque<Packet> toClient;
+    std::deque<Packet> toDevice;
+    uint32_t congested = 0;
+};
+
+static uint16_t linkMaxPayload(void* ctx) {
+    LoopbackLink* link = (LoopbackLink*)ctx;
+    return link->connected ? link->mtu - 3 : 0;
+}
+
+static bool linkSend(void* ctx, const uint8_t* data, size_t length) {
+    LoopbackLink* link = (LoopbackLink*)ctx;
+    CHECK_LE(length, link->mtu - 3);
+    if (!link->connected || link->toClient.size() >= link->queueDepth) {
+        link->congested++;
+        return false;
+    }
+    link->toClient.push_back(Packet(data, data + length));
+    return true;
+}
+
+static BulkTransport loopbackTransport(LoopbackLink& link) {
+    BulkTransport transport;
+    transport.maxPayload = linkMaxPayload;
+    transport.send = linkSend;
+    transport.ctx = &link;
+    transport.owner = OWNER_ID;
+    return transport;
+}
+
+// Receiver as a phone app would write it: checks every packet and returns
+// one credit per DATA packet consumed, in batches of grantBatch; startGrant
+// widens the window beyond BULK_INITIAL_CREDITS on START
+struct BulkClient {
+    uint16_t grantBatch = 4;
+    uint16_t startGrant = 0;
+    bool granting = true;
+    uint8_t transferId = 0;
+    uint32_t total = 0;
+    uint16_t payloadSize = 0;
+    Packet data;
+    uint16_t nextSeq = 0;
+    bool inOrder = true;
+    bool ended = false;
+    uint16_t endCrc = 0;
+    uint32_t endDurationMs = 0;
+    uint8_t abortReason = 0;
+    uint32_t unconsumed = 0;       // Consumed packets not yet credited back
+    uint32_t dataPackets = 0;
+    uint32_t creditsGiven = BULK_INITIAL_CREDITS;
+    uint64_t startUs = 0;
+    uint64_t endUs = 0;
+
+    // Payload bytes per second as the client sees them, START to END
+    double throughput() const {
+        return endUs > startUs ? data.size() * 1e6 / (endUs - startUs) : 0.0;
+    }
+
+    void receive(const Packet& p, LoopbackLink& link) {
+        switch (p[0]) {
+            case BULK_PKT_START:
+                CHECK_EQ(p.size(), 8);
+                transferId = p[1];
+                total = getLE32(&p[2]);
+                payloadSize = getLE16(&p[6]);
+                startUs = simNowUs();
+                if (startGrant > 0) {
+                    grant(link, startGrant);
+                }
+                break;
+            case BULK_PKT_DATA:
+                CHECK_EQ(p[1], transferId);
+                CHECK_LE(p.size() - BULK_DATA_HEADER_SIZE, payloadSize);
+                inOrder = inOrder && getLE16(&p[2]) == nextSeq;
+                nextSeq++;
+                dataPackets++;
+                data.insert(data.end(), p.begin() + BULK_DATA_HEADER_SIZE, p.end());
+                // The device must never run ahead of the credits it was given
+                CHECK_LE(dataPackets, creditsGiven);
+                if (granting && ++unconsumed >= grantBatch) {
+                    grant(link, unconsumed);
+                    unconsumed = 0;
+                }
+                break;
+            case BULK_PKT_END:
+                CHECK_EQ(p.size(), 12);
+                CHECK_EQ(getLE32(&p[2]), total);
+                endCrc = getLE16(&p[6]);
+                endDurationMs = getLE32(&p[8]);
+                endUs = simNowUs();
+                ended = true;
+                break;
+            case BULK_PKT_ABORT:
+                CHECK_EQ(p.size(), 3);
+                abortReason = p[2];
+                break;
+        }
+    }
+
+    void grant(LoopbackLink& link, uint16_t credits) {
+        uint8_t control[3] = {BULK_CTRL_CREDITS};
+        putLE16(&control[1], credits);
+        link.toDevice.push_back(Packet(control, control + 3));
+        creditsGiven += credits;
+    }
+};
+
+// One connection event: the client's writes reach the device, then queued
+// notifications reach the client
+static void connectionEvent(LoopbackLink& link, BulkClient& client) {
+    while (!link.toDevice.empty()) {
+        Packet p = link.toDevice.front();
+        link.toDevice.pop_front();
+        handleBulkControl(OWNER_ID, p.data(), p.size());
+    }
+    for (uint32_t i = 0; i < link.packetsPerEvent && !link.toClient.empty(); i++) {
+        Packet p = link.toClient.front();
+        link.toClient.pop_front();
+        client.receive(p, link);
+    }
+}
+
+// loop() passes and connection events until the transfer is over and the
+// link has drained, or until limitUs
+static void runLink(LoopbackLink& link, BulkClient& client, uint64_t limitUs) {
+    uint64_t nextEventUs = simNowUs() + link.intervalUs;
+    uint64_t nextPassUs = simNowUs();
+    while (simNowUs() < limitUs && (isBulkTransferActive() || !link.toClient.empty())) {
+        if (nextPassUs <= nextEventUs) {
+            simElapseUntilUs(nextPassUs);
+            serviceBulkTransfer();
+            nextPassUs += LOOP_PASS_US;
+        } else {
+            simElapseUntilUs(nextEventUs);
+            connectionEvent(link, client);
+            nextEventUs += link.intervalUs;
+        }
+    }
+}
+
+static size_t readBuffer(void* ctx, uint32_t offset, uint8_t* out, size_t length) {
+    const Packet* buffer = (const Packet*)ctx;
+    memcpy(out, buffer->data() + offset, length);
+    return length;
+}
+
+static Packet randomPayload(size_t length) {
+    std::mt19937 rng(7);
+    Packet payload(length);
+    for (uint8_t& b : payload) {
+        b = rng();
+    }
+    return payload;
+}
+
+// CRC-16/CCITT-FALSE check value, and a CRC continued across buffers
+HOST_TEST(bulk, packet_codec) {
+    const uint8_t check[] = "123456789";
+    CHECK_EQ(calculateCRC16(check, 9), 0x29B1);
+    CHECK_EQ(calculateCRC16(check + 4, 5, calculateCRC16(check, 4)), 0x29B1);
+    uint8_t buf[8];
+    putLE32(buf, 0x12345678);
+    CHECK_EQ(buf[0], 0x78);
+    CHECK_EQ(buf[3], 0x12);
+    CHECK_EQ(getLE32(buf), 0x12345678);
+    putLE64(buf, 0x0102030405060708ULL);
+    CHECK_EQ(buf[0], 0x08);
+    CHECK_EQ(buf[7], 0x01);
+    CHECK_EQ(getLE16(&buf[6]), 0x0102);
+}
+
+// A payload that is not a whole number of packets arrives complete, in
+// sequence, with the CRC in END matching the data
+HOST_TEST(bulk, delivers_intact) {
+    LoopbackLink link;
+    BulkClient client;
+    Packet payload = randomPayload(100003);
+    CHECK(startBulkTransfer(loopbackTransport(link), readBuffer, &payload, 0, payload.size()));
+    CHECK(isBulkTransferActive());
+    runLink(link, client, 60e6);
+
+    const BulkTransferStats& stats = getBulkTransferStats();
+    printf("  %u bytes in %u packets of %u, %u ms, %.0f B/s received; %u credit stalls, %u congested sends\n",
+           stats.bytesSent, stats.packetsSent, client.payloadSize, client.endDurationMs, client.throughput(),
+           stats.creditStalls, link.congested);
+    CHECK(!isBulkTransferActive());
+    CHECK(stats.completed);
+    CHECK(client.ended);
+    CHECK(client.inOrder);
+    CHECK_EQ(client.payloadSize, link.mtu - 3 - BULK_DATA_HEADER_SIZE);
+    CHECK(client.data == payload);
+    CHECK_EQ(client.endCrc, calculateCRC16(payload.data(), payload.size()));
+    CHECK_EQ(stats.packetsSent, (payload.size() + client.payloadSize - 1) / client.payloadSize);
+}
+
+// Only the initial window goes out until the client grants more, and the
+// window never exceeds BULK_MAX_CREDITS however much is granted
+HOST_TEST(bulk, credit_window) {
+    LoopbackLink link;
+    link.queueDepth = 1000;
+    link.packetsPerEvent = 1000;
+    BulkClient client;
+    client.granting = false;
+    Packet payload = randomPayload(200000);
+    CHECK(startBulkTransfer(loopbackTransport(link), readBuffer, &payload, 0, payload.size()));
+    runLink(link, client, simNowUs() + 1000000);
+    CHECK_EQ(client.dataPackets, BULK_INITIAL_CREDITS);
+
+    client.grant(link, 1000);
+    runLink(link, client, simNowUs() + 1000000);
+    CHECK_EQ(client.dataPackets, BULK_INITIAL_CREDITS + BULK_MAX_CREDITS);
+    CHECK(isBulkTransferActive());
+    CHECK_GT(getBulkTransferStats().creditStalls, 0);
+}
+
+// A client that stops granting is dropped after BULK_CREDIT_TIMEOUT_MS
+HOST_TEST(bulk, credit_timeout) {
+    LoopbackLink link;
+    BulkClient client;
+    client.granting = false;
+    Packet payload = randomPayload(50000);
+    CHECK(startBulkTransfer(loopbackTransport(link), readBuffer, &payload, 0, payload.size()));
+    uint64_t startUs = simNowUs();
+    runLink(link, client, startUs + 2 * BULK_CREDIT_TIMEOUT_MS * 1000ULL);
+    double abortedAfterMs = (getBulkTransferStats().endTime - getBulkTransferStats().startTime);
+    printf("  aborted %.0f ms after the start\n", abortedAfterMs);
+    CHECK(!isBulkTransferActive());
+    CHECK_EQ(getBulkTransferStats().abortReason, BULK_ABORT_TIMEOUT);
+    CHECK_EQ(client.abortReason, BULK_ABORT_TIMEOUT);
+    CHECK_GE(abortedAfterMs, BULK_CREDIT_TIMEOUT_MS);
+    CHECK_LE(abortedAfterMs, BULK_CREDIT_TIMEOUT_MS + LOOP_PASS_US / 1000);
+}
+
+// Credits and aborts from a client other than the receiver are ignored
+HOST_TEST(bulk, control_from_owner_only) {
+    LoopbackLink link;
+    BulkClient client;
+    client.granting = false;
+    Packet payload = randomPayload(50000);
+    CHECK(startBulkTransfer(loopbackTransport(link), readBuffer, &payload, 0, payload.size()));
+    runLink(link, client, simNowUs() + 500000);
+    CHECK_EQ(client.dataPackets, BULK_INITIAL_CREDITS);
+
+    const uint8_t credits[3] = {BULK_CTRL_CREDITS, 20, 0};
+    const uint8_t abort[1] = {BULK_CTRL_ABORT};
+    handleBulkControl(OTHER_ID, credits, sizeof(credits));
+    handleBulkControl(OTHER_ID, abort, sizeof(abort));
+    runLink(link, client, simNowUs() + 500000);
+    CHECK(isBulkTransferActive());
+    CHECK_EQ(client.dataPackets, BULK_INITIAL_CREDITS);
+    CHECK_EQ(getBulkTransferStats().foreignControls, 2);
+
+    handleBulkControl(OWNER_ID, abort, sizeof(abort));
+    runLink(link, client, simNowUs() + 500000);
+    CHECK(!isBulkTransferActive());
+    CHECK_EQ(client.abortReason, BULK_ABORT_CLIENT);
+}
+
+// Losing the link ends the transfer without trying to send on it
+HOST_TEST(bulk, disconnect_aborts) {
+    LoopbackLink link;
+    BulkClient client;
+    Packet payload = randomPayload(50000);
+    CHECK(startBulkTransfer(loopbackTransport(link), readBuffer, &payload, 0, payload.size()));
+    runLink(link, client, simNowUs() + 100000);
+    link.connected = false;
+    link.toClient.clear();
+    serviceBulkTransfer();
+    CHECK(!isBulkTransferActive());
+    CHECK_EQ(getBulkTransferStats().abortReason, BULK_ABORT_DISCONNECTED);
+    CHECK(!startBulkTransfer(loopbackTransport(link), readBuffer, &payload, 0, payload.size()));
+}
+
+// Throughput against the link. Credits come back one connection event after
+// the packets they pay for, so a window of BULK_INITIAL_CREDITS caps a link
+// that carries more than half of that per event; a client that grants
+// startGrant more on START runs at the packets-per-event limit
+HOST_TEST(bulk, throughput) {
+    struct Case {
+        uint16_t mtu;
+        uint32_t intervalUs;
+        uint32_t packetsPerEvent;
+    };
+    for (const Case& c : {Case{23, 30000, 4}, Case{185, 30000, 4}, Case{247, 15000, 6}, Case{512, 7500, 6}}) {
+        LoopbackLink link;
+        link.mtu = c.mtu;
+        link.intervalUs = c.intervalUs;
+        link.packetsPerEvent = c.packetsPerEvent;
+        BulkClient client;
+        client.startGrant = 16;
+        Packet payload = randomPayload(24576);
+        CHECK(startBulkTransfer(loopbackTransport(link), readBuffer, &payload, 0, payload.size()));
+        runLink(link, client, simNowUs() + 600e6);
+        double linkLimit = (double)(min((uint16_t)BULK_MAX_PACKET_SIZE, (uint16_t)(c.mtu - 3)) -
+                                    BULK_DATA_HEADER_SIZE) * c.packetsPerEvent * 1e6 / c.intervalUs;
+        printf("  MTU %u, %.1f ms interval, %u packets/event: %.0f B/s received (link limit %.0f B/s), "
+               "%u congested sends\n", c.mtu, c.intervalUs / 1000.0, c.packetsPerEvent, client.throughput(),
+               linkLimit, link.congested);
+        CHECK(client.ended);
+        CHECK(client.data == payload);
+        CHECK_GE(client.throughput(), 0.9 * linkLimit);
+    }
+}
+
+static MotionSample numbered(uint32_t n) {
+    MotionSample s = {};
+    s.timestampUs = 5000ULL * n + 1;
+    s.ax = n;
+    s.gz = -(int16_t)n;
+    s.temperature = 1000 + n;
+    s.accelRange = n & 3;
+    s.flags = n % 7 == 0 ? SAMPLE_FLAG_GAP : 0;
+    return s;
+}
+
+// The recorder keeps the newest RECORDER_SAMPLES, stops at a freeze, and
+// its window reads back through a bulk transfer oldest first
+HOST_TEST(bulk, recorder_window) {
+    const uint32_t recorded = RECORDER_SAMPLES + 300;
+    for (uint32_t n = 0; n < recorded; n++) {
+        recordMotionSample(numbered(n));
+    }
+    freezeMotionRecorder();
+    recordMotionSample(numbered(recorded));
+    CHECK_EQ(getMotionRecorderBytes(), RECORDER_SAMPLES * RECORDER_RECORD_SIZE);
+
+    LoopbackLink link;
+    BulkClient client;
+    CHECK(startBulkTransfer(loopbackTransport(link), readMotionRecorder, nullptr, 0, getMotionRecorderBytes()));
+    runLink(link, client, 60e6);
+    CHECK(client.ended);
+    CHECK_EQ(client.data.size(), RECORDER_SAMPLES * RECORDER_RECORD_SIZE);
+    printf("  %u samples (%u bytes) in %u ms, %.0f B/s received\n", RECORDER_SAMPLES,
+           (unsigned)client.data.size(), client.endDurationMs, client.throughput());
+    for (uint32_t k = 0; k < RECORDER_SAMPLES; k++) {
+        const uint8_t* r = &client.data[k * RECORDER_RECORD_SIZE];
+        MotionSample expected = numbered(recorded - RECORDER_SAMPLES + k);
+        uint64_t timeUs = getLE32(r) | (uint64_t)getLE32(r + 4) << 32;
+        CHECK_EQ(timeUs, expected.timestampUs);
+        CHECK_EQ((int16_t)getLE16(r + 8), expected.ax);
+        CHECK_EQ((int16_t)getLE16(r + 18), expected.gz);
+        CHECK_EQ((int16_t)getLE16(r + 20), expected.temperature);
+        CHECK_EQ(r[22], expected.accelRange);
+        CHECK_EQ(r[23], expected.flags);
+    }
+
+    resumeMotionRecorder();
+    CHECK_EQ(getMotionRecorderBytes(), 0);
+    recordMotionSample(numbered(0));
+    CHECK_EQ(getMotionRecorderBytes(), RECORDER_RECORD_SIZE);
+}
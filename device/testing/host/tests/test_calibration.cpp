@@ -0,0 +1,179 @@
+// Calibration estimator on biased synthetic data, and the capture flow end to
+// end through the simulated sensor
+#include "HostTest.h"
+#include "SimBoard.h"
+#include "Calibration.h"
+#include <random>
+
+// Sensor errors: reading = true / scale + bias, so (reading - bias) * scale
+// gives back the true value
+static const float ACCEL_BIAS_G[3] = {0.05f, -0.03f, 0.08f};
+static const float ACCEL_SCALE[3] = {1.02f, 0.98f, 1.01f};
+static const float GYRO_BIAS_DPS[3] = {0.5f, -0.2f, 0.1f};
+#define NOISE_G    0.005f
+
+// Still, with gravity along +/- one axis, as the sensor reads it
+static SimMotionSource stillWithGravity(uint8_t axis, float sign) {
+    auto rng = std::make_shared<std::mt19937>(axis * 2 + (sign > 0));
+    return [rng, axis, sign](uint64_t timeUs) {
+        std::normal_distribution<float> noise(0.0f, NOISE_G);
+        SimMotion m = {{0, 0, 0}, {0, 0, 0}, 25.0f};
+        for (uint8_t i = 0; i < 3; i++) {
+            float trueG = i == axis ? sign : 0.0f;
+            m.accelG[i] = trueG / ACCEL_SCALE[i] + ACCEL_BIAS_G[i] + noise(*rng);
+            m.gyroDps[i] = GYRO_BIAS_DPS[i];
+        }
+        return m;
+    };
+}
+
+static CalibrationAccumulator capture(uint8_t axis, float sign, int samples, float extraNoiseG = 0.0f) {
+    SimMotionSource source = stillWithGravity(axis, sign);
+    std::mt19937 rng(7);
+    std::normal_distribution<float> shake(0.0f, extraNoiseG > 0 ? extraNoiseG : 1.0f);
+    CalibrationAccumulator acc;
+    resetCalibrationAccumulator(acc);
+    for (int k = 0; k < samples; k++) {
+        SimMotion m = source(0);
+        if (extraNoiseG > 0) {
+            m.accelG[0] += shake(rng);
+        }
+        accumulateCalibrationSample(acc, m.accelG, m.gyroDps);
+    }
+    return acc;
+}
+
+// One flat capture with the scale known recovers every bias
+HOST_TEST(calibration, bias_from_flat_capture) {
+    CalibrationAccumulator acc = capture(2, 1.0f, 600);
+    CalibrationCoefficients c;
+    CHECK(estimateBias(acc, ACCEL_SCALE, c) == nullptr);
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK_NEAR(c.accelBias[i], ACCEL_BIAS_G[i], 0.001);
+        CHECK_NEAR(c.gyroBias[i], GYRO_BIAS_DPS[i], 1e-4);
+        CHECK_EQ(c.accelScale[i], ACCEL_SCALE[i]);
+    }
+}
+
+// Upside down, the vertical axis is expected to read -1 g
+HOST_TEST(calibration, bias_upside_down) {
+    CalibrationAccumulator acc = capture(1, -1.0f, 600);
+    CalibrationCoefficients c;
+    CHECK(estimateBias(acc, ACCEL_SCALE, c) == nullptr);
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK_NEAR(c.accelBias[i], ACCEL_BIAS_G[i], 0.001);
+    }
+}
+
+// Six axis-up/axis-down means give bias and scale per axis
+HOST_TEST(calibration, six_position_bias_and_scale) {
+    float up[3], down[3];
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        up[axis] = capture(axis, 1.0f, 600).accelMean[axis];
+        down[axis] = capture(axis, -1.0f, 600).accelMean[axis];
+    }
+    CalibrationCoefficients c;
+    CHECK(estimateSixPosition(up, down, c) == nullptr);
+    for (uint8_t i = 0; i < 3; i++) {
+        printf("  axis %u: bias %.5f g (true %.5f), scale %.5f (true %.5f)\n", i, c.accelBias[i],
+               ACCEL_BIAS_G[i], c.accelScale[i], ACCEL_SCALE[i]);
+        CHECK_NEAR(c.accelBias[i], ACCEL_BIAS_G[i], 0.001);
+        CHECK_NEAR(c.accelScale[i], ACCEL_SCALE[i], 0.001);
+    }
+}
+
+HOST_TEST(calibration, rejects_bad_captures) {
+    CalibrationCoefficients c;
+    CHECK(estimateBias(capture(2, 1.0f, 5), ACCEL_SCALE, c) != nullptr);          // Too short
+    CHECK(estimateBias(capture(2, 1.0f, 600, 0.05f), ACCEL_SCALE, c) != nullptr);  // Moved
+
+    // Tilted 45 degrees: no axis is vertical, so bias and tilt can't be separated
+    CalibrationAccumulator tilted;
+    resetCalibrationAccumulator(tilted);
+    float accel[3] = {0.0f, 0.7071f, 0.7071f};
+    float gyro[3] = {0.0f, 0.0f, 0.0f};
+    for (int k = 0; k < 100; k++) {
+        accumulateCalibrationSample(tilted, accel, gyro);
+    }
+    CHECK(estimateBias(tilted, ACCEL_SCALE, c) != nullptr);
+
+    float up[3] = {1.0f, 1.0f, 1.0f};
+    float down[3] = {-1.6f, -1.0f, -1.0f};                                          // X scale 0.77
+    CHECK(estimateSixPosition(up, down, c) != nullptr);
+}
+
+// Run one capture on the live sample stream, as loop() does
+static void runCapture(uint8_t mode, uint32_t durationMs) {
+    CHECK(startCalibration(mode, durationMs));
+    while (getCalibrationStatus().state == CALIB_STATE_COLLECTING) {
+        simElapseUs(20000);
+        for (const MotionSample& s : popAllSamples()) {
+            feedCalibrationSample(s);
+        }
+        serviceCalibration();
+    }
+}
+
+// A flat capture from FIFO samples is stored, applied to the hot path and
+// restored at the next boot
+HOST_TEST(calibration, capture_through_sensor) {
+    SimBoard board;
+    board.primary.setMotion(stillWithGravity(2, 1.0f));
+    initMPU();
+    CHECK(initMPUFifo(200));
+    loadCalibration();
+    CHECK(!isCalibrated());
+
+    runCapture(CALIB_MODE_BIAS, 2000);
+    CHECK_EQ(getCalibrationStatus().state, CALIB_STATE_DONE);
+    CHECK_GE(getCalibrationStatus().samples, 390);
+    const CalibrationCoefficients& c = getCalibration();
+    CHECK(isCalibrated());
+    CHECK_NEAR(c.accelBias[0], ACCEL_BIAS_G[0], 0.001);
+    CHECK_NEAR(c.accelBias[1], ACCEL_BIAS_G[1], 0.001);
+    CHECK_NEAR(c.accelBias[2], 1.0f / ACCEL_SCALE[2] - 1.0f + ACCEL_BIAS_G[2], 0.001);  // Scale stays 1
+    CHECK_NEAR(c.gyroBias[0], GYRO_BIAS_DPS[0], 0.05);
+    CHECK_NEAR(c.temperatureC, 25.0, 0.01);
+
+    // Corrected samples read level and still
+    simElapseUs(100000);
+    double sum[3] = {0, 0, 0};
+    std::vector<MotionSample> samples = popAllSamples();
+    for (MotionSample& s : samples) {
+        applyCalibration(s);
+        sum[0] += accelToG(s.ax, s.accelRange);
+        sum[1] += accelToG(s.ay, s.accelRange);
+        sum[2] += accelToG(s.az, s.accelRange);
+        CHECK_LE(abs(s.gx), 1);
+    }
+    CHECK_NEAR(sum[0] / samples.size(), 0.0, 0.002);
+    CHECK_NEAR(sum[1] / samples.size(), 0.0, 0.002);
+    CHECK_NEAR(sum[2] / samples.size(), 1.0, 0.002);
+
+    loadCalibration();
+    CHECK(isCalibrated());
+    CHECK_EQ(getCalibration().accelBias[0], c.accelBias[0]);
+}
+
+// Six captures, one per face, complete a scale calibration
+HOST_TEST(calibration, six_position_through_sensor) {
+    SimBoard board;
+    initMPU();
+    CHECK(initMPUFifo(200));
+    loadCalibration();
+
+    for (uint8_t face = 0; face < 6; face++) {
+        board.primary.setMotion(stillWithGravity(face / 2, face % 2 ? -1.0f : 1.0f));
+        simElapseUs(50000);
+        popAllSamples();
+        runCapture(CALIB_MODE_POSITION, 2000);
+        CHECK_EQ(getCalibrationStatus().state, CALIB_STATE_DONE);
+        CHECK_EQ(isCalibrated(), face == 5);
+    }
+    const CalibrationCoefficients& c = getCalibration();
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK_NEAR(c.accelBias[i], ACCEL_BIAS_G[i], 0.001);
+        CHECK_NEAR(c.accelScale[i], ACCEL_SCALE[i], 0.002);
+        CHECK_NEAR(c.gyroBias[i], GYRO_BIAS_DPS[i], 0.05);
+    }
+}
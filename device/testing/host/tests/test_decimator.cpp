@@ -0,0 +1,151 @@
+// CIC stream decimator: exact DC gain at full scale, alias rejection and
+// passband droop against the sinc^3 response, delay, and host cost per input
+#include "HostTest.h"
+#include "Decimator.h"
+#include <chrono>
+#include <vector>
+
+// Peak output of a tone at toneHz through the decimator, relative to its
+// input amplitude, once settled
+static double toneGain(double inputHz, uint16_t ratio, double toneHz) {
+    Decimator d;
+    initDecimator(d, ratio);
+    const double amplitude = 8000.0;
+    int32_t in[DECIMATOR_CHANNELS] = {};
+    int32_t out[DECIMATOR_CHANNELS];
+    double peak = 0.0;
+    int outputs = 0;
+    for (long n = 0; outputs < 400; n++) {
+        in[0] = lround(amplitude * sin(2 * M_PI * toneHz * n / inputHz));
+        in[1] = lround(amplitude * cos(2 * M_PI * toneHz * n / inputHz));
+        if (updateDecimator(d, in, out)) {
+            // In-phase and quadrature together give the envelope, whatever
+            // the output sampling phase
+            peak = max(peak, sqrt((double)out[0] * out[0] + (double)out[1] * out[1]));
+            outputs++;
+        }
+    }
+    return peak / amplitude;
+}
+
+// sinc^3 response of a length-`ratio` CIC at toneHz
+static double cicGain(double inputHz, uint16_t ratio, double toneHz) {
+    double f = toneHz / inputHz;
+    double g = fabs(sin(M_PI * f * ratio) / (ratio * sin(M_PI * f)));
+    return g * g * g;
+}
+
+static double dB(double gain) {
+    return 20 * log10(max(gain, 1e-9));
+}
+
+// Constant input comes back exactly on every channel, including the ±16 g
+// extremes in ±2 g counts at the largest ratio
+HOST_TEST(decimator, exact_dc_at_full_scale) {
+    for (uint16_t ratio : {1, 2, 20, DECIMATOR_MAX_RATIO}) {
+        Decimator d;
+        initDecimator(d, ratio);
+        int32_t in[DECIMATOR_CHANNELS] = {262143, -262144, 16384, -1, 0, 1, 32767, -32768, 12345};
+        int32_t out[DECIMATOR_CHANNELS];
+        int outputs = 0;
+        for (int n = 0; n < ratio * 20; n++) {
+            if (updateDecimator(d, in, out)) {
+                outputs++;
+                for (uint8_t ch = 0; ch < DECIMATOR_CHANNELS; ch++) {
+                    CHECK_EQ(out[ch], in[ch]);
+                }
+            }
+        }
+        CHECK_EQ(outputs, 20 - (DECIMATOR_ORDER - 1));   // Withheld until settled
+    }
+}
+
+// Out of range ratios are clamped
+HOST_TEST(decimator, ratio_clamped) {
+    Decimator d;
+    initDecimator(d, 0);
+    CHECK_EQ(d.ratio, 1);
+    initDecimator(d, 1000);
+    CHECK_EQ(d.ratio, DECIMATOR_MAX_RATIO);
+}
+
+// 200 Hz in, 10 Hz out: a 95 Hz vibration that plain sample picking would
+// alias to 5 Hz is gone, and tones next to the output rate (where aliases
+// onto DC come from) are deep in the first null
+HOST_TEST(decimator, rejects_aliases) {
+    for (double toneHz : {95.0, 10.5, 19.0}) {
+        double gain = toneGain(200.0, 20, toneHz);
+        printf("  %.1f Hz at 200 Hz / 20: %.1f dB (sinc^3 %.1f dB)\n", toneHz, dB(gain),
+               dB(cicGain(200.0, 20, toneHz)));
+        CHECK_LE(dB(gain), -60.0);
+    }
+}
+
+// In band the response follows sinc^3: small droop well below the output
+// Nyquist, about -12 dB at it
+HOST_TEST(decimator, passband_droop) {
+    for (double toneHz : {0.5, 2.0, 5.0}) {
+        double gain = toneGain(200.0, 20, toneHz);
+        printf("  %.1f Hz at 200 Hz / 20: %.2f dB (sinc^3 %.2f dB)\n", toneHz, dB(gain),
+               dB(cicGain(200.0, 20, toneHz)));
+        CHECK_NEAR(gain, cicGain(200.0, 20, toneHz), 0.002);
+    }
+    CHECK_NEAR(dB(cicGain(200.0, 20, 5.0)), -11.7, 0.2);
+}
+
+// A step reaches half way after the group delay getDecimatorDelay() gives
+HOST_TEST(decimator, step_delay) {
+    const uint16_t ratio = 20;
+    Decimator d;
+    initDecimator(d, ratio);
+    int32_t in[DECIMATOR_CHANNELS] = {};
+    int32_t out[DECIMATOR_CHANNELS];
+    const int stepAt = 10 * ratio;
+    int previous = 0;
+    int previousAt = 0;
+    double crossing = -1.0;
+    for (int n = 0; n < 20 * ratio && crossing < 0; n++) {
+        in[0] = n >= stepAt ? 10000 : 0;
+        if (updateDecimator(d, in, out)) {
+            if (previous < 5000 && out[0] >= 5000) {
+                // Interpolate between the two outputs around the half-way point
+                crossing = previousAt + (double)(n - previousAt) * (5000 - previous) / (out[0] - previous);
+            }
+            previous = out[0];
+            previousAt = n;
+        }
+    }
+    printf("  step at input %d reaches 50%% at %.1f, predicted delay %.1f\n", stepAt, crossing,
+           getDecimatorDelay(d));
+    CHECK_NEAR(crossing - stepAt, getDecimatorDelay(d), 1.0);
+}
+
+// Host ns per input sample (wall clock, all DECIMATOR_CHANNELS); not a
+// prediction of ESP32 cost, where 64-bit adds take two instructions
+HOST_TEST(decimator, benchmark) {
+    for (uint16_t ratio : {4, 20, DECIMATOR_MAX_RATIO}) {
+        Decimator d;
+        initDecimator(d, ratio);
+        std::vector<int32_t> signal(4096 * DECIMATOR_CHANNELS);
+        for (size_t i = 0; i < signal.size(); i++) {
+            signal[i] = (int32_t)((i * 2654435761u) & 0xffff) - 32768;
+        }
+        const long inputs = 10000000;
+        int32_t out[DECIMATOR_CHANNELS];
+        volatile int32_t sink = 0;
+        long outputs = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (long n = 0; n < inputs; n++) {
+            if (updateDecimator(d, &signal[(n & 4095) * DECIMATOR_CHANNELS], out)) {
+                sink = out[0];
+                outputs++;
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        printf("  ratio %u: %.1f ns per input sample (%u channels)\n", ratio, ns / inputs, DECIMATOR_CHANNELS);
+        CHECK_EQ(outputs, inputs / ratio - (DECIMATOR_ORDER - 1));
+        int32_t last = sink;                   // unity gain keeps it within the input range
+        CHECK_GE(last, -32768);
+        CHECK_LT(last, 32768);
+    }
+}
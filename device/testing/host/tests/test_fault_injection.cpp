@@ -0,0 +1,196 @@
+// I2C fault handling: bounded retries, losing and re-initializing the sensor
+// with backoff, clocking out a stuck bus, and a sensor that appears late
+#include "HostTest.h"
+#include "SimBoard.h"
+#include <vector>
+
+// Virtual ms at which the sensor was lost, then each re-init attempt
+static std::vector<uint64_t> watchReinitAttempts(uint64_t durationMs) {
+    while (isMPU6050Connected()) {
+        simElapseUs(1000);
+    }
+    std::vector<uint64_t> attempts = {simNowUs() / 1000};
+    uint32_t seen = getI2CStats().reinitAttempts;
+    for (uint64_t ms = 0; ms < durationMs; ms += 10) {
+        simElapseUs(10000);
+        if (getI2CStats().reinitAttempts != seen) {
+            seen = getI2CStats().reinitAttempts;
+            attempts.push_back(simNowUs() / 1000);
+        }
+    }
+    return attempts;
+}
+
+// A single failed read is retried within the same call
+HOST_TEST(faults, transient_failure_is_retried) {
+    SimBoard board;
+    initMPU();
+    CHECK(isMPU6050Connected());
+    I2CStats before = getI2CStats();
+
+    board.primary.failTransfers(1);
+    MotionSample sample;
+    CHECK(readMotion(sample));
+    CHECK_EQ(getI2CStats().errors - before.errors, 1);
+    CHECK_EQ(getI2CStats().retries - before.retries, 1);
+    CHECK_EQ(getI2CStats().failures - before.failures, 0);
+    CHECK_EQ(sample.az, 16384);
+}
+
+// A device that stops answering costs at most MPU_I2C_MAX_RETRIES extra
+// attempts per read, and three failed reads in a row lose the sensor
+HOST_TEST(faults, retries_are_bounded) {
+    SimBoard board;
+    initMPU();
+    I2CStats before = getI2CStats();
+
+    board.primary.failTransfers(1000);
+    MotionSample sample;
+    uint64_t start = simNowUs();
+    CHECK(!readMotion(sample));
+    CHECK_LE(simNowUs() - start, (uint64_t)MPU_I2C_RETRY_BUDGET_US);
+    CHECK_EQ(getI2CStats().errors - before.errors, 1 + MPU_I2C_MAX_RETRIES);
+    CHECK_EQ(getI2CStats().failures - before.failures, 1);
+    CHECK(isMPU6050Connected());
+
+    CHECK(!readMotion(sample));
+    CHECK(!readMotion(sample));
+    CHECK(!isMPU6050Connected());
+    CHECK_EQ(getMPUStatus(), 0);
+}
+
+// Once lost, re-init attempts back off from 500 ms doubling to 30 s; the
+// drain task checks every MPU_FIFO_DRAIN_MS, so each is up to that late
+HOST_TEST(faults, reinit_backs_off) {
+    SimBoard board;
+    initMPU();
+    CHECK(initMPUFifo(200));
+    simElapseUs(100000);
+
+    board.primary.setPresent(false);
+    std::vector<uint64_t> attempts = watchReinitAttempts(130000);
+    CHECK(!isMPU6050Connected());
+    CHECK_GE(attempts.size(), 9);
+
+    uint32_t expected = MPU_REINIT_BACKOFF_MIN_MS;
+    for (size_t i = 1; i < attempts.size(); i++) {
+        uint64_t interval = attempts[i] - attempts[i - 1];
+        printf("  attempt %zu: +%llu ms\n", i, (unsigned long long)interval);
+        CHECK_GE(interval, expected);
+        CHECK_LE(interval, expected + MPU_FIFO_DRAIN_MS);
+        expected = min(expected * 2, (uint32_t)MPU_REINIT_BACKOFF_MAX_MS);
+    }
+    CHECK_EQ(expected, MPU_REINIT_BACKOFF_MAX_MS);
+    CHECK_EQ(getI2CStats().reinits, 0);
+}
+
+// Re-plugged, the sensor is re-initialized with its rate and FIFO setup, and
+// the first sample after the outage is flagged
+HOST_TEST(faults, replug_restores_acquisition) {
+    SimBoard board;
+    numberSamples(board.primary);
+    CHECK(setSamplingConfig(500, DLPF_AUTO));
+    initMPU();
+    CHECK(initMPUFifo(500));
+    simElapseUs(100000);
+    popAllSamples();
+
+    board.primary.setPresent(false);
+    simElapseUs(1000000);
+    CHECK(!isMPU6050Connected());
+    popAllSamples();
+    board.primary.setPresent(true);
+    CHECK_EQ(board.primary.registerValue(MPU6050_RA_SMPLRT_DIV), 0);   // Power-on reset
+
+    simElapseUs(3000000);
+    CHECK(isMPU6050Connected());
+    CHECK_EQ(getI2CStats().reinits, 1);
+    CHECK_EQ(board.primary.registerValue(MPU6050_RA_SMPLRT_DIV), 1);
+    CHECK_EQ(getAcquisitionMode(), ACQ_MODE_FIFO);
+
+    std::vector<MotionSample> samples = popAllSamples();
+    CHECK_GE(samples.size(), 100);
+    CHECK_EQ(samples[0].flags, SAMPLE_FLAG_GAP);
+    for (size_t i = 1; i < samples.size(); i++) {
+        CHECK_EQ(samples[i].flags, 0);
+        CHECK_EQ(samples[i].ax, samples[i - 1].ax + 1);
+    }
+    CHECK_EQ(getMPUStatus(), 2);
+}
+
+// A slave holding SDA low times out every transfer until SCL is clocked; the
+// recovery pulses release it and the sensor comes back
+HOST_TEST(faults, stuck_bus_is_clocked_free) {
+    SimBoard board;
+    initMPU();
+    CHECK(initMPUFifo(200));
+    simElapseUs(100000);
+
+    SimI2CBus::instance().holdSdaLow(5);
+    simElapseUs(200000);
+    CHECK(!isMPU6050Connected());
+    CHECK_GT(SimI2CBus::instance().stuckTransfers(), 0);
+
+    simElapseUs(2000000);
+    printf("  %u stuck transfers, %u bus recoveries, %u re-inits\n", SimI2CBus::instance().stuckTransfers(),
+           getI2CStats().busRecoveries, getI2CStats().reinits);
+    CHECK_GE(getI2CStats().busRecoveries, 1);
+    CHECK_EQ(getI2CStats().reinits, 1);
+    CHECK(isMPU6050Connected());
+    popAllSamples();
+    simElapseUs(100000);
+    CHECK_GE(getSampleCount(), 15);
+}
+
+// In interrupt mode a sensor that stops producing edges is noticed by the
+// sampling task's timeout and recovered once it answers again
+HOST_TEST(faults, interrupt_mode_recovers_silent_sensor) {
+    SimBoard board;
+    initMPU();
+    CHECK(initMPUInterrupt(200));
+    simElapseUs(100000);
+
+    board.primary.setPresent(false);
+    simElapseUs(5100000);                       // MPU_DATA_TIMEOUT without an edge
+    CHECK(!isMPU6050Connected());
+    board.primary.setPresent(true);
+    simElapseUs(3000000);
+    CHECK(isMPU6050Connected());
+    CHECK_EQ(getAcquisitionMode(), ACQ_MODE_INTERRUPT);
+    popAllSamples();
+    simElapseUs(100000);
+    std::vector<MotionSample> samples = popAllSamples();
+    CHECK_GE(samples.size(), 18);
+}
+
+// Missing at boot, the sensor is picked up by serviceMPURecovery() from
+// loop() and acquisition starts in interrupt mode (FIFO without INT)
+static void checkLateSensor(bool intWired, uint8_t expectedMode) {
+    SimBoard board(intWired);
+    board.primary.setPresent(false);
+    initMPU();
+    CHECK(!isMPU6050Connected());
+    for (int pass = 0; pass < 100; pass++) {
+        serviceMPURecovery();
+        simElapseUs(10000);
+    }
+    CHECK(!isMPU6050Connected());
+
+    board.primary.setPresent(true);
+    for (int pass = 0; pass < 300 && !isMPU6050Connected(); pass++) {
+        serviceMPURecovery();
+        simElapseUs(10000);
+    }
+    CHECK(isMPU6050Connected());
+    CHECK_EQ(getAcquisitionMode(), expectedMode);
+    simElapseUs(100000);
+    CHECK_GE(getSampleCount(), 15);
+}
+
+HOST_TEST(faults, late_sensor_starts_interrupt_mode) {
+    checkLateSensor(true, ACQ_MODE_INTERRUPT);
+}
+
+HOST_TEST(faults, late_sensor_without_int_starts_fifo) {
+    checkLateSensor(false, ACQ_MODE_FIFO);
+}
@@ -0,0 +1,161 @@
+// FIFO burst acquisition (ACQ_MODE_FIFO): entry parsing, overflow handling
+// and sample timing against the simulated sensor's own sample clock
+#include "HostTest.h"
+#include "SimBoard.h"
+
+static void startFifo(uint16_t rateHz) {
+    initMPU();
+    CHECK(isMPU6050Connected());
+    CHECK(initMPUFifo(rateHz));
+    CHECK_EQ(getAcquisitionMode(), ACQ_MODE_FIFO);
+}
+
+// Samples are consecutive, decoded field by field, and free of gap flags
+HOST_TEST(fifo, parses_entries_in_order) {
+    SimBoard board;
+    numberSamples(board.primary);
+    startFifo(200);
+    CHECK_EQ(getSampleRate(), 200);
+    CHECK_EQ(board.primary.registerValue(MPU6050_RA_SMPLRT_DIV), 4);
+
+    simElapseUs(500000);
+    std::vector<MotionSample> samples = popAllSamples();
+    CHECK_GE(samples.size(), 95);
+    CHECK_LE(samples.size(), 100);
+    for (size_t i = 0; i < samples.size(); i++) {
+        const MotionSample& s = samples[i];
+        CHECK_EQ(s.ay, -s.ax);
+        CHECK_EQ(s.az, 16384);
+        CHECK_EQ(s.temperature, s.ax);
+        CHECK_EQ(s.gx, s.ax);
+        CHECK_EQ(s.accelRange, ACCEL_RANGE_2G);
+        CHECK_EQ(s.flags, 0);
+        if (i > 0) {
+            CHECK_EQ(s.ax, samples[i - 1].ax + 1);
+            CHECK_NEAR(s.timestampUs - samples[i - 1].timestampUs, 5000, 5000 / 4);
+        }
+    }
+    CHECK_EQ(getFifoOverflowCount(), 0);
+}
+
+// Timestamps track the sensor's true sample times while its oscillator runs
+// off nominal, and stay strictly increasing. The per-drain nudge (error / 8)
+// settles about 8 drains' worth of drift behind, so a 1.5 % oscillator error
+// at 1 kHz leaves the timeline roughly one period late or early.
+static void checkTimeline(float oscillatorPpm, double maxErrorUs) {
+    SimBoard board;
+    numberSamples(board.primary);
+    board.primary.setOscillatorErrorPpm(oscillatorPpm);
+    startFifo(1000);
+
+    double worst = 0.0;
+    double sum = 0.0;
+    uint32_t measured = 0;
+    uint64_t lastTimestamp = 0;
+    for (int pass = 0; pass < 500; pass++) {
+        simElapseUs(20000);
+        for (const MotionSample& s : popAllSamples()) {
+            CHECK_GT(s.timestampUs, lastTimestamp);
+            lastTimestamp = s.timestampUs;
+            if (simNowUs() < 2000000) {
+                continue;  // Settling
+            }
+            double error = (double)s.timestampUs - (double)numberedSampleTime(board.primary, s.ax);
+            worst = max(worst, fabs(error));
+            sum += fabs(error);
+            measured++;
+        }
+    }
+    printf("  oscillator %+.0f ppm: mean |error| %.0f us, max %.0f us over %u samples\n", oscillatorPpm,
+           sum / measured, worst, measured);
+    CHECK_GT(measured, 7000);
+    CHECK_LE(worst, maxErrorUs);
+}
+
+HOST_TEST(fifo, timestamps_nominal_oscillator) {
+    checkTimeline(0.0f, 500.0);
+}
+
+HOST_TEST(fifo, timestamps_fast_oscillator) {
+    checkTimeline(15000.0f, 1250.0);
+}
+
+HOST_TEST(fifo, timestamps_slow_oscillator) {
+    checkTimeline(-15000.0f, 1250.0);
+}
+
+// A starved drain lets the FIFO overflow: it is counted, reset, and the next
+// sample is flagged as following a gap, with entry alignment intact
+HOST_TEST(fifo, overflow_resets_and_flags_gap) {
+    SimBoard board;
+    numberSamples(board.primary);
+    startFifo(1000);
+    simElapseUs(50000);
+    popAllSamples();
+
+    simSetTasksStarved(true);
+    simElapseUs(150000);              // 1024 bytes hold 73 entries, 73 ms at 1 kHz
+    CHECK_GT(board.primary.fifoOverflows(), 0);
+    simSetTasksStarved(false);
+    simElapseUs(50000);
+
+    CHECK_EQ(getFifoOverflowCount(), 1);
+    std::vector<MotionSample> samples = popAllSamples();
+    CHECK_GE(samples.size(), 40);
+    CHECK_EQ(samples[0].flags, SAMPLE_FLAG_GAP);
+    for (size_t i = 0; i < samples.size(); i++) {
+        CHECK_EQ(samples[i].ay, -samples[i].ax);
+        CHECK_EQ(samples[i].gx, samples[i].ax);
+        if (i > 0) {
+            CHECK_EQ(samples[i].flags, 0);
+            CHECK_EQ(samples[i].ax, samples[i - 1].ax + 1);
+        }
+    }
+}
+
+// A consumer that stops popping fills the ring; the first sample pushed
+// after it drains again is flagged
+HOST_TEST(fifo, ring_overflow_flags_gap) {
+    SimBoard board;
+    numberSamples(board.primary);
+    startFifo(1000);
+
+    simElapseUs(400000);
+    CHECK_EQ(getSampleCount(), SAMPLE_RING_SIZE - 1);
+    std::vector<MotionSample> first = popAllSamples();
+    CHECK_EQ(first.size(), SAMPLE_RING_SIZE - 1);
+
+    simElapseUs(30000);
+    std::vector<MotionSample> second = popAllSamples();
+    CHECK_GE(second.size(), 20);
+    CHECK_EQ(second[0].flags, SAMPLE_FLAG_GAP);
+    CHECK_GT(second[0].ax, first.back().ax + 1);
+    CHECK_EQ(getFifoOverflowCount(), 0);
+}
+
+// A new rate is written by the acquisition task after a drain; the FIFO is
+// reset so every later entry is at the new period
+HOST_TEST(fifo, rate_change_applies_after_drain) {
+    SimBoard board;
+    numberSamples(board.primary);
+    startFifo(200);
+    simElapseUs(100000);
+    popAllSamples();
+
+    CHECK(setSamplingConfig(500, DLPF_AUTO));
+    simElapseUs(100000);
+    CHECK_EQ(getSampleRate(), 500);
+    CHECK_EQ(board.primary.registerValue(MPU6050_RA_SMPLRT_DIV), 1);
+    CHECK_EQ(getDlpfBandwidthHz(), 188);
+
+    std::vector<MotionSample> samples = popAllSamples();
+    size_t gap = 0;
+    while (gap < samples.size() && !(samples[gap].flags & SAMPLE_FLAG_GAP)) {
+        gap++;
+    }
+    CHECK_LT(gap, samples.size());
+    CHECK_GE(samples.size() - gap, 30);
+    for (size_t i = gap + 1; i < samples.size(); i++) {
+        CHECK_NEAR(samples[i].timestampUs - samples[i - 1].timestampUs, 2000, 2000 / 4);
+    }
+}
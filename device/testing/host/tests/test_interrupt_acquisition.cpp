@@ -0,0 +1,106 @@
+// Data-ready interrupt acquisition (ACQ_MODE_INTERRUPT): sample stamping at
+// the edge, interval statistics, missed edges and the unwired-INT fallback
+#include "HostTest.h"
+#include "SimBoard.h"
+
+static void startInterrupt(uint16_t rateHz) {
+    initMPU();
+    CHECK(isMPU6050Connected());
+    CHECK(initMPUInterrupt(rateHz));
+    CHECK_EQ(getAcquisitionMode(), ACQ_MODE_INTERRUPT);
+    CHECK(isMPUInterruptWired());
+}
+
+// Each sample is stamped when its edge reaches the ISR, so its timestamp is
+// the true sample time plus the interrupt latency and nothing else
+HOST_TEST(interrupt, samples_stamped_at_data_ready) {
+    SimBoard board;
+    numberSamples(board.primary);
+    simSetIsrLatencyUs(2, 8);
+    startInterrupt(1000);
+
+    uint32_t count = 0;
+    double worstLatency = 0.0;
+    for (int pass = 0; pass < 100; pass++) {
+        simElapseUs(10000);
+        for (const MotionSample& s : popAllSamples()) {
+            double latency = (double)s.timestampUs - (double)numberedSampleTime(board.primary, s.ax);
+            CHECK_GE(latency, 2);
+            CHECK_LE(latency, 8);
+            CHECK_EQ(s.ay, -s.ax);
+            CHECK_EQ(s.flags, 0);
+            worstLatency = max(worstLatency, latency);
+            count++;
+        }
+    }
+    CHECK_GE(count, 990);
+
+    const SampleTimingStats& stats = getSampleTimingStats();
+    printf("  %u intervals: mean %.2f us, min %u, max %u, jitter %.2f us, worst latency %.0f us\n",
+           stats.intervals, stats.meanIntervalUs, stats.minIntervalUs, stats.maxIntervalUs,
+           getSampleJitterUs(), worstLatency);
+    CHECK_EQ(stats.missed, 0);
+    CHECK_GE(stats.intervals, 990);
+    CHECK_NEAR(stats.meanIntervalUs, 1000.0, 1.0);
+    CHECK_GE(stats.minIntervalUs, 1000 - 6);
+    CHECK_LE(stats.maxIntervalUs, 1000 + 6);
+    CHECK_LE(getSampleJitterUs(), 3.0);
+}
+
+// While a higher-priority job holds the CPU, edges pile up unserviced; the
+// task reads the latest sample when it runs again, counts the edges it lost
+// and flags the gap
+HOST_TEST(interrupt, starved_task_counts_missed_edges) {
+    SimBoard board;
+    numberSamples(board.primary);
+    startInterrupt(1000);
+    simElapseUs(20000);
+    int16_t previous = popAllSamples().back().ax;
+
+    uint32_t popped = 0;
+    uint32_t lost = 0;
+    uint32_t gaps = 0;
+    for (int burst = 0; burst < 10; burst++) {
+        simSetTasksStarved(true);
+        simElapseUs(5000);
+        simSetTasksStarved(false);
+        simElapseUs(45000);
+        for (const MotionSample& s : popAllSamples()) {
+            if (s.flags & SAMPLE_FLAG_GAP) {
+                CHECK_GT(s.ax, previous + 1);
+                gaps++;
+            } else {
+                CHECK_EQ(s.ax, previous + 1);
+            }
+            lost += s.ax - previous - 1;
+            previous = s.ax;
+            popped++;
+        }
+    }
+    const SampleTimingStats& stats = getSampleTimingStats();
+    printf("  %u samples, %u edges missed, %u gaps in 500 ms\n", popped, stats.missed, gaps);
+    CHECK_EQ(gaps, 10);
+    CHECK_EQ(stats.missed, lost);
+    CHECK_GE(stats.missed, 10 * 4);
+    CHECK_EQ(getAcquisitionMode(), ACQ_MODE_INTERRUPT);
+}
+
+// Without the INT line no edge arrives within the probe: the task is deleted,
+// data-ready is switched off again and the caller can pick another mode
+HOST_TEST(interrupt, unwired_int_falls_back) {
+    SimBoard board(false);
+    initMPU();
+    CHECK(isMPU6050Connected());
+    uint64_t start = simNowUs();
+    CHECK(!initMPUInterrupt(200));
+    CHECK_GE(simNowUs() - start, MPU_INT_PROBE_MS * 1000ULL);
+    CHECK_EQ(simTaskCount(), 0);
+    CHECK(!simIsInterruptAttached(MPU_INT_PIN));
+    CHECK_EQ(board.primary.registerValue(MPU6050_RA_INT_ENABLE) & (1 << MPU6050_INTERRUPT_DATA_RDY_BIT), 0);
+    CHECK_EQ(getAcquisitionMode(), ACQ_MODE_POLL);
+    CHECK(!isMPUInterruptWired());
+
+    CHECK(initMPUFifo(200));
+    simElapseUs(100000);
+    CHECK_GE(getSampleCount(), 15);
+}
@@ -0,0 +1,80 @@
+// Time a loop() pass spends on the sensor in each acquisition mode, against
+// the simulated bus's transfer timing
+#include "HostTest.h"
+#include "SimBoard.h"
+#include "LatencyStats.h"
+
+// The acquisition part of a loop() pass, timed into the loop histogram as
+// loop() does; returns the samples it got
+static size_t acquisitionPass() {
+    uint32_t start = micros();
+    serviceMPURecovery();
+    size_t samples = 0;
+    MotionSample sample;
+    if (getAcquisitionMode() != ACQ_MODE_POLL) {
+        while (popSample(sample)) {
+            samples++;
+        }
+    } else if (readMotion(sample)) {
+        samples++;
+    }
+    recordLoopPass(micros() - start);
+    return samples;
+}
+
+// Run passes with the given delay between them; returns the samples taken
+static size_t runPasses(const char* mode, int passes, uint32_t delayMs) {
+    resetLatencyStats();
+    uint64_t busBefore = SimI2CBus::instance().busyUs();
+    size_t samples = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        samples += acquisitionPass();
+        delay(delayMs);
+    }
+    const LatencyHistogram& h = getLoopPassHistogram();
+    printf("  %s: %u passes, %zu samples, pass min %u us, avg %u us, max %u us, bus busy %llu us\n", mode, h.count,
+           samples, h.minUs, (uint32_t)(h.sumUs / h.count), h.maxUs,
+           (unsigned long long)(SimI2CBus::instance().busyUs() - busBefore));
+    return samples;
+}
+
+// Polled, every pass waits for the 14-byte motion burst: address and
+// register write, repeated start, 14 bytes at 400 kHz
+HOST_TEST(looptime, polled_pass_waits_for_bus) {
+    SimBoard board;
+    initMPU();
+    CHECK_EQ(getAcquisitionMode(), ACQ_MODE_POLL);
+    uint64_t burstUs = SimI2CBus::instance().transferUs(SIM_I2C_READ_BITS + SIM_I2C_BYTE_BITS * 14);
+
+    size_t samples = runPasses("polled", 100, 10);
+    const LatencyHistogram& h = getLoopPassHistogram();
+    CHECK_EQ(samples, 100);
+    CHECK_GE(h.minUs, burstUs);
+    CHECK_LE(h.maxUs, burstUs + 10);
+}
+
+// With an acquisition task (FIFO drain or data-ready) doing the reads, a pass
+// only pops the ring and does no transfers of its own
+static void checkTaskPasses(bool interrupt) {
+    SimBoard board;
+    numberSamples(board.primary);
+    initMPU();
+    CHECK(interrupt ? initMPUInterrupt(200) : initMPUFifo(200));
+    simElapseUs(100000);
+    popAllSamples();
+
+    uint64_t busBefore = SimI2CBus::instance().busyUs();
+    size_t samples = runPasses(interrupt ? "interrupt" : "fifo", 100, 10);
+    const LatencyHistogram& h = getLoopPassHistogram();
+    CHECK_EQ(h.maxUs, 0);
+    CHECK_GE(samples, 195);                        // 200 Hz for 1 s
+    CHECK_GT(SimI2CBus::instance().busyUs(), busBefore);  // The task still did the transfers
+}
+
+HOST_TEST(looptime, fifo_pass_does_no_transfers) {
+    checkTaskPasses(false);
+}
+
+HOST_TEST(looptime, interrupt_pass_does_no_transfers) {
+    checkTaskPasses(true);
+}
@@ -0,0 +1,259 @@
+// Fixed-point MotionFilter against its float reference and against the
+// per-axis SimpleKalmanFilter it replaced, plus a host cost comparison
+#include "HostTest.h"
+#include "MotionFilter.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+// SimpleKalmanFilter::updateEstimate(), as the sketch used it per axis. The
+// library is its own translation unit, so each call stays out of line here too.
+struct SimpleKalman {
+    float errMeasure, errEstimate, q;
+    float lastEstimate = 0.0f;
+
+    SimpleKalman(float measurement, float estimate, float process)
+        : errMeasure(measurement), errEstimate(estimate), q(process) {}
+
+    __attribute__((noinline)) float updateEstimate(float measurement) {
+        float gain = errEstimate / (errEstimate + errMeasure);
+        float current = lastEstimate + gain * (measurement - lastEstimate);
+        errEstimate = (1.0f - gain) * errEstimate + fabsf(lastEstimate - current) * q;
+        lastEstimate = current;
+        return current;
+    }
+};
+
+// Noisy steps between -8000 and +16000 counts (scaled per axis), with a
+// full-scale spike on every axis now and then
+static std::vector<int16_t> makeSignal(int samples) {
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0.0f, 200.0f);
+    std::vector<int16_t> signal;
+    for (int k = 0; k < samples; k++) {
+        float base = (k / 20000) % 2 ? 16000.0f : -8000.0f;
+        for (int axis = 0; axis < MOTION_FILTER_AXES; axis++) {
+            float v = base * (axis + 1) / 3 + noise(rng);
+            if (k % 50000 == 7) {
+                v = axis ? 32767.0f : -32768.0f;
+            }
+            signal.push_back((int16_t)constrain(v, -32768.0f, 32767.0f));
+        }
+    }
+    return signal;
+}
+
+// Largest difference in counts between the two implementations, over the
+// whole run and over the samples at least `settle` after any step or spike.
+// The Q15 gain is rounded from the float one, which shows most while the
+// estimate slews across a step.
+static void compare(float measurement, float estimate, float process, double maxDiff, double maxSettledDiff) {
+    MotionFilter fixed;
+    MotionFilterFloat reference;
+    initMotionFilter(fixed, measurement, estimate, process);
+    initMotionFilter(reference, measurement, estimate, process);
+
+    const int samples = 200000;
+    const int settle = 1000;
+    std::vector<int16_t> signal = makeSignal(samples);
+    double worst = 0.0;
+    double worstSettled = 0.0;
+    for (int k = 0; k < samples; k++) {
+        int32_t out[MOTION_FILTER_AXES];
+        float ref[MOTION_FILTER_AXES];
+        updateMotionFilter(fixed, &signal[k * MOTION_FILTER_AXES], out);
+        updateMotionFilter(reference, &signal[k * MOTION_FILTER_AXES], ref);
+        bool settled = k % 20000 >= settle && (k % 50000 < 7 || k % 50000 >= 7 + settle);
+        for (int axis = 0; axis < MOTION_FILTER_AXES; axis++) {
+            double diff = fabs(out[axis] / 65536.0 - ref[axis]);
+            worst = max(worst, diff);
+            if (settled) {
+                worstSettled = max(worstSettled, diff);
+            }
+        }
+    }
+    printf("  noise (%g, %g, %g): gain %.5f, max diff %.4f counts, %.4f settled\n", measurement, estimate, process,
+           fixed.gain / 32768.0, worst, worstSettled);
+    CHECK(!fixed.settling);
+    CHECK_LE(worst, maxDiff);
+    CHECK_LE(worstSettled, maxSettledDiff);
+}
+
+HOST_TEST(motionfilter, matches_float_reference) {
+    compare(MOTION_FILTER_DEFAULT_MEASUREMENT, MOTION_FILTER_DEFAULT_ESTIMATE, MOTION_FILTER_DEFAULT_PROCESS, 5.0,
+            0.05);
+}
+
+HOST_TEST(motionfilter, matches_float_reference_retuned) {
+    compare(8.0f, 1.0f, 0.5f, 5.0, 0.05);
+}
+
+// The gain starts from the estimate error and settles on the precomputed
+// steady-state gain, after which it no longer moves
+HOST_TEST(motionfilter, gain_settles) {
+    MotionFilter filter;
+    initMotionFilter(filter, 2.0f, 50.0f, 0.01f);
+    float steady = getMotionFilterSteadyGain(2.0f, 0.01f);
+    CHECK_GT(filter.gain / 32768.0, 0.9);
+    int16_t raw[MOTION_FILTER_AXES] = {100, -100, 16384};
+    int32_t out[MOTION_FILTER_AXES];
+    int samples = 0;
+    while (filter.settling && samples < 10000) {
+        updateMotionFilter(filter, raw, out);
+        samples++;
+    }
+    printf("  steady gain %.5f (Q15 %u), settled after %d samples\n", steady, filter.steadyGain, samples);
+    CHECK(!filter.settling);
+    CHECK_NEAR(filter.gain / 32768.0, steady, 1.0 / 32768);
+    CHECK_NEAR(steady, 0.068, 0.001);
+    for (int k = 0; k < 100; k++) {
+        updateMotionFilter(filter, raw, out);
+    }
+    CHECK_EQ(filter.gain, filter.steadyGain);
+}
+
+// What changes against the per-axis SimpleKalmanFilter(2, 2, 0.01) it
+// replaced: noise left at rest and samples to 90 % of a step. The old gain
+// followed the size of each change; the new one is fixed, so it smooths as
+// much at rest and takes a few samples longer on a step.
+HOST_TEST(motionfilter, against_simple_kalman) {
+    MotionFilter fixed;
+    initMotionFilter(fixed, 2.0f, 2.0f, 0.01f);
+    SimpleKalman old(2, 2, 0.01f);
+    std::mt19937 rng(5);
+    std::normal_distribution<float> noise(0.0f, 8.0f);    // ~0.5 mg at ±2 g
+
+    const int samples = 20000;
+    double sumFixed = 0.0, sumOld = 0.0, sumIn = 0.0;
+    int counted = 0;
+    int riseFixed = -1, riseOld = -1;
+    for (int k = 0; k < samples + 200; k++) {
+        float level = k < samples ? 0.0f : 1000.0f;
+        int16_t value = (int16_t)lroundf(level + noise(rng));
+        int16_t raw[MOTION_FILTER_AXES] = {value, value, value};
+        int32_t out[MOTION_FILTER_AXES];
+        updateMotionFilter(fixed, raw, out);
+        float f = out[0] / 65536.0f;
+        float o = k == 0 ? (old.lastEstimate = value) : old.updateEstimate(value);
+        if (k >= 1000 && k < samples) {
+            sumFixed += f * f;
+            sumOld += o * o;
+            sumIn += (double)value * value;
+            counted++;
+        }
+        if (k >= samples) {
+            if (riseFixed < 0 && f >= 900.0f) {
+                riseFixed = k - samples + 1;
+            }
+            if (riseOld < 0 && o >= 900.0f) {
+                riseOld = k - samples + 1;
+            }
+        }
+    }
+    double inStd = sqrt(sumIn / counted);
+    double fixedStd = sqrt(sumFixed / counted);
+    double oldStd = sqrt(sumOld / counted);
+    printf("  at rest: %.2f counts in, %.2f out (SimpleKalmanFilter %.2f); 90%% of a step after %d samples "
+           "(SimpleKalmanFilter %d)\n", inStd, fixedStd, oldStd, riseFixed, riseOld);
+    CHECK_LE(fixedStd, 0.3 * inStd);
+    CHECK_LE(fixedStd, 1.5 * oldStd);
+    CHECK_GT(riseFixed, 0);
+    CHECK_LE(riseFixed, 40);
+}
+
+// A range change re-expresses the state; the fixed and float filters agree
+// after it just as before
+HOST_TEST(motionfilter, rescale_keeps_agreement) {
+    MotionFilter fixed;
+    MotionFilterFloat reference;
+    initMotionFilter(fixed, 2.0f, 2.0f, 0.01f);
+    initMotionFilter(reference, 2.0f, 2.0f, 0.01f);
+    int16_t raw[MOTION_FILTER_AXES] = {4000, -2000, 16384};
+    int32_t out[MOTION_FILTER_AXES];
+    float ref[MOTION_FILTER_AXES];
+    for (int k = 0; k < 500; k++) {
+        updateMotionFilter(fixed, raw, out);
+        updateMotionFilter(reference, raw, ref);
+    }
+    rescaleMotionFilter(fixed, -3);            // ±2 g -> ±16 g
+    rescaleMotionFilter(reference, -3);
+    int16_t coarse[MOTION_FILTER_AXES] = {500, -250, 2048};
+    for (int k = 0; k < 500; k++) {
+        updateMotionFilter(fixed, coarse, out);
+        updateMotionFilter(reference, coarse, ref);
+    }
+    for (int axis = 0; axis < MOTION_FILTER_AXES; axis++) {
+        CHECK_NEAR(out[axis] / 65536.0, coarse[axis], 0.01);
+        CHECK_NEAR(out[axis] / 65536.0, ref[axis], 0.01);
+    }
+    rescaleMotionFilter(fixed, 3);
+    updateMotionFilter(fixed, raw, out);
+    for (int axis = 0; axis < MOTION_FILTER_AXES; axis++) {
+        CHECK_NEAR(out[axis] / 65536.0, raw[axis], 0.01);
+    }
+}
+
+// One timing of `rounds` passes over the signal, in ns per 3-axis sample
+// (wall clock)
+template <typename Pass>
+static double nsPerSample(int samples, Pass pass) {
+    const int rounds = 4;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        pass();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / ((double)samples * rounds);
+}
+
+// Host cost against the three SimpleKalmanFilter objects it replaced. The
+// fixed-point path does no divide, which on the ESP32 is a software routine
+// for floats, so the host ratio understates the gain there. The three are
+// timed in turn and the fastest run of each kept, so load on the host slows
+// all of them alike.
+HOST_TEST(motionfilter, benchmark) {
+    const int samples = 200000;
+    std::vector<int16_t> signal = makeSignal(samples);
+    volatile float sink = 0.0f;
+
+    SimpleKalman axes[MOTION_FILTER_AXES] = {{2, 2, 0.01f}, {2, 2, 0.01f}, {2, 2, 0.01f}};
+    auto simplePass = [&]() {
+        for (int k = 0; k < samples; k++) {
+            for (int axis = 0; axis < MOTION_FILTER_AXES; axis++) {
+                sink = axes[axis].updateEstimate(signal[k * MOTION_FILTER_AXES + axis] / 16384.0f);
+            }
+        }
+    };
+
+    MotionFilterFloat reference;
+    initMotionFilter(reference, 2.0f, 2.0f, 0.01f);
+    auto floatPass = [&]() {
+        for (int k = 0; k < samples; k++) {
+            float ref[MOTION_FILTER_AXES];
+            updateMotionFilter(reference, &signal[k * MOTION_FILTER_AXES], ref);
+            sink = ref[0];
+        }
+    };
+
+    MotionFilter fixed;
+    initMotionFilter(fixed, 2.0f, 2.0f, 0.01f);
+    auto fixedPass = [&]() {
+        for (int k = 0; k < samples; k++) {
+            int32_t out[MOTION_FILTER_AXES];
+            updateMotionFilter(fixed, &signal[k * MOTION_FILTER_AXES], out);
+            sink = out[0];
+        }
+    };
+
+    double simpleNs = 1e30, floatNs = 1e30, fixedNs = 1e30;
+    for (int run = 0; run < 7; run++) {
+        simpleNs = min(simpleNs, nsPerSample(samples, simplePass));
+        floatNs = min(floatNs, nsPerSample(samples, floatPass));
+        fixedNs = min(fixedNs, nsPerSample(samples, fixedPass));
+    }
+
+    printf("  ns per 3-axis sample: SimpleKalmanFilter x3 %.1f, MotionFilterFloat %.1f, MotionFilter %.1f "
+           "(%.2fx the SimpleKalmanFilter cost)\n", simpleNs, floatNs, fixedNs, fixedNs / simpleNs);
+    CHECK(sink == sink);
+    CHECK_LE(fixedNs, 0.5 * simpleNs);
+}
@@ -0,0 +1,170 @@
+// Madgwick orientation filter against synthetic trajectories with known
+// attitude, and its update rate on the host
+#include "HostTest.h"
+#include "OrientationFilter.h"
+#include "TiltDetection.h"
+#include <chrono>
+#include <vector>
+
+#define RATE_HZ     200
+#define DT_S        (1.0f / RATE_HZ)
+
+static const double DEG = M_PI / 180.0;
+
+// Attitude with yaw held at zero; body rates and the gravity reading follow
+// from roll and pitch and their derivatives
+struct Attitude {
+    double roll, pitch;              // degrees
+    double rollRate, pitchRate;      // degrees/s
+};
+
+struct ImuReading {
+    float gx, gy, gz;                // degrees/s
+    float ax, ay, az;                // g
+};
+
+static ImuReading sense(const Attitude& a, double forwardAccelG = 0.0) {
+    double phi = a.roll * DEG;
+    double theta = a.pitch * DEG;
+    ImuReading r;
+    r.gx = a.rollRate;
+    r.gy = a.pitchRate * cos(phi);
+    r.gz = -a.pitchRate * sin(phi);
+    r.ax = -sin(theta) + forwardAccelG;
+    r.ay = sin(phi) * cos(theta);
+    r.az = cos(phi) * cos(theta);
+    return r;
+}
+
+// Leaning and pitching like a bike through a chicane
+static Attitude chicane(double t) {
+    Attitude a;
+    a.roll = 35.0 * sin(2 * M_PI * 0.4 * t);
+    a.rollRate = 35.0 * 2 * M_PI * 0.4 * cos(2 * M_PI * 0.4 * t);
+    a.pitch = 8.0 * sin(2 * M_PI * 0.25 * t + 1.0);
+    a.pitchRate = 8.0 * 2 * M_PI * 0.25 * cos(2 * M_PI * 0.25 * t + 1.0);
+    return a;
+}
+
+static void update(const ImuReading& r, float gyroBiasDps = 0.0f) {
+    updateOrientation(r.gx + gyroBiasDps, r.gy + gyroBiasDps, r.gz, r.ax, r.ay, r.az, DT_S);
+}
+
+// Seeded from gravity, the quaternion gives back the accel-only tilt
+HOST_TEST(orientation, seeds_from_gravity) {
+    Attitude a = {25.0, -15.0, 0.0, 0.0};
+    ImuReading r = sense(a);
+    CHECK(!isOrientationInitialized());
+    update(r);
+    CHECK(isOrientationInitialized());
+    const Orientation& o = getOrientation();
+    CHECK_NEAR(o.roll, 25.0, 0.01);
+    CHECK_NEAR(o.pitch, -15.0, 0.01);
+    CHECK_NEAR(o.yaw, 0.0, 0.01);
+    CHECK_NEAR(o.linAx, 0.0, 1e-4);
+    CHECK_NEAR(o.linAz, 0.0, 1e-4);
+}
+
+// Gyro integration follows the trajectory; the accel keeps the error bounded
+static void runChicane(float gyroBiasDps, double maxErrorDeg) {
+    update(sense(chicane(0.0)));
+    double worstRoll = 0.0;
+    double worstPitch = 0.0;
+    for (int n = 1; n <= 60 * RATE_HZ; n++) {
+        Attitude a = chicane(n * (double)DT_S);
+        update(sense(a), gyroBiasDps);
+        if (n > 10 * RATE_HZ) {
+            worstRoll = max(worstRoll, fabs(getOrientation().roll - a.roll));
+            worstPitch = max(worstPitch, fabs(getOrientation().pitch - a.pitch));
+        }
+    }
+    printf("  gyro bias %.1f dps: max roll error %.3f deg, max pitch error %.3f deg\n", gyroBiasDps, worstRoll,
+           worstPitch);
+    CHECK_LE(worstRoll, maxErrorDeg);
+    CHECK_LE(worstPitch, maxErrorDeg);
+}
+
+HOST_TEST(orientation, tracks_chicane) {
+    runChicane(0.0f, 0.5);
+}
+
+HOST_TEST(orientation, tracks_chicane_with_gyro_bias) {
+    runChicane(0.5f, 1.0);
+}
+
+// Hard braking (1 g, |a| = 1.41 g) is gated out of the correction: the tilt
+// stays level where accel-only tilt reads 45 degrees, and the braking shows
+// up as linear acceleration
+HOST_TEST(orientation, hard_braking_keeps_level) {
+    Attitude level = {0.0, 0.0, 0.0, 0.0};
+    for (int n = 0; n < 2 * RATE_HZ; n++) {
+        update(sense(level));
+    }
+    ImuReading braking = sense(level, -1.0);
+    float accelRoll, accelPitch;
+    calculateTilt(braking.ax, braking.ay, braking.az, accelRoll, accelPitch);
+    for (int n = 0; n < 3 * RATE_HZ; n++) {
+        update(braking);
+    }
+    const Orientation& o = getOrientation();
+    printf("  after 3 s at 1 g: pitch %.3f deg (accel-only %.1f), linear ax %.3f g\n", o.pitch, accelPitch,
+           o.linAx);
+    CHECK_NEAR(accelPitch, 45.0, 0.1);
+    CHECK_NEAR(o.pitch, 0.0, 0.01);
+    CHECK_NEAR(o.linAx, -1.0, 0.001);
+}
+
+// Moderate braking (0.5 g, |a| = 1.12 g) passes the gate, so the tilt is
+// pulled towards the skewed gravity at the correction rate: well short of
+// accel-only tilt for the first second, but there within about 3 s
+HOST_TEST(orientation, moderate_braking_is_slow_to_skew) {
+    Attitude level = {0.0, 0.0, 0.0, 0.0};
+    for (int n = 0; n < 2 * RATE_HZ; n++) {
+        update(sense(level));
+    }
+    ImuReading braking = sense(level, -0.5);
+    float accelRoll, accelPitch;
+    calculateTilt(braking.ax, braking.ay, braking.az, accelRoll, accelPitch);
+    for (int n = 0; n < 1 * RATE_HZ; n++) {
+        update(braking);
+    }
+    double afterOne = getOrientation().pitch;
+    for (int n = 0; n < 2 * RATE_HZ; n++) {
+        update(braking);
+    }
+    double afterThree = getOrientation().pitch;
+    printf("  0.5 g braking: pitch %.2f deg after 1 s, %.2f after 3 s (accel-only %.1f)\n", afterOne,
+           afterThree, accelPitch);
+    CHECK_LT(fabs(afterOne), fabs(accelPitch) / 2);
+    CHECK_NEAR(afterThree, accelPitch, 1.0);
+}
+
+// Yaw follows the Z gyro from the heading at boot
+HOST_TEST(orientation, integrates_yaw) {
+    Attitude level = {0.0, 0.0, 0.0, 0.0};
+    ImuReading turning = sense(level);
+    update(turning);
+    turning.gz = 30.0f;
+    for (int n = 0; n < 2 * RATE_HZ; n++) {
+        update(turning);
+    }
+    CHECK_NEAR(getOrientation().yaw, 60.0, 0.1);
+    CHECK_NEAR(getOrientation().roll, 0.0, 0.01);
+}
+
+// Host updates per second (wall clock); not a prediction of ESP32 cost
+HOST_TEST(orientation, benchmark) {
+    const int updates = 2000000;
+    std::vector<ImuReading> readings;
+    for (int n = 0; n < 1000; n++) {
+        readings.push_back(sense(chicane(n * (double)DT_S)));
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < updates; n++) {
+        update(readings[n % readings.size()]);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("  %.1f M updates/s (%.0f ns/update)\n", updates / seconds / 1e6, seconds / updates * 1e9);
+    CHECK_EQ(getOrientationStats().updates, updates - 1);
+    CHECK(fabs(getOrientation().roll) <= 90.0);
+}
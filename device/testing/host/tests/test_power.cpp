@@ -0,0 +1,146 @@
+// Parked mode in virtual time: parking after the idle period, wake latency
+// from motion onset, and how much of the parked time the CPU is awake
+#include "HostTest.h"
+#include "SimBoard.h"
+#include "PowerManager.h"
+
+// BluetoothHandler's advertising switch, recorded instead
+static bool advertising = true;
+static uint32_t advertisingStops = 0;
+
+void setAdvertisingEnabled(bool enabled) {
+    if (advertising && !enabled) {
+        advertisingStops++;
+    }
+    advertising = enabled;
+}
+
+// One loop() pass as far as the power manager sees it
+static void loopPass(bool busy = false) {
+    if (!isParked()) {
+        MotionSample s;
+        while (popSample(s)) {
+            notePowerActivity(gyroToDps(s.gx), gyroToDps(s.gy), gyroToDps(s.gz), accelToG(s.ax, s.accelRange),
+                              accelToG(s.ay, s.accelRange), accelToG(s.az, s.accelRange));
+        }
+    }
+    servicePowerManager(busy);
+    delay(10);
+}
+
+static void runLoopUntil(uint64_t timeUs) {
+    while (simNowUs() < timeUs) {
+        loopPass();
+    }
+}
+
+// Resting, then a 0.3 g bump along X from onsetUs on
+static SimMotionSource bumpAt(uint64_t onsetUs) {
+    return [onsetUs](uint64_t timeUs) {
+        SimMotion m = simRestingMotion(timeUs);
+        if (timeUs >= onsetUs) {
+            m.accelG[0] = 0.3f;
+        }
+        return m;
+    };
+}
+
+// Boot in the given mode and run loop() until it parks; returns the time it
+// parked
+static uint64_t bootAndPark(SimBoard& board, bool intWired) {
+    initMPU();
+    CHECK(intWired ? initMPUInterrupt(200) : initMPUFifo(200));
+    runLoopUntil(PARK_IDLE_MS * 1000ULL - 1000000);
+    CHECK(!isParked());
+    while (!isParked() && simNowUs() < PARK_IDLE_MS * 1000ULL + 1000000) {
+        loopPass();
+    }
+    CHECK(isParked());
+    CHECK_EQ(getPowerStats().parks, 1);
+    CHECK(board.primary.registerValue(MPU6050_RA_PWR_MGMT_1) & (1 << MPU6050_PWR1_CYCLE_BIT));   // Cycle mode
+    return simNowUs();
+}
+
+// Park for 20 advertising periods, then move phaseUs into the next one;
+// returns the wake latency from motion onset to acquisition running
+static uint64_t parkAndWake(bool intWired, uint64_t phaseUs) {
+    SimBoard board(intWired);
+    uint64_t parkedAt = bootAndPark(board, intWired);
+    uint64_t onset = parkedAt + 20ULL * PARK_ADVERTISE_PERIOD_MS * 1000 + phaseUs;
+    board.primary.setMotion(bumpAt(onset));
+
+    while (isParked() && simNowUs() < onset + 5000000) {
+        loopPass();
+    }
+    CHECK(!isParked());
+    uint64_t latency = simNowUs() - onset;
+    const PowerStats& stats = getPowerStats();
+    printf("  INT %s, onset %.1f s into a period: woke %.1f ms after onset (CPU side %.2f ms), "
+           "parked duty cycle %.2f%%, %u advertising stops\n",
+           intWired ? "wired" : "unwired", phaseUs / 1e6, latency / 1000.0, stats.lastWakeLatencyUs / 1000.0,
+           getParkedDutyCycle() * 100, advertisingStops);
+    CHECK_EQ(stats.wakes, 1);
+    CHECK_EQ(stats.sleepUs, simLightSleepUs());
+    CHECK_EQ(advertisingStops, phaseUs < PARK_ADVERTISE_WINDOW_MS * 1000ULL ? 20 : 21);
+    CHECK(advertising);
+
+    // Awake for the advertising windows, plus the motion polls without INT
+    CHECK_GE(getParkedDutyCycle(), (float)PARK_ADVERTISE_WINDOW_MS / PARK_ADVERTISE_PERIOD_MS);
+    CHECK_LE(getParkedDutyCycle(), 0.075);
+
+    // Full-rate acquisition is back
+    CHECK_EQ(getAcquisitionMode(), intWired ? ACQ_MODE_INTERRUPT : ACQ_MODE_FIFO);
+    popAllSamples();
+    simElapseUs(100000);
+    CHECK_GE(getSampleCount(), 18);
+    return latency;
+}
+
+// With INT wired the motion interrupt ends light sleep: one accel wake period
+// (25 ms) plus the sensor reconfiguration
+HOST_TEST(power, int_wired_wakes_from_sleep) {
+    CHECK_LE(parkAndWake(true, 10000000), 25000 + 5000);
+}
+
+// Awake in an advertising window, motion is seen on the next loop() pass
+HOST_TEST(power, int_wired_wakes_in_window) {
+    CHECK_LE(parkAndWake(true, 1000000), 25000 + 10000 + 5000);
+}
+
+// Without INT the motion status is polled every PARK_MOTION_POLL_MS
+HOST_TEST(power, int_unwired_wakes_from_sleep) {
+    CHECK_LE(parkAndWake(false, 10000000), 25000 + PARK_MOTION_POLL_MS * 1000 + 5000);
+}
+
+HOST_TEST(power, int_unwired_wakes_in_window) {
+    CHECK_LE(parkAndWake(false, 1000000), 25000 + 10000 + 5000);
+}
+
+// A client connecting during an advertising window ends parked mode without
+// motion
+HOST_TEST(power, connection_wakes) {
+    SimBoard board;
+    bootAndPark(board, true);
+    runLoopUntil(simNowUs() + 500000);
+    CHECK(isParked());
+    loopPass(true);
+    CHECK(!isParked());
+    CHECK_EQ(getPowerStats().wakes, 1);
+    CHECK_EQ(getAcquisitionMode(), ACQ_MODE_INTERRUPT);
+}
+
+// Parking needs a still sensor: slow rocking above PARK_STILL_DPS keeps the
+// device awake
+HOST_TEST(power, motion_postpones_parking) {
+    SimBoard board;
+    board.primary.setMotion([](uint64_t timeUs) {
+        SimMotion m = simRestingMotion(timeUs);
+        m.gyroDps[0] = 5.0f * sin(timeUs / 1e6);
+        return m;
+    });
+    initMPU();
+    CHECK(initMPUInterrupt(200));
+    runLoopUntil(PARK_IDLE_MS * 1000ULL * 2);
+    CHECK(!isParked());
+    CHECK_EQ(getPowerStats().parks, 0);
+}
@@ -0,0 +1,237 @@
+// Health monitor on synthetic raw samples (rest, frozen, stuck axis,
+// saturation, implausible gravity) and through getMPUStatus() with the
+// simulated sensor, plus the factory self-test on it
+#include "HostTest.h"
+#include "SimBoard.h"
+#include "SensorHealth.h"
+#include <chrono>
+#include <random>
+
+#define RATE_HZ         200
+#define PERIOD_US       (1000000 / RATE_HZ)
+#define NOISE_COUNTS    8.0f                       // ~0.5 mg, ~0.5 °/s at the default ranges
+
+// Raw samples at RATE_HZ: gravity of gravityG along Z plus noise; axes
+// listed in `frozenAxes` repeat their previous value
+struct SampleStream {
+    std::mt19937 rng{1};
+    std::normal_distribution<float> noise{0.0f, NOISE_COUNTS};
+    MotionSample sample = {};
+
+    const MotionSample& next(float gravityG, uint8_t frozenAxes = 0, int16_t rail = 0) {
+        int16_t values[HEALTH_AXES] = {
+            (int16_t)noise(rng), (int16_t)noise(rng), (int16_t)(gravityG * 16384 + noise(rng)),
+            (int16_t)noise(rng), (int16_t)noise(rng), (int16_t)noise(rng)};
+        if (rail != 0) {
+            values[0] = rail;
+        }
+        int16_t* fields[HEALTH_AXES] = {&sample.ax, &sample.ay, &sample.az, &sample.gx, &sample.gy, &sample.gz};
+        for (uint8_t i = 0; i < HEALTH_AXES; i++) {
+            if (!(frozenAxes & (1 << i))) {
+                *fields[i] = values[i];
+            }
+        }
+        sample.timestampUs += PERIOD_US;
+        return sample;
+    }
+
+    void run(int samples, float gravityG, uint8_t frozenAxes = 0, int16_t rail = 0) {
+        for (int k = 0; k < samples; k++) {
+            updateSensorHealth(next(gravityG, frozenAxes, rail));
+        }
+    }
+};
+
+#define ALL_AXES    0x3f
+
+HOST_TEST(health, rest_is_ok) {
+    SampleStream stream;
+    stream.run(400, 1.0f);
+    const SensorHealth& h = getSensorHealth();
+    printf("  at rest: status %u, |g| %.4f, accel noise %.5f g, gyro noise %.3f dps\n", h.status, h.gravityG,
+           getAxisNoise(0), getAxisNoise(3));
+    CHECK_EQ(h.status, HEALTH_OK);
+    CHECK(h.atRest);
+    CHECK_NEAR(h.gravityG, 1.0, 0.001);
+    CHECK_NEAR(getAxisNoise(0), NOISE_COUNTS / 16384, NOISE_COUNTS / 16384 * 0.4);
+    CHECK_NEAR(getAxisNoise(3), NOISE_COUNTS / 16.4, NOISE_COUNTS / 16.4 * 0.4);
+}
+
+// Frozen on the HEALTH_STUCK_SAMPLES-th repeat of a 6-axis sample, and fine
+// again as soon as one changes
+HOST_TEST(health, frozen_output) {
+    SampleStream stream;
+    stream.run(100, 1.0f);
+    stream.run(HEALTH_STUCK_SAMPLES - 1, 1.0f, ALL_AXES);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_OK);
+    stream.run(1, 1.0f, ALL_AXES);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_FROZEN);
+    stream.run(1, 1.0f);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_OK);
+}
+
+// One accel axis stuck while the rest still move: frozen after
+// HEALTH_STUCK_AXIS_MS
+HOST_TEST(health, stuck_axis) {
+    SampleStream stream;
+    stream.run(100, 1.0f);
+    const int stuck = HEALTH_STUCK_AXIS_MS * RATE_HZ / 1000;
+    stream.run(stuck - 1, 1.0f, 1 << 2);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_OK);
+    stream.run(1, 1.0f, 1 << 2);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_FROZEN);
+}
+
+// An impact shorter than HEALTH_SATURATION_MS passes; a rail held longer
+// does not
+HOST_TEST(health, saturation) {
+    SampleStream stream;
+    stream.run(100, 1.0f);
+    stream.run(1, 1.0f, 0, INT16_MAX);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_OK);
+    stream.run(HEALTH_SATURATION_MS * RATE_HZ / 1000 - 21, 1.0f, 0, INT16_MAX);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_OK);
+    stream.run(50, 1.0f);
+    int held = 0;
+    while (getSensorHealthStatus() != HEALTH_SATURATED && held < 1000) {
+        stream.run(1, 1.0f, 0, INT16_MAX);
+        held++;
+    }
+    uint32_t heldMs = (held - 1) * 1000 / RATE_HZ;
+    printf("  saturated after the rail was held %u ms (%d samples)\n", heldMs, held);
+    CHECK_GE(heldMs, HEALTH_SATURATION_MS);
+    CHECK_LE(heldMs, HEALTH_SATURATION_MS + 1000 / RATE_HZ);
+    CHECK_EQ(getSensorHealth().saturationCount, HEALTH_SATURATION_MS * RATE_HZ / 1000 - 20 + held);
+}
+
+// |a| at rest is checked against 1 g within HEALTH_GRAVITY_TOLERANCE_G
+HOST_TEST(health, implausible_gravity) {
+    SampleStream stream;
+    stream.run(400, 0.8f);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_OK);
+    stream.run(400, 0.5f);
+    printf("  0.5 g at rest: status %u, |g| %.4f\n", getSensorHealthStatus(), getSensorHealth().gravityG);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_GRAVITY);
+    CHECK_NEAR(getSensorHealth().gravityG, 0.5, 0.001);
+}
+
+// While moving, gravity is not judged: the last rest value stands
+HOST_TEST(health, gravity_only_judged_at_rest) {
+    SampleStream stream;
+    stream.run(400, 1.0f);
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> shake(0.3f, 0.7f);
+    for (int k = 0; k < 400; k++) {
+        updateSensorHealth(stream.next(shake(rng)));
+    }
+    CHECK(!getSensorHealth().atRest);
+    CHECK_EQ(getSensorHealthStatus(), HEALTH_OK);
+    CHECK_NEAR(getSensorHealth().gravityG, 1.0, 0.01);
+}
+
+// The simulated sensor has no noise of its own, so its output at rest is
+// exactly what a frozen one gives
+HOST_TEST(health, status_through_sensor) {
+    SimBoard board;
+    auto rng = std::make_shared<std::mt19937>(3);
+    board.primary.setMotion([rng](uint64_t timeUs) {
+        std::normal_distribution<float> noise(0.0f, 0.002f);
+        SimMotion m = simRestingMotion(timeUs);
+        for (uint8_t i = 0; i < 3; i++) {
+            m.accelG[i] += noise(*rng);
+            m.gyroDps[i] += noise(*rng) * 100;
+        }
+        return m;
+    });
+    initMPU();
+    CHECK(initMPUFifo(RATE_HZ));
+    for (int pass = 0; pass < 100; pass++) {
+        simElapseUs(10000);
+        for (const MotionSample& s : popAllSamples()) {
+            updateSensorHealth(s);
+        }
+    }
+    CHECK_EQ(getMPUStatus(), 2);
+
+    board.primary.setMotion(simRestingMotion);
+    int samples = 0;
+    while (getMPUStatus() == 2 && samples < 1000) {
+        simElapseUs(10000);
+        for (const MotionSample& s : popAllSamples()) {
+            updateSensorHealth(s);
+            samples++;
+        }
+    }
+    printf("  frozen reported after %d samples\n", samples);
+    CHECK_EQ(getMPUStatus(), HEALTH_FROZEN);
+    CHECK_LE(samples, HEALTH_STUCK_SAMPLES + 2 * MPU_FIFO_DRAIN_MS * RATE_HZ / 1000);
+}
+
+// Output change a 5-bit trim code predicts (register map rev 4.2, section
+// 4.1): accel in g at ±8 g, gyro in °/s at ±250 °/s
+static float trimResponse(uint8_t axis, uint8_t code) {
+    if (axis < 3) {
+        return 0.34f * powf(0.92f / 0.34f, (code - 1) / 30.0f);
+    }
+    float dps = 25.0f * powf(1.046f, code - 1);
+    return axis == 4 ? -dps : dps;
+}
+
+// An axis without a factory trim (code 0) is reported untested and neither
+// fails the IMU nor hides a real failure on another axis
+HOST_TEST(health, self_test_untested_axes) {
+    SimBoard board;
+    const uint8_t codes[IMU_SELF_TEST_AXES] = {12, 16, 20, 10, 14, 0};   // No gz trim
+    float response[IMU_SELF_TEST_AXES];
+    for (uint8_t axis = 0; axis < IMU_SELF_TEST_AXES; axis++) {
+        response[axis] = codes[axis] ? trimResponse(axis, codes[axis]) : 0.0f;
+    }
+    response[3] *= 1.3f;                                                   // gx 30 % high
+    board.primary.setSelfTestTrim(codes);
+    board.primary.setSelfTestResponse(response);
+    initMPU();
+
+    CHECK(runMPUSelfTest());
+    const ImuSelfTest& result = getSelfTestResult(0);
+    printf("  deviation ax..gy: %.3f %.3f %.3f %.3f %.3f, failed 0x%02x, untested 0x%02x\n", result.deviation[0],
+           result.deviation[1], result.deviation[2], result.deviation[3], result.deviation[4], result.failedAxes,
+           result.untestedAxes);
+    CHECK(result.ran);
+    CHECK(!result.passed);
+    CHECK_EQ(result.failedAxes, 1 << 3);
+    CHECK_EQ(result.untestedAxes, 1 << 5);
+    CHECK_NEAR(result.deviation[3], 0.3, 0.01);
+    CHECK(isnan(result.deviation[5]));
+    CHECK(isSelfTestFailed());
+
+    response[3] = trimResponse(3, codes[3]);
+    board.primary.setSelfTestResponse(response);
+    CHECK(runMPUSelfTest());
+    CHECK(result.passed);
+    CHECK_EQ(result.failedAxes, 0);
+    CHECK_EQ(result.untestedAxes, 1 << 5);
+    for (uint8_t axis = 0; axis < 5; axis++) {
+        CHECK_NEAR(result.deviation[axis], 0.0, 0.01);
+    }
+    CHECK(!isSelfTestFailed());
+    CHECK(getMPUStatus() != MPU_STATUS_SELF_TEST_FAILED);
+}
+
+// Host ns per sample (wall clock); not a prediction of ESP32 cost
+HOST_TEST(health, benchmark) {
+    SampleStream stream;
+    std::vector<MotionSample> samples;
+    for (int k = 0; k < 1000; k++) {
+        samples.push_back(stream.next(1.0f));
+    }
+    const int updates = 2000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < updates; k++) {
+        MotionSample& s = samples[k % samples.size()];
+        s.timestampUs += PERIOD_US * samples.size();
+        updateSensorHealth(s);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("  %.1f ns per sample\n", ns / updates);
+    CHECK_EQ(getSensorHealth().samples, updates);
+}
@@ -0,0 +1,196 @@
+// Bias-vs-temperature fit on synthetic sweeps, and the thermal capture and
+// hot-path correction end to end through the simulated sensor
+#include "HostTest.h"
+#include "SimBoard.h"
+#include "Calibration.h"
+#include "TiltDetection.h"
+#include <random>
+
+// Injected drift per axis, relative to 15 °C: X and Z linear, Y with a
+// curvature term; gravity along Z
+static const float SLOPE_G[3] = {0.0004f, -0.0003f, 0.0008f};
+static const float CURVE_G[3] = {0.0f, 5e-6f, 0.0f};
+static const float OFFSET_G[3] = {0.01f, -0.02f, 1.0f};
+#define SWEEP_FROM_C   15.0f
+
+static float driftG(uint8_t axis, float temperatureC) {
+    float x = temperatureC - SWEEP_FROM_C;
+    return SLOPE_G[axis] * x + CURVE_G[axis] * x * x;
+}
+
+// Block-averaged points of a sweep from `fromC` to `toC`, with the residual
+// noise of a 64-sample mean
+static const char* fitSweep(float fromC, float toC, int points, ThermalModel& model, float shiftAt = -1.0f) {
+    std::mt19937 rng(2);
+    std::normal_distribution<float> noise(0.0f, 0.0005f);
+    ThermalAccumulator acc;
+    resetThermalAccumulator(acc);
+    for (int k = 0; k < points; k++) {
+        float t = fromC + (toC - fromC) * k / (points - 1);
+        float accel[3];
+        for (uint8_t i = 0; i < 3; i++) {
+            accel[i] = OFFSET_G[i] + driftG(i, t) + noise(rng);
+        }
+        if (shiftAt >= 0 && t >= shiftAt) {
+            accel[0] += 0.2f;                                // Knocked over
+        }
+        const char* error = accumulateThermalPoint(acc, t, accel);
+        if (error != nullptr) {
+            return error;
+        }
+    }
+    return estimateThermalModel(acc, model);
+}
+
+// A 35 °C sweep fits the quadratic; model coefficients are relative to the
+// first point's temperature, which here is where the injected drift is zero
+HOST_TEST(thermal, fits_wide_sweep) {
+    ThermalModel model;
+    CHECK(fitSweep(15.0f, 50.0f, 400, model) == nullptr);
+    CHECK_NEAR(model.refTempC, SWEEP_FROM_C, 1e-6);
+    for (uint8_t i = 0; i < 3; i++) {
+        printf("  axis %u: slope %.3f mg/C (true %.3f), curve %.5f mg/C^2 (true %.5f)\n", i, model.slope[i] * 1000,
+               SLOPE_G[i] * 1000, model.curve[i] * 1000, CURVE_G[i] * 1000);
+        CHECK_NEAR(model.slope[i], SLOPE_G[i], 5e-6);
+        CHECK_NEAR(model.curve[i], CURVE_G[i], 5e-7);
+    }
+}
+
+// Between CALIB_THERMAL_MIN_SPAN_C and CALIB_THERMAL_QUADRATIC_SPAN_C the fit
+// is linear
+HOST_TEST(thermal, narrow_sweep_fits_line) {
+    ThermalModel model;
+    CHECK(fitSweep(15.0f, 30.0f, 200, model) == nullptr);
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK_EQ(model.curve[i], 0.0f);
+        CHECK_NEAR(model.slope[i], SLOPE_G[i] + CURVE_G[i] * 15.0f, 1e-5);   // Chord of the curve
+    }
+}
+
+HOST_TEST(thermal, rejects_bad_sweeps) {
+    ThermalModel model;
+    CHECK(fitSweep(15.0f, 24.0f, 200, model) != nullptr);           // Under CALIB_THERMAL_MIN_SPAN_C
+    CHECK(fitSweep(15.0f, 50.0f, CALIB_THERMAL_MIN_POINTS - 1, model) != nullptr);
+    CHECK(fitSweep(15.0f, 50.0f, 400, model, 30.0f) != nullptr);    // Moved mid-sweep
+
+    // 6 mg/°C on X is beyond any MPU6050, but stays under
+    // CALIB_THERMAL_MAX_SHIFT_G over a 15 °C sweep
+    ThermalAccumulator acc;
+    resetThermalAccumulator(acc);
+    for (int k = 0; k < 100; k++) {
+        float t = 15.0f + k * 0.15f;
+        float accel[3] = {0.006f * (t - 15.0f), 0.0f, 1.0f};
+        CHECK(accumulateThermalPoint(acc, t, accel) == nullptr);
+    }
+    CHECK(estimateThermalModel(acc, model) != nullptr);
+}
+
+// The sensor at temperatureC, still and flat, with the injected drift and
+// the sample noise of a real part
+static SimMotionSource driftingSensor(std::function<float(uint64_t)> temperatureC) {
+    auto rng = std::make_shared<std::mt19937>(4);
+    return [rng, temperatureC](uint64_t timeUs) {
+        std::normal_distribution<float> noise(0.0f, 0.004f);
+        float t = temperatureC(timeUs);
+        SimMotion m = {{0, 0, 0}, {0, 0, 0}, t};
+        for (uint8_t i = 0; i < 3; i++) {
+            m.accelG[i] = OFFSET_G[i] + driftG(i, t) + noise(*rng);
+        }
+        return m;
+    };
+}
+
+static void runCapture(uint8_t mode, uint32_t durationMs) {
+    CHECK(startCalibration(mode, durationMs));
+    while (getCalibrationStatus().state == CALIB_STATE_COLLECTING) {
+        simElapseUs(20000);
+        for (const MotionSample& s : popAllSamples()) {
+            feedCalibrationSample(s);
+        }
+        serviceCalibration();
+    }
+    CHECK_EQ(getCalibrationStatus().state, CALIB_STATE_DONE);
+}
+
+// Mean accel (g) over 2 s of samples and the tilt it gives, as read and
+// as corrected
+struct Level {
+    float accel[3];
+    float roll, pitch;
+};
+
+static void measureLevel(Level& raw, Level& corrected) {
+    simElapseUs(20000);
+    popAllSamples();
+    simElapseUs(2000000);
+    std::vector<MotionSample> samples = popAllSamples();
+    double sumRaw[3] = {0, 0, 0};
+    double sumCorrected[3] = {0, 0, 0};
+    for (MotionSample& s : samples) {
+        sumRaw[0] += accelToG(s.ax, s.accelRange);
+        sumRaw[1] += accelToG(s.ay, s.accelRange);
+        sumRaw[2] += accelToG(s.az, s.accelRange);
+        applyCalibration(s);
+        sumCorrected[0] += accelToG(s.ax, s.accelRange);
+        sumCorrected[1] += accelToG(s.ay, s.accelRange);
+        sumCorrected[2] += accelToG(s.az, s.accelRange);
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        raw.accel[i] = sumRaw[i] / samples.size();
+        corrected.accel[i] = sumCorrected[i] / samples.size();
+    }
+    calculateTilt(raw.accel[0], raw.accel[1], raw.accel[2], raw.roll, raw.pitch);
+    calculateTilt(corrected.accel[0], corrected.accel[1], corrected.accel[2], corrected.roll, corrected.pitch);
+}
+
+// A one-minute 15-50 °C thermal capture, then a bias capture at 25 °C: at
+// 50 °C the corrected sample reads what it did at 25 °C
+HOST_TEST(thermal, capture_and_correct_through_sensor) {
+    SimBoard board;
+    uint64_t sweepStart = 200000;
+    board.primary.setMotion(driftingSensor([sweepStart](uint64_t timeUs) {
+        float minutes = timeUs > sweepStart ? (timeUs - sweepStart) / 60e6f : 0.0f;
+        return SWEEP_FROM_C + 35.0f * min(minutes, 1.0f);
+    }));
+    initMPU();
+    CHECK(initMPUFifo(200));
+    loadCalibration();
+    simElapseUntilUs(sweepStart);
+    popAllSamples();
+
+    runCapture(CALIB_MODE_THERMAL, 60000);
+    CHECK(isThermallyCompensated());
+    const ThermalModel& model = getThermalModel();
+    for (uint8_t i = 0; i < 3; i++) {
+        // refTempC is the first block's mean, slightly above 15 °C
+        float x0 = model.refTempC - SWEEP_FROM_C;
+        CHECK_NEAR(model.slope[i], SLOPE_G[i] + 2 * CURVE_G[i] * x0, 1e-5);
+    }
+
+    float temperature = 25.0f;
+    board.primary.setMotion(driftingSensor([&temperature](uint64_t) { return temperature; }));
+    simElapseUs(100000);
+    popAllSamples();
+    runCapture(CALIB_MODE_BIAS, 2000);
+    CHECK_NEAR(getCalibration().temperatureC, 25.0, 0.05);
+
+    Level coolRaw, cool, hotRaw, hot;
+    measureLevel(coolRaw, cool);
+    temperature = 50.0f;
+    measureLevel(hotRaw, hot);
+
+    float rawShift = 0.0f;
+    float correctedShift = 0.0f;
+    for (uint8_t i = 0; i < 3; i++) {
+        rawShift = max(rawShift, fabs(hotRaw.accel[i] - coolRaw.accel[i]));
+        correctedShift = max(correctedShift, fabs(hot.accel[i] - cool.accel[i]));
+    }
+    printf("  25 -> 50 C: accel moves up to %.2f mg as read, %.2f mg corrected; "
+           "roll/pitch move %.3f/%.3f deg as read, %.3f/%.3f deg corrected\n",
+           rawShift * 1000, correctedShift * 1000, hotRaw.roll - coolRaw.roll, hotRaw.pitch - coolRaw.pitch,
+           hot.roll - cool.roll, hot.pitch - cool.pitch);
+    CHECK_GE(rawShift, 0.015);
+    CHECK_LE(correctedShift, 0.001);
+    CHECK_NEAR(hot.roll, cool.roll, 0.06);
+    CHECK_NEAR(hot.pitch, cool.pitch, 0.06);
+}
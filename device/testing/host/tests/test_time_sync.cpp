@@ -0,0 +1,168 @@
+// Time sync against a model of the BLE link: connection events, stack and
+// app latency, retransmissions, ms phone timestamps and drifting crystals.
+// Each scenario runs 30 minutes and checks how far deviceToPhoneTime() is
+// from the true phone clock, sampled every 100 ms after the first 20 s.
+#include "HostTest.h"
+#include "TimeSync.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define SIM_DURATION_US    (30 * 60e6)
+#define SIM_LOOP_US        10000.0          // loop() pass
+#define SIM_EPOCH_US       1.76e15          // Phone clock at the start, Unix µs
+
+struct LinkScenario {
+    double intervalMs;           // Connection interval; 0 cycles 7.5/15/30/50 ms each minute
+    double appLatencyMs;         // Mean of the exponential app/JS callback latency
+    double retransmit;           // Chance a connection event misses the packet
+    double devicePpm, phonePpm;  // Crystal errors against true time
+    double phoneStepAtUs;        // Phone clock set forward 2 s at this time (0: never)
+    bool spread;                 // Both sides add TIME_SYNC_SPREAD_MS random send delay
+};
+
+struct SyncResult {
+    double p50Ms, p95Ms, p99Ms, maxMs;
+    double driftPpm, trueDriftPpm;
+    TimeSyncStats stats;
+};
+
+static SyncResult runScenario(const LinkScenario& sc) {
+    resetTimeSync();
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::exponential_distribution<double> appLatency(1.0 / sc.appLatencyMs);
+
+    auto deviceClock = [&](double t) { return (int64_t)(t * (1 + sc.devicePpm * 1e-6) + 5e6); };
+    auto phoneClock = [&](double t) {
+        double step = sc.phoneStepAtUs > 0 && t > sc.phoneStepAtUs ? 2e6 : 0;
+        return SIM_EPOCH_US + t * (1 + sc.phonePpm * 1e-6) + step;
+    };
+    auto interval = [&](double t) {
+        static const double cycle[] = {7.5, 15, 30, 50};
+        return (sc.intervalMs > 0 ? sc.intervalMs : cycle[(int)(t / 60e6) % 4]) * 1000;
+    };
+    // First connection event at or after t that gets the packet through
+    double anchor = uniform(rng) * 1000;
+    auto nextEvent = [&](double t) {
+        double ci = interval(t);
+        double event = anchor + ceil((t - anchor) / ci) * ci;
+        while (uniform(rng) < sc.retransmit) {
+            event += ci;
+        }
+        return event;
+    };
+
+    std::vector<double> errors;
+    double t = 0;
+    double lastBurst = -1e12;
+    int inBurst = 0;
+    double nextCheck = 0;
+    while (t < SIM_DURATION_US) {
+        bool slow = getTimeSyncStats().points >= TIME_SYNC_MIN_POINTS;
+        double burstInterval = (slow ? TIME_SYNC_INTERVAL_MS : TIME_SYNC_FAST_INTERVAL_MS) * 1000.0;
+        if (inBurst > 0 || t - lastBurst >= burstInterval) {
+            if (inBurst == 0) {
+                lastBurst = t;
+            }
+            // Request queued at t1, out on a connection event, through the
+            // phone's stack and JS callback (Date.now() has ms resolution)
+            int64_t t1 = deviceClock(t);
+            double atPhone = nextEvent(t + 300) + 500 + appLatency(rng) * 1000;
+            int64_t t2 = (int64_t)(phoneClock(atPhone) / 1000) * 1000;
+            double reply = atPhone + 200 + (sc.spread ? uniform(rng) * TIME_SYNC_SPREAD_MS * 1000 : 0);
+            int64_t t3 = (int64_t)(phoneClock(reply) / 1000) * 1000;
+            double atDevice = nextEvent(reply + appLatency(rng) * 1000 + 300) + 300 + uniform(rng) * 1500;
+            int64_t t4 = deviceClock(atDevice);
+
+            // Handled on the next loop() pass; the device's own random delay
+            // before the next request falls on the loop grid
+            t = atDevice + uniform(rng) * SIM_LOOP_US;
+            if (sc.spread) {
+                t += floor(uniform(rng) * TIME_SYNC_SPREAD_MS * 1000 / SIM_LOOP_US) * SIM_LOOP_US;
+            }
+            addTimeSyncExchange(t1, t2, t3, t4);
+            if (++inBurst >= TIME_SYNC_BURST) {
+                endTimeSyncBurst();
+                inBurst = 0;
+            }
+        } else {
+            t += SIM_LOOP_US;
+        }
+        for (; nextCheck <= t; nextCheck += 100000) {
+            int64_t phoneUs;
+            if (nextCheck > 20e6 && deviceToPhoneTime(deviceClock(nextCheck), phoneUs)) {
+                errors.push_back(fabs((double)phoneUs - phoneClock(nextCheck)));
+            }
+        }
+    }
+
+    std::sort(errors.begin(), errors.end());
+    auto percentileMs = [&](double q) { return errors[(size_t)(q * (errors.size() - 1))] / 1000.0; };
+    SyncResult r;
+    r.p50Ms = percentileMs(0.5);
+    r.p95Ms = percentileMs(0.95);
+    r.p99Ms = percentileMs(0.99);
+    r.maxMs = errors.back() / 1000.0;
+    r.stats = getTimeSyncStats();
+    r.driftPpm = r.stats.driftPpm;
+    r.trueDriftPpm = (sc.phonePpm - sc.devicePpm) / (1 + sc.devicePpm * 1e-6);
+    printf("  |error| p50 %.2f ms, p95 %.2f, p99 %.2f, max %.2f; drift %.1f ppm (true %.1f); "
+           "%u exchanges, %u rejected, %u steps\n",
+           r.p50Ms, r.p95Ms, r.p99Ms, r.maxMs, r.driftPpm, r.trueDriftPpm, r.stats.exchanges, r.stats.rejected,
+           r.stats.steps);
+    CHECK(r.stats.synced);
+    CHECK_GE(errors.size(), (SIM_DURATION_US - 20e6) / 100000 - 1);   // Synced within 20 s
+    return r;
+}
+
+HOST_TEST(timesync, short_interval_light_load) {
+    SyncResult r = runScenario({15, 2, 0.02, 30, -12, 0, true});
+    CHECK_LE(r.p50Ms, 1.5);
+    CHECK_LE(r.p95Ms, 3.0);
+    CHECK_NEAR(r.driftPpm, r.trueDriftPpm, 10.0);
+    CHECK_EQ(r.stats.steps, 0);
+}
+
+HOST_TEST(timesync, typical_link) {
+    SyncResult r = runScenario({30, 4, 0.05, 30, -12, 0, true});
+    CHECK_LE(r.p50Ms, 2.0);
+    CHECK_LE(r.p95Ms, 5.0);
+    CHECK_NEAR(r.driftPpm, r.trueDriftPpm, 10.0);
+    CHECK_EQ(r.stats.steps, 0);
+}
+
+HOST_TEST(timesync, slow_busy_link) {
+    SyncResult r = runScenario({50, 10, 0.15, -40, 25, 0, true});
+    CHECK_LE(r.p50Ms, 3.0);
+    CHECK_LE(r.p95Ms, 10.0);
+    CHECK_NEAR(r.driftPpm, r.trueDriftPpm, 10.0);
+    CHECK_EQ(r.stats.steps, 0);
+}
+
+// The phone renegotiates the interval every minute
+HOST_TEST(timesync, changing_interval) {
+    SyncResult r = runScenario({0, 5, 0.08, 20, -20, 0, true});
+    CHECK_LE(r.p50Ms, 2.0);
+    CHECK_LE(r.p95Ms, 6.0);
+    CHECK_NEAR(r.driftPpm, r.trueDriftPpm, 10.0);
+    CHECK_EQ(r.stats.steps, 0);
+}
+
+// The phone clock jumps 2 s: detected as a step on the next burst and
+// refitted; only the samples up to that burst are off
+HOST_TEST(timesync, phone_clock_step) {
+    SyncResult r = runScenario({30, 4, 0.05, 30, -12, 15 * 60e6, true});
+    CHECK_EQ(r.stats.steps, 1);
+    CHECK_LE(r.p50Ms, 2.0);
+    CHECK_LE(r.p95Ms, 5.0);
+    CHECK_NEAR(r.maxMs, 2000.0, 10.0);
+}
+
+// Without the random send delays the reply leg always waits out most of a
+// connection interval, and the offset is skewed by about half of it
+HOST_TEST(timesync, spread_removes_interval_skew) {
+    SyncResult spread = runScenario({30, 4, 0.05, 30, -12, 0, true});
+    SyncResult fixed = runScenario({30, 4, 0.05, 30, -12, 0, false});
+    CHECK_GT(fixed.p50Ms, 2 * spread.p50Ms);
+}
@@ -0,0 +1,181 @@
+// Fit and evaluate the accel bias-vs-temperature model on a recorded sweep
+//
+//   thermal_fit [--block N] sweep.csv
+//
+// The CSV needs a header naming the columns temp_c, ax, ay and az (°C and g,
+// as in the BLE sensor frames); other columns are ignored. Record the sweep
+// with the device still and the thermal model cleared (CALIB_MODE_CLEAR), so
+// the accel is not already compensated. Rows are averaged in blocks of N
+// (default CALIB_THERMAL_BLOCK_SAMPLES, as the device does) and fitted with
+// the device's estimator. The report gives the model as the device would
+// store it and, per axis, how far the accel wanders over the sweep before and
+// after compensation.
+#include "Calibration.h"
+#include "TiltDetection.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct SweepPoint {
+    float temperatureC;
+    float accel[3];
+};
+
+static std::vector<std::string> splitCsv(const std::string& line) {
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ',')) {
+        while (!field.empty() && (field.back() == '\r' || field.back() == ' ')) {
+            field.pop_back();
+        }
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+// Rows of the sweep, block-averaged; false with a message on bad input
+static bool readSweep(const char* path, uint32_t block, std::vector<SweepPoint>& points) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "thermal_fit: cannot open %s\n", path);
+        return false;
+    }
+    static const char* const names[4] = {"temp_c", "ax", "ay", "az"};
+    int columns[4] = {-1, -1, -1, -1};
+    std::string line;
+    if (!std::getline(file, line)) {
+        fprintf(stderr, "thermal_fit: %s is empty\n", path);
+        return false;
+    }
+    std::vector<std::string> header = splitCsv(line);
+    for (int c = 0; c < 4; c++) {
+        for (size_t i = 0; i < header.size(); i++) {
+            if (header[i] == names[c]) {
+                columns[c] = i;
+            }
+        }
+        if (columns[c] < 0) {
+            fprintf(stderr, "thermal_fit: no %s column in the header\n", names[c]);
+            return false;
+        }
+    }
+
+    SweepPoint sum = {0, {0, 0, 0}};
+    uint32_t inBlock = 0;
+    int lineNumber = 1;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields = splitCsv(line);
+        float values[4];
+        for (int c = 0; c < 4; c++) {
+            char* end = nullptr;
+            const char* text = (size_t)columns[c] < fields.size() ? fields[columns[c]].c_str() : "";
+            values[c] = strtof(text, &end);
+            if (end == text) {
+                fprintf(stderr, "thermal_fit: line %d: bad %s value\n", lineNumber, names[c]);
+                return false;
+            }
+        }
+        sum.temperatureC += values[0];
+        for (uint8_t i = 0; i < 3; i++) {
+            sum.accel[i] += values[i + 1];
+        }
+        if (++inBlock == block) {
+            SweepPoint point = {sum.temperatureC / block, {sum.accel[0] / block, sum.accel[1] / block,
+                                                           sum.accel[2] / block}};
+            points.push_back(point);
+            sum = {0, {0, 0, 0}};
+            inBlock = 0;
+        }
+    }
+    return true;
+}
+
+static float modelDrift(const ThermalModel& model, uint8_t axis, float temperatureC) {
+    float x = temperatureC - model.refTempC;
+    return model.slope[axis] * x + model.curve[axis] * x * x;
+}
+
+int main(int argc, char** argv) {
+    uint32_t block = CALIB_THERMAL_BLOCK_SAMPLES;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--block") == 0 && i + 1 < argc) {
+            block = max(1, atoi(argv[++i]));
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == nullptr) {
+        fprintf(stderr, "usage: thermal_fit [--block N] sweep.csv\n");
+        return 2;
+    }
+
+    std::vector<SweepPoint> points;
+    if (!readSweep(path, block, points)) {
+        return 2;
+    }
+    ThermalAccumulator acc;
+    resetThermalAccumulator(acc);
+    for (const SweepPoint& p : points) {
+        const char* error = accumulateThermalPoint(acc, p.temperatureC, p.accel);
+        if (error != nullptr) {
+            fprintf(stderr, "thermal_fit: %s\n", error);
+            return 1;
+        }
+    }
+    ThermalModel model;
+    const char* error = estimateThermalModel(acc, model);
+    printf("%u points (%u rows each), %.1f to %.1f C\n", (unsigned)points.size(), block, acc.refTempC + acc.minX,
+           acc.refTempC + acc.maxX);
+    if (error != nullptr) {
+        fprintf(stderr, "thermal_fit: %s\n", error);
+        return 1;
+    }
+
+    printf("model: ref %.2f C, %s fit\n", model.refTempC,
+           acc.maxX - acc.minX >= CALIB_THERMAL_QUADRATIC_SPAN_C ? "quadratic" : "linear");
+    static const char axisNames[3] = {'x', 'y', 'z'};
+    for (uint8_t i = 0; i < 3; i++) {
+        // Spread about the mean, as read and with the modelled drift removed
+        double mean = 0.0;
+        double meanCorrected = 0.0;
+        for (const SweepPoint& p : points) {
+            mean += p.accel[i];
+            meanCorrected += p.accel[i] - modelDrift(model, i, p.temperatureC);
+        }
+        mean /= points.size();
+        meanCorrected /= points.size();
+        double worst = 0.0;
+        double worstCorrected = 0.0;
+        for (const SweepPoint& p : points) {
+            worst = max(worst, fabs(p.accel[i] - mean));
+            worstCorrected = max(worstCorrected, fabs(p.accel[i] - modelDrift(model, i, p.temperatureC) -
+                                                      meanCorrected));
+        }
+        printf("  %c: slope %8.4f mg/C, curve %9.6f mg/C^2; max deviation %6.2f mg as read, %6.2f mg "
+               "compensated\n",
+               axisNames[i], model.slope[i] * 1000, model.curve[i] * 1000, worst * 1000, worstCorrected * 1000);
+    }
+
+    // What the drift does to tilt between the ends of the sweep
+    const SweepPoint& first = points.front();
+    const SweepPoint& last = points.back();
+    float corrected[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        corrected[i] = last.accel[i] - modelDrift(model, i, last.temperatureC) +
+                       modelDrift(model, i, first.temperatureC);
+    }
+    float roll0, pitch0, roll1, pitch1, rollC, pitchC;
+    calculateTilt(first.accel[0], first.accel[1], first.accel[2], roll0, pitch0);
+    calculateTilt(last.accel[0], last.accel[1], last.accel[2], roll1, pitch1);
+    calculateTilt(corrected[0], corrected[1], corrected[2], rollC, pitchC);
+    printf("tilt change over the sweep: roll %.3f / pitch %.3f deg as read, %.3f / %.3f deg compensated\n",
+           roll1 - roll0, pitch1 - pitch0, rollC - roll0, pitchC - pitch0);
+    return 0;
+}
@@ -7,7 +7,9 @@ import {
   SENTRY_SERVICE_UUID, 
   SENSOR_DATA_CHARACTERISTIC_UUID,
   GPS_DATA_CHARACTERISTIC_UUID,
-  SENTRY_DEVICE_NAME_PATTERN 
+  CONFIG_CHARACTERISTIC_UUID,
+  SENTRY_DEVICE_NAME_PATTERN,
+  TIME_SYNC_CONFIG
 } from '@/utils/constants';
 
 export class BLEManager {
@@ -20,6 +22,7 @@ export class BLEManager {
   private subscription: any = null;
   private monitorSubscription: any = null;
   private gpsMonitorSubscription: any = null;
+  private configMonitorSubscription: any = null;
   private stopScanTimeout: ReturnType<typeof setTimeout> | null = null;
   private dataBuffer: string = ''; // Buffer for accumulating BLE packets
   private gpsDataBuffer: string = ''; // Buffer for accumulating GPS BLE packets
@@ -443,6 +446,9 @@ export class BLEManager {
         // Subscribe to GPS data characteristic
         await this.subscribeToGPSData(deviceWithServices, deviceId);
 
+        // Let the device stamp sensor frames in phone time
+        await this.startTimeSync(deviceWithServices);
+
         // Set up connection state monitoring
         this.subscription = deviceWithServices.onDisconnected((error: any, device: Device) => {
           try {
@@ -473,6 +479,15 @@ export class BLEManager {
               console.warn('⚠️ Error cleaning up GPS monitor subscription (expected if already disconnected):', cleanupError);
             }
             
+            try {
+              if (this.configMonitorSubscription) {
+                this.configMonitorSubscription.remove();
+                this.configMonitorSubscription = null;
+              }
+            } catch (cleanupError) {
+              console.warn('⚠️ Error cleaning up config monitor subscription (expected if already disconnected):', cleanupError);
+            }
+            
             // Clear device references
             this.connectedDevice = null;
             this.connectedDeviceInstance = null;
@@ -638,6 +653,7 @@ export class BLEManager {
       // Don't call remove() as cancelConnection() already handles cleanup in native code
       // Trying to remove() after cancel can cause NullPointerException
       this.monitorSubscription = null;
+      this.configMonitorSubscription = null;
       this.subscription = null;
       
       this.connectedDeviceInstance = null;
@@ -651,6 +667,7 @@ export class BLEManager {
       // Clear subscriptions to prevent memory leaks
       this.monitorSubscription = null;
       this.gpsMonitorSubscription = null;
+      this.configMonitorSubscription = null;
       this.subscription = null;
     }
   }
@@ -750,6 +767,62 @@ export class BLEManager {
     }
   }
 
+  /**
+   * Act as the device's time reference
+   * The device runs an NTP-style exchange over the config characteristic and
+   * estimates offset and drift itself; this side only stamps each request's
+   * arrival (t2) and the answer (t3) with its own clock. Answers go out after a
+   * random delay so they do not always wait out a full connection interval.
+   */
+  private async startTimeSync(device: Device): Promise<void> {
+    try {
+      const serviceUUID = SENTRY_SERVICE_UUID.toLowerCase();
+      const configUUID = CONFIG_CHARACTERISTIC_UUID.toLowerCase();
+      // eslint-disable-next-line @typescript-eslint/no-var-requires
+      const Buffer = require('buffer').Buffer;
+
+      this.configMonitorSubscription = device.monitorCharacteristicForService(
+        serviceUUID,
+        configUUID,
+        (error: any, char: Characteristic | null) => {
+          if (error || !char?.value) {
+            return;
+          }
+          const t2 = Date.now() * 1000;
+
+          let message: any;
+          try {
+            message = JSON.parse(Buffer.from(char.value, 'base64').toString('utf8'));
+          } catch (parseError) {
+            return; // Other config messages may arrive in chunks - not ours
+          }
+          if (message?.type !== 'time_sync') {
+            return;
+          }
+
+          setTimeout(() => {
+            const answer = JSON.stringify({
+              command: TIME_SYNC_CONFIG.command,
+              seq: message.seq,
+              t2,
+              t3: Date.now() * 1000,
+            });
+            device
+              .writeCharacteristicWithoutResponseForService(serviceUUID, configUUID, Buffer.from(answer).toString('base64'))
+              .catch((writeError: any) => console.warn('⚠️ Time sync answer failed:', writeError));
+          }, Math.random() * TIME_SYNC_CONFIG.replySpreadMs);
+        }
+      );
+
+      const enable = JSON.stringify({ command: TIME_SYNC_CONFIG.command, value: true });
+      await device.writeCharacteristicWithResponseForService(serviceUUID, configUUID, Buffer.from(enable).toString('base64'));
+      console.log('✅ Time sync enabled');
+    } catch (error) {
+      console.error('❌ Error enabling time sync:', error);
+      // Don't throw - sensor readings fall back to their arrival time
+    }
+  }
+
   /**
    * Parse BLE GPS data to GPSData format
    * ESP32 sends GPS data as JSON: {type: "gps_data", gps: {fix, satellites, latitude, longitude, altitude}}
@@ -946,7 +1019,10 @@ export class BLEManager {
           roll: typeof sensorData.roll === 'number' ? sensorData.roll : 0,
           pitch: typeof sensorData.pitch === 'number' ? sensorData.pitch : 0,
           tilt_detected: typeof sensorData.tilt_detected === 'boolean' ? sensorData.tilt_detected : false,
-          timestamp: data.timestamp ? new Date(data.timestamp).toISOString() : new Date().toISOString(),
+          // Device time is since boot; only the synced phone-clock time is a date
+          timestamp: typeof data.epoch_us === 'number' ? new Date(data.epoch_us / 1000).toISOString() : new Date().toISOString(),
+          g_total: typeof sensorData.g_total === 'number' ? sensorData.g_total : undefined,
+          g_linear: typeof sensorData.g_linear === 'number' ? sensorData.g_linear : undefined,
         };
       } else if (data.ax !== undefined || data.ay !== undefined || data.az !== undefined) {
         // Direct structure: {ax, ay, az, ...} (fallback for other formats)
@@ -1046,6 +1122,16 @@ export class BLEManager {
         this.gpsMonitorSubscription = null;
       }
       
+      try {
+        if (this.configMonitorSubscription) {
+          this.configMonitorSubscription.remove();
+          this.configMonitorSubscription = null;
+        }
+      } catch (error) {
+        console.warn('⚠️ Error removing config monitor subscription (expected if already removed):', error);
+        this.configMonitorSubscription = null;
+      }
+      
       try {
         this.manager.stopDeviceScan();
       } catch (error) {
@@ -1064,6 +1150,7 @@ export class BLEManager {
       this.subscription = null;
       this.monitorSubscription = null;
       this.gpsMonitorSubscription = null;
+      this.configMonitorSubscription = null;
       this.connectedDevice = null;
       this.connectedDeviceInstance = null;
     }
@@ -23,7 +23,8 @@ export class ThresholdDetector {
    * Check if sensor reading exceeds thresholds
    */
   checkThreshold(reading: SensorReading): ThresholdResult {
-    const gForce = calculateGForce(reading.ax, reading.ay, reading.az);
+    // Prefer the device's gravity-free magnitude so thresholds act on real forces
+    const gForce = reading.g_linear ?? calculateGForce(reading.ax, reading.ay, reading.az);
     const tilt = calculateTilt(reading.ax, reading.ay, reading.az);
 
     const gForceExceeded = gForce >= this.config.gForceThreshold;
@@ -9,6 +9,8 @@ export interface SensorReading {
   pitch: number;
   tilt_detected: boolean;
   timestamp: string;
+  g_total?: number; // |a| in g including gravity (computed on the device)
+  g_linear?: number; // |a| in g with gravity removed (computed on the device)
 }
 
 export interface GPSData {
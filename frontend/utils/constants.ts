@@ -15,6 +15,12 @@ export const GPS_DATA_CHARACTERISTIC_UUID = '0000ff02-0000-1000-8000-00805f9b34f
 export const CONFIG_CHARACTERISTIC_UUID = '0000ff03-0000-1000-8000-00805f9b34fb';
 export const DEVICE_STATUS_CHARACTERISTIC_UUID = '0000ff04-0000-1000-8000-00805f9b34fb';
 
+// Device time sync (answers to the device's requests on the config characteristic)
+export const TIME_SYNC_CONFIG = {
+  command: 0x11, // CMD_TIME_SYNC
+  replySpreadMs: 50, // Random answer delay, TIME_SYNC_SPREAD_MS on the device
+} as const;
+
 // BLE Device name pattern to match
 export const SENTRY_DEVICE_NAME_PATTERN = 'Sentry';
 